@@ -145,15 +145,19 @@ class TestAgent : public AgentApplication
     ~TestAgent() override = default;
     static TypeId GetTypeId();
 
+    void Setup() override
+    {
+        AgentApplication::Setup();
+        m_obsDataStruct.AddAggregationWindow(10);
+    }
+
     void OnRecvObs(uint remoteAppId) override
     {
         NS_LOG_INFO("received Observation from " << remoteAppId);
-        NS_LOG_INFO(
-            "avg: " << m_obsDataStruct.AggregateNewest(remoteAppId, 10)["floatObs"].GetAvg());
-        NS_LOG_INFO(
-            "min: " << m_obsDataStruct.AggregateNewest(remoteAppId, 10)["floatObs"].GetMin());
-        NS_LOG_INFO(
-            "max: " << m_obsDataStruct.AggregateNewest(remoteAppId, 10)["floatObs"].GetMax());
+        auto info = m_obsDataStruct.AggregateNewest(remoteAppId, 10)["floatObs"];
+        NS_LOG_INFO("avg: " << info.GetAvg());
+        NS_LOG_INFO("min: " << info.GetMin());
+        NS_LOG_INFO("max: " << info.GetMax());
     }
 
     void OnRecvReward(uint remoteAppId) override
@@ -278,7 +278,8 @@ class PendulumActionApp : public ActionApplication
     void ExecuteAction(uint32_t remoteAppId, Ptr<OpenGymDictContainer> action) override
     {
         auto cart = DynamicCast<PendulumCart>(GetNode());
-        auto act = action->Get("default")->GetObject<OpenGymBoxContainer<int>>();
+        auto act =
+            GetDictValue(action, GetDefaultActionKey())->GetObject<OpenGymBoxContainer<int>>();
         auto acc = 20;
         acc *= (act->GetValue(0));
         acc -= 10;
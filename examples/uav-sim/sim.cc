@@ -231,7 +231,7 @@ class UavObservationApp : public ObservationApplication
 
   private:
     Ptr<OpenGymDataContainer> m_observation = MakeBoxContainer<float>(OBSERVATION_SIZE);
-    
+    KeyId m_floatObsKey = KeyRegistry::Intern("floatObs");
 };
 
 NS_OBJECT_ENSURE_REGISTERED(UavObservationApp);
@@ -450,7 +450,7 @@ UavObservationApp::Observe(uint32_t nodeId,
 void
 UavObservationApp::SendObservation(double delay)
 {
-    Send(MakeDictContainer("floatObs", m_observation));
+    Send(MakeDictContainer(m_floatObsKey, m_observation));
     Simulator::Schedule(Seconds(delay), &UavObservationApp::SendObservation, this, delay);
 }
 
@@ -477,6 +477,8 @@ class UavRewardApp : public RewardApplication
         std::vector<UAVState> nearbyUAVStates);
     void RegisterCallbacks() override;
 
+  private:
+    KeyId m_rewardKey = KeyRegistry::Intern("reward");
 };
 
 NS_OBJECT_ENSURE_REGISTERED(UavRewardApp);
@@ -663,7 +665,7 @@ UavRewardApp::Reward(uint32_t nodeId,
         totalReward
     };
     // Send the reward
-    Send(MakeDictBoxContainer<float>(1, "reward", totalReward));
+    Send(MakeDictBoxContainer<float>(1, m_rewardKey, totalReward));
 }
 
 void
@@ -686,6 +688,8 @@ class InferenceAgentApp : public AgentApplication
     ~InferenceAgentApp() override{};
 
     Time m_stepTime;
+    KeyId m_floatObsKey;
+    KeyId m_rewardKey;
 
     void PerformInferenceStep()
     {
@@ -697,9 +701,7 @@ class InferenceAgentApp : public AgentApplication
             // std::cout << "AppId:" << appId<< std::endl;
             if (m_obsDataStruct.HistoryExists(appId))
             {
-                m_observation = m_obsDataStruct.GetNewestByID(appId)
-                                    ->data->Get("floatObs")
-                                    ->GetObject<OpenGymBoxContainer<float>>();
+                m_observation = GetNewestObservation(appId);
             }
             else
             {
@@ -709,10 +711,7 @@ class InferenceAgentApp : public AgentApplication
             // use reward for current UAV
             if (m_rewardDataStruct.HistoryExists(appId))
             {
-                m_reward = m_rewardDataStruct.GetNewestByID(appId)
-                               ->data->Get("reward")
-                               ->GetObject<OpenGymBoxContainer<float>>()
-                               ->GetValue(0);
+                m_reward = GetNewestReward(appId);
             }
             else
             {
@@ -743,16 +742,34 @@ class InferenceAgentApp : public AgentApplication
     void Setup() override
     {
         AgentApplication::Setup();
+        m_floatObsKey = KeyRegistry::Intern("floatObs");
+        m_rewardKey = KeyRegistry::Intern("reward");
         m_observation = GetResetObservation();
         m_reward = GetResetReward();
     }
 
     void OnRecvObs(uint id) override
     {
-        auto observation = m_obsDataStruct.GetNewestByID(id)
-                               ->data->Get("floatObs")
-                               ->GetObject<OpenGymBoxContainer<float>>();
-        m_observation = observation;
+        m_observation = GetNewestObservation(id);
+    }
+
+    // use the box stored in the dict of the newest observation without copying it
+    Ptr<OpenGymDataContainer> GetNewestObservation(uint id)
+    {
+        return GetDictValue(m_obsDataStruct.GetNewestByID(id)->data, m_floatObsKey);
+    }
+
+    // read the newest reward from its column, or from the dict if it is not stored as one
+    float GetNewestReward(uint id)
+    {
+        const float* reward = m_rewardDataStruct.GetNewestValues<float>(id, m_rewardKey);
+        if (reward)
+        {
+            return *reward;
+        }
+        return GetDictValue(m_rewardDataStruct.GetNewestByID(id)->data, m_rewardKey)
+            ->GetObject<OpenGymBoxContainer<float>>()
+            ->GetValue(0);
     }
 
     void OnRecvReward(uint id) override
@@ -837,7 +854,8 @@ class UavActionApp : public ActionApplication
     void ExecuteAction(uint32_t remoteAppId, Ptr<OpenGymDictContainer> action) override
     {
         auto uavNode = DynamicCast<UAVNode>(GetNode()); // Assuming UavController controls the UAV
-        auto act = action->Get("default")->GetObject<OpenGymBoxContainer<float>>();
+        auto act = GetDictValue(action, GetDefaultActionKey())
+                       ->GetObject<OpenGymBoxContainer<float>>();
 
         // Extract x and y velocities from the action
         float angle = act->GetValue(0);
@@ -989,6 +1007,7 @@ main(int argc, char* argv[])
     RlApplicationContainer actionApps = helper.Install(uavNodes);
 
     helper.SetTypeId("ns3::InferenceAgentApp");
+    helper.SetAttribute("RewardColumnarHistory", BooleanValue(true));
     RlApplicationContainer agentApps = helper.Install(uavNodes);
 
     CommunicationHelper commHelper = CommunicationHelper();
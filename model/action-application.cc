@@ -21,6 +21,13 @@ ActionApplication::~ActionApplication()
 {
 }
 
+KeyId
+ActionApplication::GetDefaultActionKey()
+{
+    static const KeyId key = KeyRegistry::Intern("default");
+    return key;
+}
+
 uint
 ActionApplication::AddAgentInterface(uint32_t remoteAppId, Ptr<ChannelInterface> interface)
 {
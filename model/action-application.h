@@ -2,6 +2,7 @@
 #define ACTION_APPLICATION_H
 
 #include "channel-interface.h"
+#include "key-registry.h"
 #include "rl-application.h"
 
 namespace ns3
@@ -49,6 +50,14 @@ class ActionApplication : public RlApplication
      */
     virtual void ExecuteAction(uint remoteAppId, Ptr<OpenGymDictContainer> action) = 0;
 
+    /**
+     * \brief Get the interned id of the key \c "default", under which
+     * AgentApplication::InitiateAction() sends the inferred action. Read the action with
+     * \c GetDictValue(action, GetDefaultActionKey()) to avoid looking up the key string.
+     * \return the id of the key.
+     */
+    static KeyId GetDefaultActionKey();
+
   protected:
     InterfaceMap m_interfaces; //!< All interfaces connected to this ActionApplication for receiving
                                //!< from AgentApplications.
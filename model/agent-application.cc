@@ -42,6 +42,125 @@ AgentApplication::GetTypeId()
                           "Enable ns3 timestamps for rewards.",
                           BooleanValue(false),
                           MakeBooleanAccessor(&AgentApplication::m_rewardTimestamping),
+                          MakeBooleanChecker())
+            .AddAttribute("ObservationColumnarHistory",
+                          "Additionally store observation box values in contiguous columns.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AgentApplication::m_obsColumnar),
+                          MakeBooleanChecker())
+            .AddAttribute("RewardColumnarHistory",
+                          "Additionally store reward box values in contiguous columns.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AgentApplication::m_rewardColumnar),
+                          MakeBooleanChecker())
+            .AddAttribute("ObservationReplayDirectory",
+                          "Directory to keep memory-mapped replay buffers of the observations in. "
+                          "Disabled if empty.",
+                          StringValue(""),
+                          MakeStringAccessor(&AgentApplication::m_obsReplayDirectory),
+                          MakeStringChecker())
+            .AddAttribute("RewardReplayDirectory",
+                          "Directory to keep memory-mapped replay buffers of the rewards in. "
+                          "Disabled if empty.",
+                          StringValue(""),
+                          MakeStringAccessor(&AgentApplication::m_rewardReplayDirectory),
+                          MakeStringChecker())
+            .AddAttribute("ReplayBufferCapacity",
+                          "Number of records to retain in each replay buffer file.",
+                          UintegerValue(1000000),
+                          MakeUintegerAccessor(&AgentApplication::m_replayCapacity),
+                          MakeUintegerChecker<uint64_t>(1))
+            .AddAttribute("ObservationRetentionPolicy",
+                          "Which observations each history retains: LastN, Decimate, Reservoir "
+                          "or Hybrid.",
+                          StringValue("LastN"),
+                          MakeStringAccessor(&AgentApplication::m_obsRetentionPolicy),
+                          MakeStringChecker())
+            .AddAttribute("ObservationRetentionParameter",
+                          "Decimation factor of the Decimate policy or size of the sample of "
+                          "older observations of the Hybrid policy.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AgentApplication::m_obsRetentionParameter),
+                          MakeUintegerChecker<uint>())
+            .AddAttribute("RewardRetentionPolicy",
+                          "Which rewards each history retains: LastN, Decimate, Reservoir or "
+                          "Hybrid.",
+                          StringValue("LastN"),
+                          MakeStringAccessor(&AgentApplication::m_rewardRetentionPolicy),
+                          MakeStringChecker())
+            .AddAttribute("RewardRetentionParameter",
+                          "Decimation factor of the Decimate policy or size of the sample of "
+                          "older rewards of the Hybrid policy.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AgentApplication::m_rewardRetentionParameter),
+                          MakeUintegerChecker<uint>())
+            .AddAttribute("ObservationCompressionKeyframeInterval",
+                          "Number of observations per XOR-compressed block of float values, or 0 "
+                          "to store the observations uncompressed.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AgentApplication::m_obsKeyframeInterval),
+                          MakeUintegerChecker<uint>())
+            .AddAttribute("RewardCompressionKeyframeInterval",
+                          "Number of rewards per XOR-compressed block of float values, or 0 to "
+                          "store the rewards uncompressed.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AgentApplication::m_rewardKeyframeInterval),
+                          MakeUintegerChecker<uint>())
+            .AddAttribute("ObservationTimeToLive",
+                          "Maximum age of the stored observations in simulation time, or 0 to "
+                          "keep them regardless of their age. Implies ObservationTimestamping.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&AgentApplication::m_obsTimeToLive),
+                          MakeTimeChecker())
+            .AddAttribute("RewardTimeToLive",
+                          "Maximum age of the stored rewards in simulation time, or 0 to keep "
+                          "them regardless of their age. Implies RewardTimestamping.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&AgentApplication::m_rewardTimeToLive),
+                          MakeTimeChecker())
+            .AddAttribute("TransitionCapacity",
+                          "Number of (observation, reward, next observation) transitions to "
+                          "buffer until they are taken, or 0 to not build transitions.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&AgentApplication::m_transitionCapacity),
+                          MakeUintegerChecker<uint>())
+            .AddAttribute("ReturnsRewardKey",
+                          "Dictionary key of the reward to compute discounted returns and "
+                          "advantages of while the rewards arrive. Disabled if empty.",
+                          StringValue(""),
+                          MakeStringAccessor(&AgentApplication::m_returnsRewardKey),
+                          MakeStringChecker())
+            .AddAttribute("ReturnsDoneKey",
+                          "Dictionary key of a flag in the rewards that is not 0 if the episode "
+                          "ended with the reward. Episodes only end at rollouts if empty.",
+                          StringValue(""),
+                          MakeStringAccessor(&AgentApplication::m_returnsDoneKey),
+                          MakeStringChecker())
+            .AddAttribute("ReturnsDiscount",
+                          "Discount factor gamma of the returns.",
+                          DoubleValue(0.99),
+                          MakeDoubleAccessor(&AgentApplication::m_returnsDiscount),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("ReturnsGaeLambda",
+                          "Parameter lambda of the generalized advantage estimates.",
+                          DoubleValue(0.95),
+                          MakeDoubleAccessor(&AgentApplication::m_returnsGaeLambda),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("ReturnsSteps",
+                          "Number of rewards of an n-step return.",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&AgentApplication::m_returnsSteps),
+                          MakeUintegerChecker<uint>(1))
+            .AddAttribute("ReturnsRolloutLength",
+                          "Maximum number of rewards of a history processed at once.",
+                          UintegerValue(128),
+                          MakeUintegerAccessor(&AgentApplication::m_returnsRolloutLength),
+                          MakeUintegerChecker<uint>(1))
+            .AddAttribute("UseMemoryBudget",
+                          "Account the observation and reward histories against the memory "
+                          "budget shared by the process, see MemoryBudget::GetGlobal().",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&AgentApplication::m_useMemoryBudget),
                           MakeBooleanChecker());
     return tid;
 }
@@ -51,6 +170,10 @@ AgentApplication::ReceiveObservation(uint remoteAppId, Ptr<OpenGymDictContainer>
 {
     NS_LOG_FUNCTION(this << remoteAppId << observation);
     m_obsDataStruct.Push(observation, remoteAppId);
+    if (m_transitionCapacity > 0)
+    {
+        m_transitionBuilder.AddObservation(remoteAppId, observation, Simulator::Now());
+    }
     OnRecvObs(remoteAppId);
 }
 
@@ -65,14 +188,71 @@ AgentApplication::ReceiveReward(uint remoteAppId, Ptr<OpenGymDictContainer> rewa
 {
     NS_LOG_FUNCTION(this << remoteAppId << reward);
     m_rewardDataStruct.Push(reward, remoteAppId);
+    if (m_transitionCapacity > 0)
+    {
+        m_transitionBuilder.AddReward(remoteAppId, reward, Simulator::Now());
+    }
     OnRecvReward(remoteAppId);
 }
 
+void
+AgentApplication::TakeReturns(ReturnsCalculator::Batch& batch)
+{
+    ReturnsCalculator* returns = m_rewardDataStruct.GetReturnsCalculator();
+    if (!returns)
+    {
+        batch.Clear();
+        return;
+    }
+    returns->TakeBatch(batch);
+}
+
 void
 AgentApplication::Setup()
 {
-    m_obsDataStruct = HistoryContainer(m_maxObservationHistoryLength, m_obsTimestamping);
-    m_rewardDataStruct = HistoryContainer(m_maxRewardHistoryLength, m_rewardTimestamping);
+    m_obsDataStruct =
+        HistoryContainer(m_maxObservationHistoryLength, m_obsTimestamping, m_obsColumnar);
+    m_rewardDataStruct =
+        HistoryContainer(m_maxRewardHistoryLength, m_rewardTimestamping, m_rewardColumnar);
+    m_obsDataStruct.SetRetentionPolicy(HistoryContainer::ParseRetentionPolicy(m_obsRetentionPolicy),
+                                       m_obsRetentionParameter);
+    m_rewardDataStruct.SetRetentionPolicy(
+        HistoryContainer::ParseRetentionPolicy(m_rewardRetentionPolicy),
+        m_rewardRetentionParameter);
+    m_transitionBuilder = TransitionBuilder(m_transitionCapacity);
+    m_obsDataStruct.SetTimeToLive(m_obsTimeToLive);
+    m_rewardDataStruct.SetTimeToLive(m_rewardTimeToLive);
+    if (m_obsKeyframeInterval > 0)
+    {
+        m_obsDataStruct.EnableCompression(m_obsKeyframeInterval);
+    }
+    if (m_rewardKeyframeInterval > 0)
+    {
+        m_rewardDataStruct.EnableCompression(m_rewardKeyframeInterval);
+    }
+    if (!m_returnsRewardKey.empty())
+    {
+        m_rewardDataStruct.EnableReturns(m_returnsRewardKey,
+                                         m_returnsDiscount,
+                                         m_returnsGaeLambda,
+                                         m_returnsSteps,
+                                         m_returnsRolloutLength,
+                                         "",
+                                         m_returnsDoneKey);
+    }
+    if (m_useMemoryBudget)
+    {
+        m_obsDataStruct.SetMemoryBudget();
+        m_rewardDataStruct.SetMemoryBudget();
+    }
+    if (!m_obsReplayDirectory.empty())
+    {
+        m_obsDataStruct.EnableReplayBuffer(m_obsReplayDirectory, m_replayCapacity);
+    }
+    if (!m_rewardReplayDirectory.empty())
+    {
+        m_rewardDataStruct.EnableReplayBuffer(m_rewardReplayDirectory, m_replayCapacity);
+    }
     OpenGymMultiAgentInterface::Get()->SetGetObservationSpaceCb(
         GetId().ToString(),
         MakeCallback(&AgentApplication::GetObservationSpace, this));
@@ -196,13 +376,13 @@ AgentApplication::DeleteActionInterface(uint32_t remoteAppId, uint interfaceId)
 void
 AgentApplication::InitiateAction(Ptr<OpenGymDataContainer> action)
 {
-    SendAction(MakeDictContainer("default", action));
+    SendAction(MakeDictContainer(ActionApplication::GetDefaultActionKey(), action));
 }
 
 void
 AgentApplication::InitiateActionForApp(uint remoteAppId, Ptr<OpenGymDataContainer> action)
 {
-    SendAction(MakeDictContainer("default", action), remoteAppId);
+    SendAction(MakeDictContainer(ActionApplication::GetDefaultActionKey(), action), remoteAppId);
 }
 
 void
@@ -3,6 +3,7 @@
 
 #include "history-container.h"
 #include "rl-application.h"
+#include "transition-builder.h"
 
 namespace ns3
 {
@@ -166,15 +167,47 @@ class AgentApplication : public RlApplication
      */
     void SendAction(Ptr<OpenGymDictContainer> action);
 
+    /**
+     * \brief Move the returns and advantages of all processed reward steps into a batch, e.g. to
+     * send them to the trainer. Returns are only computed if the attribute \c ReturnsRewardKey is
+     * set, see HistoryContainer::EnableReturns().
+     * \param batch the batch to fill, cleared first. Passing the same batch every time reuses its
+     * memory.
+     */
+    void TakeReturns(ReturnsCalculator::Batch& batch);
+
   protected:
     uint m_maxObservationHistoryLength; //!< maximum length of the history of each observation deque
                                         //!< to store
     uint m_maxRewardHistoryLength; //!< maximum length of the history of each reward deque to store
     bool m_obsTimestamping;        //!< enable ns3 timestamps for observations
     bool m_rewardTimestamping;     //!< enable ns3 timestamps for rewards
+    bool m_obsColumnar;            //!< store observation box values in columns
+    bool m_rewardColumnar;         //!< store reward box values in columns
+    std::string m_obsReplayDirectory;    //!< directory of the observation replay buffers
+    std::string m_rewardReplayDirectory; //!< directory of the reward replay buffers
+    uint64_t m_replayCapacity;           //!< number of records of each replay buffer
+    std::string m_obsRetentionPolicy;    //!< retention policy of the observation histories
+    std::string m_rewardRetentionPolicy; //!< retention policy of the reward histories
+    uint m_obsRetentionParameter;        //!< decimation factor or sample size for observations
+    uint m_rewardRetentionParameter;     //!< decimation factor or sample size for rewards
+    uint m_obsKeyframeInterval;          //!< observations per compressed block, 0 to disable
+    uint m_rewardKeyframeInterval;       //!< rewards per compressed block, 0 to disable
+    Time m_obsTimeToLive;                //!< maximum age of the observations, 0 to disable
+    Time m_rewardTimeToLive;             //!< maximum age of the rewards, 0 to disable
+    uint m_transitionCapacity;           //!< number of buffered transitions, 0 to disable
+    std::string m_returnsRewardKey;      //!< key of the reward to compute returns of, or empty
+    std::string m_returnsDoneKey;        //!< key of the episode end flag of the rewards, or empty
+    double m_returnsDiscount;            //!< discount factor of the returns
+    double m_returnsGaeLambda;           //!< GAE parameter of the advantages
+    uint m_returnsSteps;                 //!< number of rewards of an n-step return
+    uint m_returnsRolloutLength;         //!< maximum number of steps of a rollout
+    bool m_useMemoryBudget;              //!< account the histories against the global budget
     HistoryContainer
         m_obsDataStruct; //!< a data structure in which received observations are stored
     HistoryContainer m_rewardDataStruct; //!< a data structure in which received rewards are stored
+    TransitionBuilder
+        m_transitionBuilder; //!< joins received observations and rewards into transitions
     Ptr<OpenGymDataContainer>
         m_observation; //!< the current observation which is used in \c InferAction()
     float m_reward;    //!< the current reward which is used in \c InferAction()
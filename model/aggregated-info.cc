@@ -2,7 +2,10 @@
 
 #include <ns3/log.h>
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <numeric>
 
 using namespace ns3;
 
@@ -10,10 +13,12 @@ NS_LOG_COMPONENT_DEFINE("AggregatedInfo");
 
 AggregatedInfo::AggregatedInfo()
     : m_min(std::numeric_limits<float>::max()),
-      m_max(std::numeric_limits<float>::min()),
-      m_avg(0),
+      m_max(std::numeric_limits<float>::lowest()),
+      m_count(0),
+      m_mean(0),
+      m_m2(0),
       m_sum(0),
-      m_counter(0){};
+      m_compensation(0){};
 
 float
 AggregatedInfo::GetMin() const
@@ -30,9 +35,63 @@ AggregatedInfo::GetMax() const
 float
 AggregatedInfo::GetAvg() const
 {
-    return m_avg;
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    return GetSum() / m_count;
 };
 
+uint64_t
+AggregatedInfo::GetCount() const
+{
+    return m_count;
+}
+
+double
+AggregatedInfo::GetSum() const
+{
+    return m_sum + m_compensation;
+}
+
+double
+AggregatedInfo::GetVariance() const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    return m_m2 / m_count;
+}
+
+double
+AggregatedInfo::GetStddev() const
+{
+    return std::sqrt(GetVariance());
+}
+
+void
+AggregatedInfo::EnableQuantiles(uint k)
+{
+    if (!m_quantiles)
+    {
+        m_quantiles.emplace(k);
+    }
+}
+
+bool
+AggregatedInfo::HasQuantiles() const
+{
+    return m_quantiles.has_value();
+}
+
+float
+AggregatedInfo::GetQuantile(double q) const
+{
+    NS_ASSERT_MSG(m_quantiles, "Quantiles are not estimated, call EnableQuantiles() first");
+    return m_quantiles->GetQuantile(q);
+}
+
 void
 AggregatedInfo::UpdateMin(float value)
 {
@@ -54,9 +113,11 @@ AggregatedInfo::UpdateMax(float value)
 void
 AggregatedInfo::UpdateAverage(float value)
 {
-    m_counter += 1;
+    m_count++;
+    double delta = value - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (value - m_mean);
     IncrementSum(value);
-    m_avg = m_sum / m_counter;
 };
 
 void
@@ -65,6 +126,10 @@ AggregatedInfo::UpdateStatistics(AggregatedInfo update)
     UpdateMax(update.GetMax());
     UpdateMin(update.GetMin());
     UpdateAverage(update.GetAvg());
+    if (m_quantiles && update.m_quantiles)
+    {
+        m_quantiles->Merge(*update.m_quantiles);
+    }
 }
 
 void
@@ -73,12 +138,162 @@ AggregatedInfo::UpdateStatistics(float update)
     UpdateMax(update);
     UpdateMin(update);
     UpdateAverage(update);
+    if (m_quantiles)
+    {
+        m_quantiles->Update(update);
+    }
+}
+
+template <typename T>
+void
+AggregatedInfo::UpdateSequence(const T* values, size_t count)
+{
+    UpdateStatistics(Reduce(values, count));
+    if (m_quantiles)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            m_quantiles->Update(values[i]);
+        }
+    }
+}
+
+void
+AggregatedInfo::UpdateStatistics(const float* values, size_t count)
+{
+    UpdateSequence(values, count);
 }
 
 void
-AggregatedInfo::IncrementSum(float value)
+AggregatedInfo::UpdateStatistics(const double* values, size_t count)
 {
-    m_sum += value;
+    UpdateSequence(values, count);
+}
+
+template <typename T, typename>
+void
+AggregatedInfo::UpdateStatistics(const T* values, size_t count)
+{
+    UpdateSequence(values, count);
+}
+
+template void AggregatedInfo::UpdateStatistics(const int8_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const int16_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const int32_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const int64_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const uint8_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const uint16_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const uint32_t* values, size_t count);
+template void AggregatedInfo::UpdateStatistics(const uint64_t* values, size_t count);
+
+template <typename T>
+void
+AggregatedInfo::UpdateEntrySequence(const T* values, size_t count, int stats)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (stats & (MIN | MAX))
+    {
+        auto [min, max] = std::minmax_element(values, values + count);
+        if (stats & MIN)
+        {
+            UpdateMin(*min);
+        }
+        if (stats & MAX)
+        {
+            UpdateMax(*max);
+        }
+    }
+    if (stats & AVG)
+    {
+        double sum = std::accumulate(values, values + count, 0.0);
+        UpdateAverage(static_cast<float>(sum / count));
+    }
+}
+
+void
+AggregatedInfo::UpdateEntry(const float* values, size_t count, int stats)
+{
+    UpdateEntrySequence(values, count, stats);
+}
+
+void
+AggregatedInfo::UpdateEntry(const double* values, size_t count, int stats)
+{
+    UpdateEntrySequence(values, count, stats);
+}
+
+template <typename T, typename>
+void
+AggregatedInfo::UpdateEntry(const T* values, size_t count, int stats)
+{
+    UpdateEntrySequence(values, count, stats);
+}
+
+template void AggregatedInfo::UpdateEntry(const int8_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const int16_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const int32_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const int64_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const uint8_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const uint16_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const uint32_t* values, size_t count, int stats);
+template void AggregatedInfo::UpdateEntry(const uint64_t* values, size_t count, int stats);
+
+void
+AggregatedInfo::UpdateStatistics(const Reduction& reduction)
+{
+    if (reduction.count == 0)
+    {
+        return;
+    }
+    UpdateMin(reduction.min);
+    UpdateMax(reduction.max);
+    MergeMoments(reduction.count, reduction.sum / reduction.count, reduction.m2);
+    IncrementSum(reduction.sum);
+}
+
+void
+AggregatedInfo::Merge(const AggregatedInfo& other)
+{
+    if (other.m_count > 0)
+    {
+        UpdateMin(other.m_min);
+        UpdateMax(other.m_max);
+        MergeMoments(other.m_count, other.m_mean, other.m_m2);
+        IncrementSum(other.m_sum);
+        IncrementSum(other.m_compensation);
+    }
+    if (m_quantiles && other.m_quantiles)
+    {
+        m_quantiles->Merge(*other.m_quantiles);
+    }
+}
+
+void
+AggregatedInfo::MergeMoments(uint64_t count, double mean, double m2)
+{
+    uint64_t total = m_count + count;
+    double delta = mean - m_mean;
+    m_mean += delta * count / total;
+    m_m2 += m2 + delta * delta * m_count * count / total;
+    m_count = total;
+}
+
+void
+AggregatedInfo::IncrementSum(double value)
+{
+    double sum = m_sum + value;
+    if (std::abs(m_sum) >= std::abs(value))
+    {
+        m_compensation += (m_sum - sum) + value;
+    }
+    else
+    {
+        m_compensation += (value - sum) + m_sum;
+    }
+    m_sum = sum;
 };
 
 void
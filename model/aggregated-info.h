@@ -1,7 +1,14 @@
 #ifndef AGGREGATED_INFO_H
 #define AGGREGATED_INFO_H
 
+#include "aggregation-kernels.h"
+#include "quantile-sketch.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <optional>
+#include <type_traits>
 
 namespace ns3
 {
@@ -10,24 +17,146 @@ namespace ns3
  * \ingroup defiance
  * \class AggregatedInfo
  * \brief A helper class to store aggregated information about a single observation/reward. The
- * aggregated information includes the minimum, maximum, average and sum of the observation/reward
- * values.
+ * aggregated information includes the minimum, maximum, average, variance and sum of the
+ * observation/reward values. The sum is kept with compensated (Neumaier) summation and the
+ * variance with Welford's running mean and sum of squared deviations, all in double precision, so
+ * they stay accurate over hundreds of millions of values, also when the values drift. Partial
+ * results, e.g. of parallel shards or different histories, are combined with the parallel update
+ * of Chan et al. in \c Merge(). Optionally, a QuantileSketch
+ * estimates quantiles of all values with bounded memory.
  */
 class AggregatedInfo
 {
   public:
+    /**
+     * \brief Statistics a projection query computes, see \c UpdateEntry(). Flags can be combined
+     * with \c |.
+     */
+    enum Statistic
+    {
+        MIN = 1 << 0,          //!< The minimum, see \c GetMin()
+        MAX = 1 << 1,          //!< The maximum, see \c GetMax()
+        AVG = 1 << 2,          //!< The average, see \c GetAvg()
+        ALL = MIN | MAX | AVG, //!< All of the above
+    };
+
     AggregatedInfo();
 
+    /**
+     * \brief Add the aggregated information of a single data entry. Minimum and maximum are merged,
+     * while the average of \c update counts as one value, so the average is taken over the
+     * averages of the entries. Use \c Merge() to combine the values instead.
+     * \param update the aggregated information to add.
+     */
     void UpdateStatistics(AggregatedInfo update);
 
     void UpdateStatistics(float update);
 
+    /**
+     * \brief Add all values of a contiguous sequence in one pass, using the vectorized kernels of
+     * \c Reduce().
+     * \param values pointer to the first value.
+     * \param count the number of values.
+     */
+    void UpdateStatistics(const float* values, size_t count);
+
+    /**
+     * \copydoc UpdateStatistics(const float*, size_t)
+     */
+    void UpdateStatistics(const double* values, size_t count);
+
+    /**
+     * \copydoc UpdateStatistics(const float*, size_t)
+     *
+     * Instantiated for the signed and unsigned integer types of 8 to 64 bits.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    void UpdateStatistics(const T* values, size_t count);
+
+    /**
+     * \brief Add the values summarized by a reduction. The quantile sketch is not updated, because
+     * a reduction does not contain the individual values.
+     * \param reduction the minimum, maximum, sum, count and squared deviations of the values.
+     */
+    void UpdateStatistics(const Reduction& reduction);
+
+    /**
+     * \brief Add the values of a single data entry like \c UpdateStatistics(AggregatedInfo) does
+     * with the aggregated information of the entry, but only compute the selected statistics. The
+     * others keep their previous values, and the quantile sketch is not updated.
+     * \param values pointer to the first value of the entry.
+     * \param count the number of values, nothing is added if 0.
+     * \param stats the statistics to compute, a combination of \c Statistic flags.
+     */
+    void UpdateEntry(const float* values, size_t count, int stats = ALL);
+
+    /**
+     * \copydoc UpdateEntry(const float*, size_t, int)
+     */
+    void UpdateEntry(const double* values, size_t count, int stats = ALL);
+
+    /**
+     * \copydoc UpdateEntry(const float*, size_t, int)
+     *
+     * Instantiated for the signed and unsigned integer types of 8 to 64 bits.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    void UpdateEntry(const T* values, size_t count, int stats = ALL);
+
+    /**
+     * \brief Combine the values aggregated by another AggregatedInfo with the values of this one,
+     * as if all of them had been added to this AggregatedInfo. Count, sum, mean and variance are
+     * combined exactly, and the quantile sketches are merged if both estimate quantiles.
+     * \param other the aggregated information to merge.
+     */
+    void Merge(const AggregatedInfo& other);
+
     float GetMin() const;
 
     float GetMax() const;
 
     float GetAvg() const;
 
+    /**
+     * \return the number of aggregated values.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * \return the compensated sum of the aggregated values.
+     */
+    double GetSum() const;
+
+    /**
+     * \return the population variance of the aggregated values, or 0 if there are none.
+     */
+    double GetVariance() const;
+
+    /**
+     * \return the population standard deviation of the aggregated values, or 0 if there are none.
+     */
+    double GetStddev() const;
+
+    /**
+     * \brief Start estimating quantiles of all values added from now on. Merging another
+     * AggregatedInfo with \c UpdateStatistics() or \c Merge() merges both sketches if the other
+     * one estimates quantiles as well.
+     * \param k the accuracy parameter of the QuantileSketch.
+     */
+    void EnableQuantiles(uint k = 200);
+
+    /**
+     * \return \c true if quantiles are estimated, \c false otherwise.
+     */
+    bool HasQuantiles() const;
+
+    /**
+     * \brief Estimate a quantile of the added values. Requires \c EnableQuantiles().
+     * \param q the quantile in [0, 1], e.g. 0.95 for the 95th percentile.
+     * \return the estimated quantile.
+     */
+    float GetQuantile(double q) const;
+
     void UpdateMin(float value);
 
     void UpdateMax(float value);
@@ -37,13 +166,41 @@ class AggregatedInfo
     virtual void CustomUpdate(float value, uint index, uint id);
 
   private:
-    float m_min;
-    float m_max;
-    float m_avg;
-    float m_sum;
-    float m_counter;
+    float m_min;                               //!< Smallest value
+    float m_max;                               //!< Largest value
+    uint64_t m_count;                          //!< Number of values
+    double m_mean;                             //!< Running mean of the values
+    double m_m2;                               //!< Sum of the squared deviations from the mean
+    double m_sum;                              //!< Sum of the values
+    double m_compensation;                     //!< Rounding error of \c m_sum
+    std::optional<QuantileSketch> m_quantiles; //!< Quantile estimation, if enabled
+
+    /**
+     * \brief Add a value to the sum, keeping track of the rounding error.
+     * \param value the value to add.
+     */
+    void IncrementSum(double value);
+
+    /**
+     * \brief Combine the moments of a group of values with the moments of this object, see Chan
+     * et al., "Updating Formulae and a Pairwise Algorithm for Computing Sample Variances".
+     * \param count the number of values in the group.
+     * \param mean the mean of the values of the group.
+     * \param m2 the sum of the squared deviations of the values of the group from their mean.
+     */
+    void MergeMoments(uint64_t count, double mean, double m2);
+
+    /**
+     * \brief Add a contiguous sequence of values to the statistics and the quantile sketch.
+     */
+    template <typename T>
+    void UpdateSequence(const T* values, size_t count);
 
-    void IncrementSum(float value);
+    /**
+     * \brief Add selected statistics of the values of a single data entry.
+     */
+    template <typename T>
+    void UpdateEntrySequence(const T* values, size_t count, int stats);
 };
 } // namespace ns3
 #endif
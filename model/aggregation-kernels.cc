@@ -0,0 +1,333 @@
+#include "aggregation-kernels.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DEFIANCE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace ns3
+{
+
+namespace
+{
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+/**
+ * \brief Running state of a reduction. The squared deviations are accumulated with Welford's
+ * update in the same pass as the other statistics.
+ */
+struct Moments
+{
+    double min;   //!< Smallest value so far
+    double max;   //!< Largest value so far
+    double sum;   //!< Sum of the values so far
+    double mean;  //!< Mean of the values so far
+    double m2;    //!< Sum of the squared deviations from the mean so far
+    size_t count; //!< Number of values so far
+};
+
+/**
+ * \brief An empty running state.
+ */
+constexpr Moments kNoMoments{kInfinity, -kInfinity, 0, 0, 0, 0};
+
+/**
+ * \brief Convert the running state into the reduction of the sequence.
+ */
+Reduction
+Finish(const Moments& moments)
+{
+    return {moments.min, moments.max, moments.sum, moments.count, moments.m2};
+}
+
+/**
+ * \brief Combine the mean and squared deviations of a group of values with the running state,
+ * see Chan et al., "Updating Formulae and a Pairwise Algorithm for Computing Sample Variances".
+ */
+void
+MergeMoments(Moments& moments, size_t count, double mean, double m2)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    size_t total = moments.count + count;
+    double delta = mean - moments.mean;
+    moments.mean += delta * count / total;
+    moments.m2 += m2 + delta * delta * moments.count * count / total;
+    moments.count = total;
+}
+
+/**
+ * \brief Reduce the values one at a time. Used for integer types, on non-x86 architectures and
+ * for the tails of the vectorized kernels.
+ */
+template <typename T>
+Moments
+ReduceScalar(const T* values, size_t count, Moments moments)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double value = values[i];
+        moments.min = std::min(moments.min, value);
+        moments.max = std::max(moments.max, value);
+        moments.sum += value;
+        moments.count++;
+        double delta = value - moments.mean;
+        moments.mean += delta / moments.count;
+        moments.m2 += delta * (value - moments.mean);
+    }
+    return moments;
+}
+
+#ifdef DEFIANCE_X86_KERNELS
+
+/**
+ * \brief Combine the lanes of the vector accumulators into the running state. Every lane holds
+ * the Welford state of the same number of values.
+ */
+template <typename T>
+Moments
+CombineLanes(const T* mins,
+             const T* maxs,
+             const double* sums,
+             const double* means,
+             const double* m2s,
+             size_t lanes,
+             size_t laneCount,
+             Moments moments)
+{
+    for (size_t i = 0; i < lanes; i++)
+    {
+        moments.min = std::min(moments.min, static_cast<double>(mins[i]));
+        moments.max = std::max(moments.max, static_cast<double>(maxs[i]));
+        moments.sum += sums[i];
+        MergeMoments(moments, laneCount, means[i], m2s[i]);
+    }
+    return moments;
+}
+
+__attribute__((target("avx2"))) Moments
+ReduceFloatAvx2(const float* values, size_t count, Moments moments)
+{
+    __m256 min = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256 max = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+    __m256d sumLow = _mm256_setzero_pd();
+    __m256d sumHigh = _mm256_setzero_pd();
+    __m256d meanLow = _mm256_setzero_pd();
+    __m256d meanHigh = _mm256_setzero_pd();
+    __m256d m2Low = _mm256_setzero_pd();
+    __m256d m2High = _mm256_setzero_pd();
+    size_t steps = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(values + i);
+        min = _mm256_min_ps(min, x);
+        max = _mm256_max_ps(max, x);
+        __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+        __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+        sumLow = _mm256_add_pd(sumLow, low);
+        sumHigh = _mm256_add_pd(sumHigh, high);
+        // Welford's update of every lane, which all hold the same number of values
+        __m256d inverse = _mm256_set1_pd(1.0 / ++steps);
+        __m256d deltaLow = _mm256_sub_pd(low, meanLow);
+        __m256d deltaHigh = _mm256_sub_pd(high, meanHigh);
+        meanLow = _mm256_add_pd(meanLow, _mm256_mul_pd(deltaLow, inverse));
+        meanHigh = _mm256_add_pd(meanHigh, _mm256_mul_pd(deltaHigh, inverse));
+        m2Low = _mm256_add_pd(m2Low, _mm256_mul_pd(deltaLow, _mm256_sub_pd(low, meanLow)));
+        m2High = _mm256_add_pd(m2High, _mm256_mul_pd(deltaHigh, _mm256_sub_pd(high, meanHigh)));
+    }
+    alignas(32) float mins[8];
+    alignas(32) float maxs[8];
+    alignas(32) double sums[8];
+    alignas(32) double means[8];
+    alignas(32) double m2s[8];
+    _mm256_store_ps(mins, min);
+    _mm256_store_ps(maxs, max);
+    _mm256_store_pd(sums, sumLow);
+    _mm256_store_pd(sums + 4, sumHigh);
+    _mm256_store_pd(means, meanLow);
+    _mm256_store_pd(means + 4, meanHigh);
+    _mm256_store_pd(m2s, m2Low);
+    _mm256_store_pd(m2s + 4, m2High);
+    moments = CombineLanes(mins, maxs, sums, means, m2s, 8, steps, moments);
+    return ReduceScalar(values + i, count - i, moments);
+}
+
+__attribute__((target("avx2"))) Moments
+ReduceDoubleAvx2(const double* values, size_t count, Moments moments)
+{
+    __m256d min = _mm256_set1_pd(kInfinity);
+    __m256d max = _mm256_set1_pd(-kInfinity);
+    __m256d sum = _mm256_setzero_pd();
+    __m256d mean = _mm256_setzero_pd();
+    __m256d m2 = _mm256_setzero_pd();
+    size_t steps = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(values + i);
+        min = _mm256_min_pd(min, x);
+        max = _mm256_max_pd(max, x);
+        sum = _mm256_add_pd(sum, x);
+        __m256d inverse = _mm256_set1_pd(1.0 / ++steps);
+        __m256d delta = _mm256_sub_pd(x, mean);
+        mean = _mm256_add_pd(mean, _mm256_mul_pd(delta, inverse));
+        m2 = _mm256_add_pd(m2, _mm256_mul_pd(delta, _mm256_sub_pd(x, mean)));
+    }
+    alignas(32) double mins[4];
+    alignas(32) double maxs[4];
+    alignas(32) double sums[4];
+    alignas(32) double means[4];
+    alignas(32) double m2s[4];
+    _mm256_store_pd(mins, min);
+    _mm256_store_pd(maxs, max);
+    _mm256_store_pd(sums, sum);
+    _mm256_store_pd(means, mean);
+    _mm256_store_pd(m2s, m2);
+    moments = CombineLanes(mins, maxs, sums, means, m2s, 4, steps, moments);
+    return ReduceScalar(values + i, count - i, moments);
+}
+
+Moments
+ReduceFloatSse2(const float* values, size_t count, Moments moments)
+{
+    __m128 min = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 max = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+    __m128d sumLow = _mm_setzero_pd();
+    __m128d sumHigh = _mm_setzero_pd();
+    __m128d meanLow = _mm_setzero_pd();
+    __m128d meanHigh = _mm_setzero_pd();
+    __m128d m2Low = _mm_setzero_pd();
+    __m128d m2High = _mm_setzero_pd();
+    size_t steps = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(values + i);
+        min = _mm_min_ps(min, x);
+        max = _mm_max_ps(max, x);
+        __m128d low = _mm_cvtps_pd(x);
+        __m128d high = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+        sumLow = _mm_add_pd(sumLow, low);
+        sumHigh = _mm_add_pd(sumHigh, high);
+        __m128d inverse = _mm_set1_pd(1.0 / ++steps);
+        __m128d deltaLow = _mm_sub_pd(low, meanLow);
+        __m128d deltaHigh = _mm_sub_pd(high, meanHigh);
+        meanLow = _mm_add_pd(meanLow, _mm_mul_pd(deltaLow, inverse));
+        meanHigh = _mm_add_pd(meanHigh, _mm_mul_pd(deltaHigh, inverse));
+        m2Low = _mm_add_pd(m2Low, _mm_mul_pd(deltaLow, _mm_sub_pd(low, meanLow)));
+        m2High = _mm_add_pd(m2High, _mm_mul_pd(deltaHigh, _mm_sub_pd(high, meanHigh)));
+    }
+    alignas(16) float mins[4];
+    alignas(16) float maxs[4];
+    alignas(16) double sums[4];
+    alignas(16) double means[4];
+    alignas(16) double m2s[4];
+    _mm_store_ps(mins, min);
+    _mm_store_ps(maxs, max);
+    _mm_store_pd(sums, sumLow);
+    _mm_store_pd(sums + 2, sumHigh);
+    _mm_store_pd(means, meanLow);
+    _mm_store_pd(means + 2, meanHigh);
+    _mm_store_pd(m2s, m2Low);
+    _mm_store_pd(m2s + 2, m2High);
+    moments = CombineLanes(mins, maxs, sums, means, m2s, 4, steps, moments);
+    return ReduceScalar(values + i, count - i, moments);
+}
+
+Moments
+ReduceDoubleSse2(const double* values, size_t count, Moments moments)
+{
+    __m128d min = _mm_set1_pd(kInfinity);
+    __m128d max = _mm_set1_pd(-kInfinity);
+    __m128d sum = _mm_setzero_pd();
+    __m128d mean = _mm_setzero_pd();
+    __m128d m2 = _mm_setzero_pd();
+    size_t steps = 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(values + i);
+        min = _mm_min_pd(min, x);
+        max = _mm_max_pd(max, x);
+        sum = _mm_add_pd(sum, x);
+        __m128d inverse = _mm_set1_pd(1.0 / ++steps);
+        __m128d delta = _mm_sub_pd(x, mean);
+        mean = _mm_add_pd(mean, _mm_mul_pd(delta, inverse));
+        m2 = _mm_add_pd(m2, _mm_mul_pd(delta, _mm_sub_pd(x, mean)));
+    }
+    alignas(16) double mins[2];
+    alignas(16) double maxs[2];
+    alignas(16) double sums[2];
+    alignas(16) double means[2];
+    alignas(16) double m2s[2];
+    _mm_store_pd(mins, min);
+    _mm_store_pd(maxs, max);
+    _mm_store_pd(sums, sum);
+    _mm_store_pd(means, mean);
+    _mm_store_pd(m2s, m2);
+    moments = CombineLanes(mins, maxs, sums, means, m2s, 2, steps, moments);
+    return ReduceScalar(values + i, count - i, moments);
+}
+
+/**
+ * \return \c true if the CPU supports AVX2. Evaluated once.
+ */
+bool
+HasAvx2()
+{
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+}
+
+#endif
+
+} // namespace
+
+Reduction
+Reduce(const float* values, size_t count)
+{
+    Moments moments = kNoMoments;
+#ifdef DEFIANCE_X86_KERNELS
+    return Finish(HasAvx2() ? ReduceFloatAvx2(values, count, moments)
+                            : ReduceFloatSse2(values, count, moments));
+#else
+    return Finish(ReduceScalar(values, count, moments));
+#endif
+}
+
+Reduction
+Reduce(const double* values, size_t count)
+{
+    Moments moments = kNoMoments;
+#ifdef DEFIANCE_X86_KERNELS
+    return Finish(HasAvx2() ? ReduceDoubleAvx2(values, count, moments)
+                            : ReduceDoubleSse2(values, count, moments));
+#else
+    return Finish(ReduceScalar(values, count, moments));
+#endif
+}
+
+template <typename T, typename>
+Reduction
+Reduce(const T* values, size_t count)
+{
+    return Finish(ReduceScalar(values, count, kNoMoments));
+}
+
+template Reduction Reduce(const int8_t* values, size_t count);
+template Reduction Reduce(const int16_t* values, size_t count);
+template Reduction Reduce(const int32_t* values, size_t count);
+template Reduction Reduce(const int64_t* values, size_t count);
+template Reduction Reduce(const uint8_t* values, size_t count);
+template Reduction Reduce(const uint16_t* values, size_t count);
+template Reduction Reduce(const uint32_t* values, size_t count);
+template Reduction Reduce(const uint64_t* values, size_t count);
+
+} // namespace ns3
@@ -0,0 +1,58 @@
+#ifndef AGGREGATION_KERNELS_H
+#define AGGREGATION_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \brief Minimum, maximum, sum, count and squared deviations of a sequence of values.
+ */
+struct Reduction
+{
+    double min;   //!< Smallest value, +infinity for an empty sequence
+    double max;   //!< Largest value, -infinity for an empty sequence
+    double sum;   //!< Sum of all values
+    size_t count; //!< Number of values
+    double m2;    //!< Sum of the squared deviations of the values from their mean
+};
+
+/**
+ * \ingroup defiance
+ * \brief Reduce a sequence of values to its minimum, maximum, sum, count and squared deviations.
+ *
+ * On x86-64, the \c float and \c double kernels use AVX2 if the CPU supports it and SSE2
+ * otherwise. The selection happens once at runtime, so no special compiler flags are needed. On
+ * other architectures and for integer types, a scalar loop is used. Sums are accumulated in double
+ * precision. The squared deviations are accumulated in the same pass with Welford's update, one
+ * running mean per vector lane, and the lanes are combined with the parallel update of Chan et al.,
+ * so they stay accurate for long and drifting sequences.
+ *
+ * \param values pointer to the first value.
+ * \param count the number of values.
+ * \return the reduction of the values.
+ */
+Reduction Reduce(const float* values, size_t count);
+
+/**
+ * \ingroup defiance
+ * \copydoc Reduce(const float*, size_t)
+ */
+Reduction Reduce(const double* values, size_t count);
+
+/**
+ * \ingroup defiance
+ * \copydoc Reduce(const float*, size_t)
+ *
+ * Instantiated for the signed and unsigned integer types of 8 to 64 bits.
+ */
+template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+Reduction Reduce(const T* values, size_t count);
+
+} // namespace ns3
+
+#endif
@@ -8,7 +8,13 @@ namespace ns3
 Ptr<OpenGymDictContainer>
 MakeDictContainer(std::string key, Ptr<OpenGymDataContainer> data)
 {
-    auto dictContainer = CreateObject<OpenGymDictContainer>();
+    return MakeDictContainer(KeyRegistry::Intern(key), data);
+}
+
+Ptr<OpenGymDictContainer>
+MakeDictContainer(KeyId key, Ptr<OpenGymDataContainer> data)
+{
+    auto dictContainer = CreateObject<InternedDictContainer>();
     dictContainer->Add(key, data);
     return dictContainer;
 }
@@ -3,6 +3,7 @@
 
 #include "action-application.h"
 #include "agent-application.h"
+#include "key-registry.h"
 #include "observation-application.h"
 #include "reward-application.h"
 
@@ -16,6 +17,15 @@ namespace ns3
 {
 Ptr<OpenGymDictContainer> MakeDictContainer(std::string key, Ptr<OpenGymDataContainer> data);
 
+/**
+ * \brief Create a dictionary holding a single value under an interned key, which consumers resolve
+ * without touching the key string, see InternedDictContainer.
+ * \param key the id of the key, see KeyRegistry::Intern().
+ * \param data the value.
+ * \return the dictionary.
+ */
+Ptr<OpenGymDictContainer> MakeDictContainer(KeyId key, Ptr<OpenGymDataContainer> data);
+
 template <typename T>
 Ptr<OpenGymBoxContainer<T>>
 MakeBoxContainer(uint32_t shape)
@@ -61,6 +71,13 @@ MakeDictBoxContainer(uint32_t shape, std::string key, Params... params)
     return MakeDictContainer(key, MakeBoxContainer<T>(shape, params...));
 }
 
+template <class T, class... Params>
+Ptr<OpenGymDictContainer>
+MakeDictBoxContainer(uint32_t shape, KeyId key, Params... params)
+{
+    return MakeDictContainer(key, MakeBoxContainer<T>(shape, params...));
+}
+
 /**
  * \ingroup defiance-tests
  * \class RlAppBaseTestCase
@@ -0,0 +1,112 @@
+#include "box-visitor.h"
+
+#include <functional>
+#include <numeric>
+#include <string>
+#include <typeinfo>
+
+namespace ns3
+{
+
+BoxDtype
+GetBoxDtype(const OpenGymDataContainer* data)
+{
+    if (!data)
+    {
+        return BoxDtype::NONE;
+    }
+    // the dynamic type is read once and compared with the exact box types, most common first
+    const std::type_info& type = typeid(*data);
+    if (type == typeid(OpenGymBoxContainer<float>))
+    {
+        return BoxDtype::FLOAT;
+    }
+    if (type == typeid(OpenGymBoxContainer<double>))
+    {
+        return BoxDtype::DOUBLE;
+    }
+    if (type == typeid(OpenGymBoxContainer<int32_t>))
+    {
+        return BoxDtype::INT32;
+    }
+    if (type == typeid(OpenGymBoxContainer<uint32_t>))
+    {
+        return BoxDtype::UINT32;
+    }
+    if (type == typeid(OpenGymBoxContainer<int64_t>))
+    {
+        return BoxDtype::INT64;
+    }
+    if (type == typeid(OpenGymBoxContainer<uint64_t>))
+    {
+        return BoxDtype::UINT64;
+    }
+    if (type == typeid(OpenGymBoxContainer<int16_t>))
+    {
+        return BoxDtype::INT16;
+    }
+    if (type == typeid(OpenGymBoxContainer<uint16_t>))
+    {
+        return BoxDtype::UINT16;
+    }
+    if (type == typeid(OpenGymBoxContainer<int8_t>))
+    {
+        return BoxDtype::INT8;
+    }
+    if (type == typeid(OpenGymBoxContainer<uint8_t>))
+    {
+        return BoxDtype::UINT8;
+    }
+    return BoxDtype::NONE;
+}
+
+size_t
+GetContainerSize(Ptr<OpenGymDataContainer> data)
+{
+    if (!data)
+    {
+        return 0;
+    }
+    size_t size = 0;
+    bool isBox = VisitBox(data, [&size](auto* box) {
+        // the number of values follows from the shape, so the values are not copied
+        std::vector<uint32_t> shape = box->GetShape();
+        size_t count =
+            std::accumulate(shape.begin(), shape.end(), size_t{1}, std::multiplies<size_t>());
+        size = sizeof(*box) + count * sizeof(decltype(box->GetValue(0))) +
+               shape.size() * sizeof(uint32_t);
+    });
+    if (isBox)
+    {
+        return size;
+    }
+    if (auto interned = DynamicCast<InternedDictContainer>(data))
+    {
+        return GetContainerSize(interned->GetEntries());
+    }
+    auto dict = DynamicCast<OpenGymDictContainer>(data);
+    if (!dict)
+    {
+        return sizeof(OpenGymDataContainer);
+    }
+    // other dictionaries only enumerate their keys by copying them
+    size = sizeof(OpenGymDictContainer);
+    for (const auto& key : dict->GetKeys())
+    {
+        size += sizeof(std::string) + key.size() + GetContainerSize(dict->Get(key));
+    }
+    return size;
+}
+
+size_t
+GetContainerSize(const std::vector<DictKeyCache::Entry>& entries)
+{
+    size_t size = sizeof(OpenGymDictContainer);
+    for (const auto& [key, value] : entries)
+    {
+        size += sizeof(std::string) + KeyRegistry::GetKey(key).size() + GetContainerSize(value);
+    }
+    return size;
+}
+
+} // namespace ns3
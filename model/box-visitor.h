@@ -0,0 +1,140 @@
+#ifndef BOX_VISITOR_H
+#define BOX_VISITOR_H
+
+#include "key-registry.h"
+
+#include <ns3/ai-module.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \brief Element type of an OpenGymBoxContainer, see \c GetBoxDtype().
+ */
+enum class BoxDtype : uint8_t
+{
+    NONE, //!< Not a box of a supported element type
+    INT8,
+    INT16,
+    INT32,
+    INT64,
+    UINT8,
+    UINT16,
+    UINT32,
+    UINT64,
+    FLOAT,
+    DOUBLE,
+};
+
+/**
+ * \ingroup defiance
+ * \brief Determine the element type of a box with a single lookup of its dynamic type, instead of
+ * trying a cast to every OpenGymBoxContainer instantiation in turn.
+ * \param data the container to inspect, may be \c nullptr.
+ * \return the element type, or \c BoxDtype::NONE if \c data is not a box of a supported element
+ * type.
+ */
+BoxDtype GetBoxDtype(const OpenGymDataContainer* data);
+
+/**
+ * \ingroup defiance
+ * \copydoc GetBoxDtype(const OpenGymDataContainer*)
+ */
+inline BoxDtype
+GetBoxDtype(Ptr<OpenGymDataContainer> data)
+{
+    return GetBoxDtype(PeekPointer(data));
+}
+
+/**
+ * \ingroup defiance
+ * \brief Estimate the bytes of memory a container occupies, e.g. to account the data entries of a
+ * HistoryContainer against a MemoryBudget. Boxes count their object, values and shape, and
+ * dictionaries count their object, keys and the estimates of their values. Other containers
+ * count their base object only.
+ * \param data the container to estimate, may be \c nullptr.
+ * \return the estimated number of bytes, 0 for \c nullptr.
+ */
+size_t GetContainerSize(Ptr<OpenGymDataContainer> data);
+
+/**
+ * \ingroup defiance
+ * \brief Estimate the bytes of memory a dictionary occupies from its resolved values, like
+ * \c GetContainerSize(Ptr<OpenGymDataContainer>). The key lengths are read from the KeyRegistry,
+ * so the keys of the dictionary are not copied.
+ * \param entries the resolved values of the dictionary, see DictKeyCache::Resolve().
+ * \return the estimated number of bytes.
+ */
+size_t GetContainerSize(const std::vector<DictKeyCache::Entry>& entries);
+
+/**
+ * \ingroup defiance
+ * \brief Call a function with a box, cast to the OpenGymBoxContainer of its element type. The
+ * function is instantiated for every supported element type, so it can call the templated
+ * kernels, e.g. \c AggregatedInfo::UpdateStatistics(), with the right type.
+ * \param data the container holding the box.
+ * \param function called with an \c OpenGymBoxContainer<T>* pointing to the box.
+ * \return \c true if \c data is a box of a supported element type, \c false otherwise.
+ */
+template <typename F>
+bool
+VisitBox(OpenGymDataContainer* data, F&& function)
+{
+    switch (GetBoxDtype(data))
+    {
+    case BoxDtype::INT8:
+        function(static_cast<OpenGymBoxContainer<int8_t>*>(data));
+        break;
+    case BoxDtype::INT16:
+        function(static_cast<OpenGymBoxContainer<int16_t>*>(data));
+        break;
+    case BoxDtype::INT32:
+        function(static_cast<OpenGymBoxContainer<int32_t>*>(data));
+        break;
+    case BoxDtype::INT64:
+        function(static_cast<OpenGymBoxContainer<int64_t>*>(data));
+        break;
+    case BoxDtype::UINT8:
+        function(static_cast<OpenGymBoxContainer<uint8_t>*>(data));
+        break;
+    case BoxDtype::UINT16:
+        function(static_cast<OpenGymBoxContainer<uint16_t>*>(data));
+        break;
+    case BoxDtype::UINT32:
+        function(static_cast<OpenGymBoxContainer<uint32_t>*>(data));
+        break;
+    case BoxDtype::UINT64:
+        function(static_cast<OpenGymBoxContainer<uint64_t>*>(data));
+        break;
+    case BoxDtype::FLOAT:
+        function(static_cast<OpenGymBoxContainer<float>*>(data));
+        break;
+    case BoxDtype::DOUBLE:
+        function(static_cast<OpenGymBoxContainer<double>*>(data));
+        break;
+    case BoxDtype::NONE:
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \ingroup defiance
+ * \copydoc VisitBox(OpenGymDataContainer*, F&&)
+ */
+template <typename F>
+bool
+VisitBox(Ptr<OpenGymDataContainer> data, F&& function)
+{
+    return VisitBox(PeekPointer(data), std::forward<F>(function));
+}
+
+} // namespace ns3
+
+#endif
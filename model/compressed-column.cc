@@ -0,0 +1,261 @@
+#include "compressed-column.h"
+
+#include <ns3/log.h>
+
+#include <climits>
+#include <cstring>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CompressedColumn");
+
+namespace
+{
+
+constexpr uint8_t kNoWindow = 0xff; //!< Marks that no XOR of a value was stored in a block yet
+
+/**
+ * \brief Append bits to a bit stream.
+ * \param words the words of the stream.
+ * \param bits the number of bits in the stream, increased by \c count.
+ * \param value the bits to append, least significant bit first.
+ * \param count the number of bits to append, at most 32.
+ */
+void
+WriteBits(std::vector<uint64_t>& words, uint64_t& bits, uint64_t value, uint count)
+{
+    value &= (uint64_t{1} << count) - 1;
+    uint offset = bits % 64;
+    if (offset == 0)
+    {
+        words.push_back(value);
+    }
+    else
+    {
+        words.back() |= value << offset;
+        if (offset + count > 64)
+        {
+            words.push_back(value >> (64 - offset));
+        }
+    }
+    bits += count;
+}
+
+/**
+ * \brief Read bits from a bit stream.
+ * \param words the words of the stream.
+ * \param position the position to read from, increased by \c count.
+ * \param count the number of bits to read, at most 32.
+ * \return the bits, least significant bit first.
+ */
+uint64_t
+ReadBits(const std::vector<uint64_t>& words, uint64_t& position, uint count)
+{
+    uint64_t word = position / 64;
+    uint offset = position % 64;
+    uint64_t value = words[word] >> offset;
+    if (offset + count > 64)
+    {
+        value |= words[word + 1] << (64 - offset);
+    }
+    position += count;
+    return value & ((uint64_t{1} << count) - 1);
+}
+
+} // namespace
+
+CompressedColumn::CompressedColumn(uint capacity, uint rowLength, uint keyframeInterval)
+    : m_rowLength(rowLength),
+      m_interval(keyframeInterval),
+      m_blocks(keyframeInterval > 0 ? capacity / keyframeInterval : 0),
+      m_encoderBlock(UINT_MAX),
+      m_row(rowLength),
+      m_cachedBlock(UINT_MAX),
+      m_cache(static_cast<size_t>(keyframeInterval) * rowLength)
+{
+    NS_ASSERT_MSG(keyframeInterval > 0 && capacity % keyframeInterval == 0,
+                  "The capacity has to be a multiple of the keyframe interval");
+    ResetState(m_encoder);
+    ResetState(m_decoder);
+}
+
+void
+CompressedColumn::ResetState(State& state) const
+{
+    state.previous.assign(m_rowLength, 0);
+    state.leading.assign(m_rowLength, kNoWindow);
+    state.trailing.assign(m_rowLength, kNoWindow);
+}
+
+void
+CompressedColumn::Store(uint slot, const float* values)
+{
+    uint blockIndex = slot / m_interval;
+    uint row = slot % m_interval;
+    NS_ASSERT_MSG(blockIndex < m_blocks.size(), "No slot " << slot << " in the column");
+    Block& block = m_blocks[blockIndex];
+    if (row == 0)
+    {
+        // restart the block, keeping the memory of its stream
+        block.words.clear();
+        block.bits = 0;
+        block.rowStarts.clear();
+        ResetState(m_encoder);
+    }
+    else if (m_encoderBlock != blockIndex || block.rowStarts.size() != row)
+    {
+        Resume(blockIndex, row);
+    }
+    std::memcpy(m_row.data(), values, m_rowLength * sizeof(float));
+    Encode(block, m_row.data(), m_encoder);
+    m_encoderBlock = blockIndex;
+    if (m_cachedBlock == blockIndex)
+    {
+        m_cachedBlock = UINT_MAX;
+    }
+}
+
+void
+CompressedColumn::Resume(uint blockIndex, uint row)
+{
+    Block& block = m_blocks[blockIndex];
+    if (block.rowStarts.size() > row)
+    {
+        block.bits = block.rowStarts[row];
+        block.rowStarts.resize(row);
+        block.words.resize((block.bits + 63) / 64);
+        if (block.bits % 64 != 0)
+        {
+            block.words.back() &= (uint64_t{1} << (block.bits % 64)) - 1;
+        }
+    }
+    Decode(block, block.rowStarts.size(), nullptr, m_encoder);
+    if (block.rowStarts.empty())
+    {
+        // the keyframe slot was never written, e.g. because the deque started in the middle
+        Encode(block, m_encoder.previous.data(), m_encoder);
+    }
+    while (block.rowStarts.size() < row)
+    {
+        m_row = m_encoder.previous;
+        Encode(block, m_row.data(), m_encoder);
+    }
+}
+
+void
+CompressedColumn::Encode(Block& block, const uint32_t* values, State& state)
+{
+    bool keyframe = block.rowStarts.empty();
+    block.rowStarts.push_back(block.bits);
+    for (uint i = 0; i < m_rowLength; i++)
+    {
+        if (keyframe)
+        {
+            WriteBits(block.words, block.bits, values[i], 32);
+            state.previous[i] = values[i];
+            continue;
+        }
+
+        uint32_t x = values[i] ^ state.previous[i];
+        state.previous[i] = values[i];
+        if (x == 0)
+        {
+            WriteBits(block.words, block.bits, 0, 1);
+            continue;
+        }
+        WriteBits(block.words, block.bits, 1, 1);
+        uint8_t leading = __builtin_clz(x);
+        uint8_t trailing = __builtin_ctz(x);
+        if (state.leading[i] != kNoWindow && leading >= state.leading[i] &&
+            trailing >= state.trailing[i])
+        {
+            // the differing bits fit into the window of the previous XOR
+            WriteBits(block.words, block.bits, 0, 1);
+            uint length = 32 - state.leading[i] - state.trailing[i];
+            WriteBits(block.words, block.bits, x >> state.trailing[i], length);
+        }
+        else
+        {
+            uint length = 32 - leading - trailing;
+            WriteBits(block.words, block.bits, 1, 1);
+            WriteBits(block.words, block.bits, leading, 5);
+            WriteBits(block.words, block.bits, length - 1, 5);
+            WriteBits(block.words, block.bits, x >> trailing, length);
+            state.leading[i] = leading;
+            state.trailing[i] = trailing;
+        }
+    }
+}
+
+void
+CompressedColumn::Decode(const Block& block, uint rows, float* output, State& state) const
+{
+    ResetState(state);
+    uint64_t position = 0;
+    for (uint row = 0; row < rows; row++)
+    {
+        for (uint i = 0; i < m_rowLength; i++)
+        {
+            if (row == 0)
+            {
+                state.previous[i] = ReadBits(block.words, position, 32);
+            }
+            else if (ReadBits(block.words, position, 1) == 1)
+            {
+                if (ReadBits(block.words, position, 1) == 1)
+                {
+                    state.leading[i] = ReadBits(block.words, position, 5);
+                    uint length = ReadBits(block.words, position, 5) + 1;
+                    state.trailing[i] = 32 - state.leading[i] - length;
+                }
+                uint length = 32 - state.leading[i] - state.trailing[i];
+                uint32_t x = ReadBits(block.words, position, length) << state.trailing[i];
+                state.previous[i] ^= x;
+            }
+        }
+        if (output)
+        {
+            std::memcpy(output + static_cast<size_t>(row) * m_rowLength,
+                        state.previous.data(),
+                        m_rowLength * sizeof(float));
+        }
+    }
+}
+
+const float*
+CompressedColumn::GetRow(uint slot) const
+{
+    uint blockIndex = slot / m_interval;
+    uint row = slot % m_interval;
+    const Block& block = m_blocks[blockIndex];
+    NS_ASSERT_MSG(row < block.rowStarts.size(), "Slot " << slot << " was not written");
+    if (m_cachedBlock != blockIndex)
+    {
+        Decode(block, block.rowStarts.size(), m_cache.data(), m_decoder);
+        m_cachedBlock = blockIndex;
+    }
+    return m_cache.data() + static_cast<size_t>(row) * m_rowLength;
+}
+
+uint
+CompressedColumn::GetRowLength() const
+{
+    return m_rowLength;
+}
+
+uint
+CompressedColumn::GetKeyframeInterval() const
+{
+    return m_interval;
+}
+
+size_t
+CompressedColumn::GetEncodedSize() const
+{
+    size_t size = 0;
+    for (const auto& block : m_blocks)
+    {
+        size += (block.bits + 7) / 8;
+    }
+    return size;
+}
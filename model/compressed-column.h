@@ -0,0 +1,133 @@
+#ifndef COMPRESSED_COLUMN_H
+#define COMPRESSED_COLUMN_H
+
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class CompressedColumn
+ * \brief XOR-compressed storage for rows of floats, following the value encoding of Facebook's
+ * Gorilla time series database.
+ *
+ * The slots are grouped into blocks of \c keyframeInterval consecutive slots. The first row of a
+ * block is a keyframe stored verbatim, every following value is XORed with the value at the same
+ * position of the previous row. Unchanged values then take a single bit, and slightly changed
+ * values only store the bits that differ, which suits observations that change little from one
+ * entry to the next. Rows have to be written in slot order within a block, which is how a ring
+ * buffer fills its slots, and a block is restarted when its first slot is written again.
+ *
+ * Reading a row decodes its whole block once into a cache, so scanning the rows of a block in any
+ * order costs the same as reading uncompressed rows.
+ */
+class CompressedColumn
+{
+  public:
+    /**
+     * \brief Creates a new column.
+     * \param capacity the number of rows, which has to be a multiple of \c keyframeInterval.
+     * \param rowLength the number of values per row.
+     * \param keyframeInterval the number of rows per block.
+     */
+    CompressedColumn(uint capacity, uint rowLength, uint keyframeInterval);
+
+    /**
+     * \brief Encode the values of a row. If the previous slot of the block was not the last one
+     * written, the block is truncated or padded with copies of the last written row first.
+     * \param slot the slot to write.
+     * \param values the \c GetRowLength() values of the row.
+     */
+    void Store(uint slot, const float* values);
+
+    /**
+     * \brief Decode a row.
+     * \param slot the slot to read, which has to be written before.
+     * \return a pointer to the values, valid until this column is accessed again.
+     */
+    const float* GetRow(uint slot) const;
+
+    /**
+     * \return the number of values per row.
+     */
+    uint GetRowLength() const;
+
+    /**
+     * \return the number of rows per block.
+     */
+    uint GetKeyframeInterval() const;
+
+    /**
+     * \return the number of bytes of the encoded rows.
+     */
+    size_t GetEncodedSize() const;
+
+  private:
+    /**
+     * \brief The encoded rows of consecutive slots.
+     */
+    struct Block
+    {
+        std::vector<uint64_t> words;     //!< Bit stream, least significant bit first
+        uint64_t bits = 0;               //!< Number of bits written to the stream
+        std::vector<uint64_t> rowStarts; //!< Bit position of each encoded row
+    };
+
+    /**
+     * \brief The state needed to encode or decode the row after the previous one.
+     */
+    struct State
+    {
+        std::vector<uint32_t> previous; //!< Bits of each value of the previous row
+        std::vector<uint8_t> leading;   //!< Leading zeros of the last stored XOR of each value
+        std::vector<uint8_t> trailing;  //!< Trailing zeros of the last stored XOR of each value
+    };
+
+    uint m_rowLength;            //!< Number of values per row
+    uint m_interval;             //!< Number of rows per block
+    std::vector<Block> m_blocks; //!< Encoded rows of all blocks
+    uint m_encoderBlock;         //!< Block that \c m_encoder belongs to
+    State m_encoder;             //!< State after the last row written to \c m_encoderBlock
+    std::vector<uint32_t> m_row; //!< Bits of the row being stored
+
+    mutable uint m_cachedBlock;         //!< Block decoded into \c m_cache
+    mutable std::vector<float> m_cache; //!< Decoded rows of \c m_cachedBlock
+    mutable State m_decoder;            //!< State used while decoding into \c m_cache
+
+    /**
+     * \brief Append a row to a block.
+     * \param block the block.
+     * \param values the bits of the values of the row.
+     * \param state the state after the previous row of the block, updated to the new row.
+     */
+    void Encode(Block& block, const uint32_t* values, State& state);
+
+    /**
+     * \brief Decode the first rows of a block.
+     * \param block the block.
+     * \param rows the number of rows to decode.
+     * \param output receives the values of the rows, back to back, if not \c nullptr.
+     * \param state the state after the last decoded row.
+     */
+    void Decode(const Block& block, uint rows, float* output, State& state) const;
+
+    /**
+     * \brief Make \c m_encoder continue a block at a row, truncating or padding the block.
+     * \param blockIndex the index of the block.
+     * \param row the row to write next, larger than 0.
+     */
+    void Resume(uint blockIndex, uint row);
+
+    /**
+     * \brief Reset a state to the one before a keyframe.
+     * \param state the state.
+     */
+    void ResetState(State& state) const;
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,410 @@
+#include "history-column.h"
+
+#include "box-visitor.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HistoryColumn");
+
+namespace
+{
+
+/**
+ * \brief Copy the values of a box of element type \c T into a column row.
+ * \param data the container holding the box.
+ * \param values the column storage.
+ * \param offset the index of the first value of the row.
+ * \param rowLength the number of values per row.
+ * \return \c true if \c data is a box of type \c T with \c rowLength values, \c false otherwise.
+ */
+template <typename T>
+bool
+CopyBox(Ptr<OpenGymDataContainer> data, std::vector<T>& values, size_t offset, uint rowLength)
+{
+    auto box = DynamicCast<OpenGymBoxContainer<T>>(data);
+    if (!box)
+    {
+        return false;
+    }
+    auto boxData = box->GetData();
+    if (boxData.size() != rowLength)
+    {
+        return false;
+    }
+    std::copy(boxData.begin(), boxData.end(), values.begin() + offset);
+    return true;
+}
+
+/**
+ * \brief Read the shape of a box of element type \c T.
+ * \param data the container holding the box.
+ * \param shape set to the shape of the box.
+ * \return \c true if \c data is a box of type \c T, \c false otherwise.
+ */
+template <typename T>
+bool
+GetBoxShape(Ptr<OpenGymDataContainer> data, std::vector<uint32_t>& shape)
+{
+    auto box = DynamicCast<OpenGymBoxContainer<T>>(data);
+    if (!box)
+    {
+        return false;
+    }
+    shape = box->GetShape();
+    return true;
+}
+
+} // namespace
+
+HistoryColumn::HistoryColumn(uint capacity,
+                             Dtype dtype,
+                             uint rowLength,
+                             uint keyframeInterval,
+                             uint paddingRows)
+    : m_dtype(dtype),
+      m_rowLength(rowLength),
+      m_valid(capacity, 0),
+      m_keyframeInterval(keyframeInterval),
+      m_hasShape(false),
+      m_paddingRows(paddingRows)
+{
+    NS_ASSERT_MSG(paddingRows == 0 || keyframeInterval == 0,
+                  "Padding rows require an uncompressed column");
+    NS_ASSERT_MSG(paddingRows <= capacity, "More mirrored rows than slots");
+    size_t size = (static_cast<size_t>(capacity) + 2 * paddingRows) * rowLength;
+    switch (dtype)
+    {
+    case FLOAT:
+        m_frames = std::vector<float>();
+        if (keyframeInterval > 0)
+        {
+            m_values = std::vector<float>();
+            m_compressed.emplace(capacity, rowLength, keyframeInterval);
+            m_shifted.resize(static_cast<size_t>(keyframeInterval) * rowLength);
+            break;
+        }
+        m_values = std::vector<float>(size);
+        break;
+    case DOUBLE:
+        m_values = std::vector<double>(size);
+        m_frames = std::vector<double>();
+        break;
+    case INT32:
+        m_values = std::vector<int32_t>(size);
+        m_frames = std::vector<int32_t>();
+        break;
+    case UINT32:
+        m_values = std::vector<uint32_t>(size);
+        m_frames = std::vector<uint32_t>();
+        break;
+    }
+}
+
+bool
+HistoryColumn::GetLayout(Ptr<OpenGymDataContainer> data, Dtype& dtype, uint& rowLength)
+{
+    switch (GetBoxDtype(data))
+    {
+    case BoxDtype::FLOAT:
+        dtype = FLOAT;
+        break;
+    case BoxDtype::DOUBLE:
+        dtype = DOUBLE;
+        break;
+    case BoxDtype::INT32:
+        dtype = INT32;
+        break;
+    case BoxDtype::UINT32:
+        dtype = UINT32;
+        break;
+    default:
+        // boxes of other element types are only kept in the dictionaries
+        return false;
+    }
+    VisitBox(data, [&rowLength](auto* box) { rowLength = box->GetData().size(); });
+    return true;
+}
+
+bool
+HistoryColumn::Store(uint slot, Ptr<OpenGymDataContainer> data)
+{
+    m_valid[slot] = 0;
+    if (m_keyframeInterval > 0)
+    {
+        // boxes are restored with the shape of the first box, so all boxes need that shape
+        std::vector<uint32_t> shape;
+        bool isBox = std::visit(
+            [&](const auto& values) {
+                using T = typename std::decay_t<decltype(values)>::value_type;
+                return GetBoxShape<T>(data, shape);
+            },
+            m_values);
+        if (!isBox || (m_hasShape && shape != m_shape))
+        {
+            return false;
+        }
+        if (!m_hasShape)
+        {
+            m_shape = shape;
+            m_hasShape = true;
+        }
+    }
+
+    if (m_compressed)
+    {
+        auto box = DynamicCast<OpenGymBoxContainer<float>>(data);
+        auto boxData = box->GetData();
+        if (boxData.size() != m_rowLength)
+        {
+            return false;
+        }
+        m_compressed->Store(slot, boxData.data());
+        m_valid[slot] = 1;
+        return true;
+    }
+
+    bool stored = std::visit(
+        [&](auto& values) {
+            if (!CopyBox(data, values, GetOffset(slot), m_rowLength))
+            {
+                return false;
+            }
+            if (slot < m_paddingRows)
+            {
+                // mirror the row behind the last slot, so that blocks wrapping around stay
+                // contiguous
+                auto row = values.begin() + GetOffset(slot);
+                auto mirror = values.begin() + GetOffset(m_valid.size() + slot);
+                std::copy(row, row + m_rowLength, mirror);
+            }
+            return true;
+        },
+        m_values);
+    m_valid[slot] = stored;
+    return stored;
+}
+
+bool
+HistoryColumn::SetPadding(Ptr<OpenGymDataContainer> data)
+{
+    if (m_compressed)
+    {
+        return false;
+    }
+    return std::visit(
+        [&](auto& values) {
+            for (uint row = 0; row < m_paddingRows; row++)
+            {
+                if (!CopyBox(data, values, static_cast<size_t>(row) * m_rowLength, m_rowLength))
+                {
+                    return false;
+                }
+            }
+            return true;
+        },
+        m_values);
+}
+
+void
+HistoryColumn::Invalidate(uint slot)
+{
+    m_valid[slot] = 0;
+}
+
+bool
+HistoryColumn::IsValid(uint slot) const
+{
+    return m_valid[slot];
+}
+
+void
+HistoryColumn::Relayout(uint capacity, const std::vector<uint>& slots)
+{
+    NS_ASSERT_MSG(slots.size() <= capacity, "More slots to keep than the new capacity");
+    std::vector<uint8_t> valid(capacity, 0);
+    if (m_compressed)
+    {
+        // the rows are encoded relative to each other, so they are encoded again in the new order
+        CompressedColumn relaid(capacity, m_rowLength, m_keyframeInterval);
+        for (uint i = 0; i < slots.size(); i++)
+        {
+            if (m_valid[slots[i]])
+            {
+                relaid.Store(i, m_compressed->GetRow(slots[i]));
+                valid[i] = 1;
+            }
+        }
+        m_compressed = std::move(relaid);
+        m_valid.swap(valid);
+        return;
+    }
+    NS_ASSERT_MSG(m_paddingRows <= capacity, "More mirrored rows than slots");
+    std::visit(
+        [&](auto& values) {
+            size_t padding = static_cast<size_t>(m_paddingRows) * m_rowLength;
+            std::decay_t<decltype(values)> relaid(
+                (static_cast<size_t>(capacity) + 2 * m_paddingRows) * m_rowLength);
+            std::copy(values.begin(), values.begin() + padding, relaid.begin());
+            for (uint i = 0; i < slots.size(); i++)
+            {
+                auto row = values.begin() + GetOffset(slots[i]);
+                std::copy(row, row + m_rowLength, relaid.begin() + padding + i * m_rowLength);
+                valid[i] = m_valid[slots[i]];
+            }
+            // mirror the first rows behind the last slot again
+            auto mirror = relaid.begin() + padding + static_cast<size_t>(capacity) * m_rowLength;
+            std::copy(relaid.begin() + padding, relaid.begin() + 2 * padding, mirror);
+            values.swap(relaid);
+        },
+        m_values);
+    m_valid.swap(valid);
+}
+
+void
+HistoryColumn::ShiftBack(uint slot, uint count)
+{
+    uint capacity = m_valid.size();
+    if (m_compressed)
+    {
+        for (uint i = 0; i < count; i++)
+        {
+            uint to = (slot + i) % capacity;
+            uint from = (to + 1) % capacity;
+            uint row = to % m_keyframeInterval;
+            if (i == 0 || row == 0)
+            {
+                // the rows of a block are encoded relative to each other, so the rows that are
+                // moved within the block are decoded before the block is rewritten
+                for (uint next = row + 1; next < m_keyframeInterval; next++)
+                {
+                    if (m_valid[to - row + next])
+                    {
+                        const float* values = m_compressed->GetRow(to - row + next);
+                        std::copy(values,
+                                  values + m_rowLength,
+                                  m_shifted.begin() + static_cast<size_t>(next) * m_rowLength);
+                    }
+                }
+            }
+            m_valid[to] = m_valid[from];
+            if (m_valid[to])
+            {
+                // the first row of the next block was not rewritten yet
+                m_compressed->Store(to,
+                                    row + 1 < m_keyframeInterval
+                                        ? m_shifted.data() +
+                                              static_cast<size_t>(row + 1) * m_rowLength
+                                        : m_compressed->GetRow(from));
+            }
+        }
+        m_valid[(slot + count) % capacity] = 0;
+        return;
+    }
+
+    std::visit(
+        [&](auto& values) {
+            for (uint i = 0; i < count; i++)
+            {
+                uint to = (slot + i) % capacity;
+                uint from = (to + 1) % capacity;
+                auto row = values.begin() + GetOffset(from);
+                std::copy(row, row + m_rowLength, values.begin() + GetOffset(to));
+                if (to < m_paddingRows)
+                {
+                    std::copy(row, row + m_rowLength, values.begin() + GetOffset(capacity + to));
+                }
+                m_valid[to] = m_valid[from];
+            }
+        },
+        m_values);
+    m_valid[(slot + count) % capacity] = 0;
+}
+
+AggregatedInfo
+HistoryColumn::Aggregate(uint slot) const
+{
+    AggregatedInfo info;
+    Aggregate(slot, info);
+    return info;
+}
+
+void
+HistoryColumn::Aggregate(uint slot, AggregatedInfo& info) const
+{
+    NS_ASSERT_MSG(m_valid[slot], "Aggregating invalid row of slot " << slot);
+    if (m_compressed)
+    {
+        info.UpdateStatistics(m_compressed->GetRow(slot), m_rowLength);
+        return;
+    }
+    std::visit(
+        [&](const auto& values) {
+            info.UpdateStatistics(values.data() + GetOffset(slot), m_rowLength);
+        },
+        m_values);
+}
+
+void
+HistoryColumn::AggregateEntry(uint slot, AggregatedInfo& info, int stats) const
+{
+    NS_ASSERT_MSG(m_valid[slot], "Aggregating invalid row of slot " << slot);
+    if (m_compressed)
+    {
+        info.UpdateEntry(m_compressed->GetRow(slot), m_rowLength, stats);
+        return;
+    }
+    std::visit(
+        [&](const auto& values) {
+            info.UpdateEntry(values.data() + GetOffset(slot), m_rowLength, stats);
+        },
+        m_values);
+}
+
+Ptr<OpenGymDataContainer>
+HistoryColumn::GetBox(uint slot) const
+{
+    NS_ASSERT_MSG(m_valid[slot], "Restoring invalid row of slot " << slot);
+    return std::visit(
+        [&](const auto& values) -> Ptr<OpenGymDataContainer> {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            const T* row = GetRow<T>(slot);
+            auto box = CreateObject<OpenGymBoxContainer<T>>(m_shape);
+            box->SetData(std::vector<T>(row, row + m_rowLength));
+            return box;
+        },
+        m_values);
+}
+
+bool
+HistoryColumn::IsCompressed() const
+{
+    return m_compressed.has_value();
+}
+
+size_t
+HistoryColumn::GetStorageSize() const
+{
+    if (m_compressed)
+    {
+        return m_compressed->GetEncodedSize();
+    }
+    return std::visit(
+        [](const auto& values) { return values.size() * sizeof(values[0]); },
+        m_values);
+}
+
+HistoryColumn::Dtype
+HistoryColumn::GetDtype() const
+{
+    return m_dtype;
+}
+
+uint
+HistoryColumn::GetRowLength() const
+{
+    return m_rowLength;
+}
@@ -0,0 +1,315 @@
+#ifndef HISTORY_COLUMN_H
+#define HISTORY_COLUMN_H
+
+#include "aggregated-info.h"
+#include "compressed-column.h"
+
+#include <ns3/ai-module.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <sys/types.h>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class HistoryColumn
+ * \brief Columnar storage for the values stored under one key of the dictionaries in a history.
+ * The values of the OpenGymBoxContainers are copied into one contiguous typed array with one row
+ * of fixed length per slot of the owning TimestampedDataDeque, so scans over a history read
+ * contiguous memory instead of following the dictionaries. Boxes with the element types \c float,
+ * \c double, \c int32_t and \c uint32_t are supported. A row is only valid if the box stored in its
+ * slot matches the element type and length of the column.
+ *
+ * Columns of element type \c float can be compressed with a CompressedColumn, in which case a row
+ * is additionally only valid if the box has the shape of the first stored box, so that the box can
+ * be restored from the column with \c GetBox().
+ *
+ * For frame stacking, uncompressed columns can keep \c p padding rows in front of the rows of the
+ * slots and mirror the rows of the first \c p slots behind them. The rows of up to \c p + 1
+ * consecutive slots of the ring buffer are then contiguous in memory even if they wrap around, and
+ * so are the rows of the first slots preceded by padding rows, see \c GetFrames().
+ */
+class HistoryColumn
+{
+  public:
+    /**
+     * \brief Element type of a column.
+     */
+    enum Dtype
+    {
+        FLOAT,
+        DOUBLE,
+        INT32,
+        UINT32
+    };
+
+    /**
+     * \brief Creates a new column.
+     * \param capacity the number of rows, i.e. the number of slots of the owning
+     * TimestampedDataDeque.
+     * \param dtype the element type of the column.
+     * \param rowLength the number of values per row.
+     * \param keyframeInterval the number of rows per block of a CompressedColumn, or 0 to store the
+     * rows uncompressed. Only \c float columns are compressed, but all columns check the shape
+     * of the boxes if it is not 0.
+     * \param paddingRows the number of padding and mirrored rows for frame stacking. Requires an
+     * uncompressed column.
+     */
+    HistoryColumn(uint capacity,
+                  Dtype dtype,
+                  uint rowLength,
+                  uint keyframeInterval = 0,
+                  uint paddingRows = 0);
+
+    /**
+     * \brief Determine the column layout a container would be stored with.
+     * \param data the container to inspect.
+     * \param dtype set to the element type of the box.
+     * \param rowLength set to the number of values in the box.
+     * \return \c true if \c data is a box of one of the element types of \c Dtype, \c false
+     * otherwise.
+     */
+    static bool GetLayout(Ptr<OpenGymDataContainer> data, Dtype& dtype, uint& rowLength);
+
+    /**
+     * \brief Copy the values of a box into the row of a slot. The row is invalidated if the box
+     * does not match the layout of the column.
+     * \param slot the slot to write.
+     * \param data the box to store.
+     * \return \c true if the values were stored, \c false otherwise.
+     */
+    bool Store(uint slot, Ptr<OpenGymDataContainer> data);
+
+    /**
+     * \brief Fill the padding rows with the values of a box, e.g. of the observation returned after
+     * a reset. The padding rows are zero until this is called.
+     * \param data the box, which has to match the layout of the column.
+     * \return \c true if the padding was set, \c false otherwise.
+     */
+    bool SetPadding(Ptr<OpenGymDataContainer> data);
+
+    /**
+     * \brief Mark the row of a slot as invalid.
+     * \param slot the slot to invalidate.
+     */
+    void Invalidate(uint slot);
+
+    /**
+     * \param slot the slot to check.
+     * \return \c true if the row of the slot holds values, \c false otherwise.
+     */
+    bool IsValid(uint slot) const;
+
+    /**
+     * \brief Change the number of rows and move the rows to new slots.
+     * \param capacity the new number of rows.
+     * \param slots the old slot of each new slot, starting with new slot 0. Slots beyond the size
+     * of this vector are invalid afterwards.
+     */
+    void Relayout(uint capacity, const std::vector<uint>& slots);
+
+    /**
+     * \brief Move the rows of consecutive slots of the ring buffer back by one slot, overwriting
+     * the row of \c slot, and invalidate the row of the last slot. This does not allocate memory.
+     * \param slot the slot to overwrite.
+     * \param count the number of rows after \c slot to move, fewer than the number of rows minus
+     * one block of a compressed column.
+     */
+    void ShiftBack(uint slot, uint count);
+
+    /**
+     * \brief Aggregate the values of a row.
+     * \param slot the slot to aggregate, which has to be valid.
+     * \return the aggregated information of the row.
+     */
+    AggregatedInfo Aggregate(uint slot) const;
+
+    /**
+     * \brief Add the values of a row to existing aggregated information.
+     * \param slot the slot to aggregate, which has to be valid.
+     * \param info the aggregated information to update.
+     */
+    void Aggregate(uint slot, AggregatedInfo& info) const;
+
+    /**
+     * \brief Add selected statistics of a row as a single data entry, see
+     * AggregatedInfo::UpdateEntry().
+     * \param slot the slot to aggregate, which has to be valid.
+     * \param info the aggregated information to update.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     */
+    void AggregateEntry(uint slot, AggregatedInfo& info, int stats) const;
+
+    /**
+     * \brief Restore the box stored in a row.
+     * \param slot the slot to read, which has to be valid.
+     * \return a new box with the values of the row and the shape of the first stored box.
+     */
+    Ptr<OpenGymDataContainer> GetBox(uint slot) const;
+
+    /**
+     * \return \c true if the rows are stored in a CompressedColumn, \c false otherwise.
+     */
+    bool IsCompressed() const;
+
+    /**
+     * \return the number of bytes used to store the values of all rows.
+     */
+    size_t GetStorageSize() const;
+
+    /**
+     * \return the element type of the column.
+     */
+    Dtype GetDtype() const;
+
+    /**
+     * \return the number of values per row.
+     */
+    uint GetRowLength() const;
+
+    /**
+     * \brief Call a function with the values of a row, typed with the element type of the column.
+     * \param slot the slot to read, which has to be valid.
+     * \param function called with a pointer to the first of \c GetRowLength() values.
+     */
+    template <typename F>
+    void VisitRow(uint slot, F function) const
+    {
+        NS_ASSERT_MSG(m_valid[slot], "Reading invalid row of slot " << slot);
+        if (m_compressed)
+        {
+            function(m_compressed->GetRow(slot));
+            return;
+        }
+        std::visit([&](const auto& values) { function(values.data() + GetOffset(slot)); },
+                   m_values);
+    }
+
+    /**
+     * \brief Access the values of a row.
+     * \param slot the slot to access.
+     * \return a pointer to the first of \c GetRowLength() values, or \c nullptr if the row is
+     * invalid or \c T is not the element type of the column. The values of a compressed column
+     * are decoded into a cache, so the pointer is only valid until the column is accessed again.
+     */
+    template <typename T>
+    const T* GetRow(uint slot) const
+    {
+        if constexpr (std::is_same_v<T, float>)
+        {
+            if (m_compressed)
+            {
+                return m_valid[slot] ? m_compressed->GetRow(slot) : nullptr;
+            }
+        }
+        auto values = std::get_if<std::vector<T>>(&m_values);
+        if (!values || !m_valid[slot])
+        {
+            return nullptr;
+        }
+        return values->data() + GetOffset(slot);
+    }
+
+    /**
+     * \brief Access the rows of consecutive slots of the ring buffer as one block, preceded by
+     * padding rows if there are fewer slots than rows. The block points into the column if its
+     * rows are contiguous and valid, which is the case if at most \c paddingRows + 1 rows are
+     * requested and the padding, if any, precedes the first slot. Otherwise the rows are copied
+     * into a buffer of the column, using padding rows for invalid rows.
+     * \param newestSlot the slot of the newest row.
+     * \param count the number of rows of the block.
+     * \param available the number of slots in the block, at most \c count. The remaining rows of
+     * the block are padding rows.
+     * \return a pointer to \c count x \c GetRowLength() values, oldest row first, or \c nullptr
+     * if \c T is not the element type of the column. A copied block is only valid until the
+     * column is accessed again.
+     */
+    template <typename T>
+    const T* GetFrames(uint newestSlot, uint count, uint available) const
+    {
+        auto values = std::get_if<std::vector<T>>(&m_values);
+        if (!values || m_compressed || count == 0)
+        {
+            return nullptr;
+        }
+        uint capacity = m_valid.size();
+        uint padding = count - available;
+        uint oldestSlot = available == 0 ? 0 : (newestSlot + capacity + 1 - available) % capacity;
+        bool contiguous = count <= m_paddingRows + 1 && available > 0 &&
+                          (padding == 0 || oldestSlot == 0);
+        for (uint i = 0; contiguous && i < available; i++)
+        {
+            contiguous = m_valid[(oldestSlot + i) % capacity];
+        }
+        if (contiguous)
+        {
+            return values->data() + GetOffset(oldestSlot) -
+                   static_cast<size_t>(padding) * m_rowLength;
+        }
+
+        auto& frames = std::get<std::vector<T>>(m_frames);
+        frames.assign(static_cast<size_t>(count) * m_rowLength, T());
+        for (uint i = 0; i < count; i++)
+        {
+            T* target = frames.data() + static_cast<size_t>(i) * m_rowLength;
+            uint slot = (oldestSlot + i + capacity - padding) % capacity;
+            const T* row = nullptr;
+            if (i >= padding && m_valid[slot])
+            {
+                row = values->data() + GetOffset(slot);
+            }
+            else if (m_paddingRows > 0)
+            {
+                row = values->data();
+            }
+            if (row)
+            {
+                std::copy(row, row + m_rowLength, target);
+            }
+        }
+        return frames.data();
+    }
+
+  private:
+    /**
+     * \param slot a slot.
+     * \return the index of the first value of the row of the slot.
+     */
+    size_t GetOffset(uint slot) const
+    {
+        return (static_cast<size_t>(m_paddingRows) + slot) * m_rowLength;
+    }
+
+    Dtype m_dtype;    //!< Element type of the column
+    uint m_rowLength; //!< Number of values per row
+    std::variant<std::vector<float>,
+                 std::vector<double>,
+                 std::vector<int32_t>,
+                 std::vector<uint32_t>>
+        m_values;                 //!< Rows of all slots, stored back to back
+    std::vector<uint8_t> m_valid; //!< Whether the row of a slot holds values
+
+    std::optional<CompressedColumn> m_compressed; //!< Rows of a compressed column instead
+    uint m_keyframeInterval;                      //!< Rows per compressed block, 0 if none
+    std::vector<uint32_t> m_shape;                //!< Shape of the first stored box
+    bool m_hasShape;                              //!< Whether a box was stored already
+    std::vector<float> m_shifted; //!< Decoded rows of the block being rewritten by \c ShiftBack()
+
+    uint m_paddingRows; //!< Number of padding rows and of mirrored rows
+    mutable std::variant<std::vector<float>,
+                         std::vector<double>,
+                         std::vector<int32_t>,
+                         std::vector<uint32_t>>
+        m_frames; //!< Buffer of copied blocks, see \c GetFrames()
+};
+
+} // namespace ns3
+
+#endif
@@ -1,270 +1,1997 @@
 #include "history-container.h"
 
+#include "box-visitor.h"
+
+#include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <queue>
 #include <vector>
 
-using namespace ns3;
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HistoryContainer");
+
+TimestampedData::TimestampedData(Ptr<OpenGymDictContainer> data,
+                                 bool trackNs3Time,
+                                 bool trackWallTime)
+    : data(data),
+      timestamp(),
+      ns3timestamp(-1),
+      sequence(0)
+{
+    if (trackNs3Time)
+    {
+        ns3timestamp = Simulator::Now().GetTimeStep();
+    }
+    if (trackWallTime)
+    {
+        timestamp = std::chrono::steady_clock::now();
+    }
+}
+
+TimestampedData::TimestampedData()
+    : data(nullptr),
+      timestamp(),
+      ns3timestamp(-1),
+      sequence(0)
+{
+}
+
+Time
+TimestampedData::GetNs3Time() const
+{
+    return TimeStep(ns3timestamp);
+}
+
+TimestampedDataDeque::TimestampedDataDeque(uint capacity, bool columnar, uint keyframeInterval)
+    : m_head(0),
+      m_size(0),
+      m_capacity(capacity),
+      m_columnar(columnar || keyframeInterval > 0),
+      m_keyframeInterval(keyframeInterval),
+      m_frameStackDepth(0),
+      m_maxPriority(1),
+      m_accountBytes(false),
+      m_storedBytes(0)
+{
+    m_buffer.resize(GetSlotCount(capacity));
+    if (m_columnar)
+    {
+        m_complete.resize(m_buffer.size(), 0);
+        m_timestamps.resize(m_buffer.size(), -1);
+    }
+}
+
+uint
+TimestampedDataDeque::GetSlotCount(uint capacity) const
+{
+    if (m_keyframeInterval == 0)
+    {
+        return capacity;
+    }
+    // one spare block, so a block is only restarted once all of its entries were removed
+    uint blocks = (capacity + m_keyframeInterval - 1) / m_keyframeInterval + 1;
+    return blocks * m_keyframeInterval;
+}
+
+void
+TimestampedDataDeque::SetCapacity(uint capacity)
+{
+    if (m_size > capacity)
+    {
+        PopOldest(m_size - capacity);
+    }
+    m_capacity = capacity;
+    uint slotCount = GetSlotCount(capacity);
+    if (slotCount == m_buffer.size())
+    {
+        return;
+    }
+
+    std::vector<uint> slots(m_size);
+    for (uint i = 0; i < m_size; i++)
+    {
+        slots[i] = Slot(i);
+    }
+    Relayout(slotCount, slots);
+}
+
+void
+TimestampedDataDeque::Erase(uint offset)
+{
+    NS_ASSERT_MSG(offset < m_size, "No data entry at offset " << offset);
+    DropRestored();
+    // move the newer data entries back by one slot, so the slot of the newest one becomes free
+    uint position = m_size - 1 - offset;
+    uint erased = Slot(position);
+    if (m_accountBytes)
+    {
+        m_storedBytes -= m_bytes[erased];
+    }
+    for (uint i = position; i + 1 < m_size; i++)
+    {
+        uint to = Slot(i);
+        uint from = Slot(i + 1);
+        m_buffer[to] = std::move(m_buffer[from]);
+        if (m_accountBytes)
+        {
+            m_bytes[to] = m_bytes[from];
+        }
+        if (m_priorities)
+        {
+            m_priorities->Set(to, m_priorities->Get(from));
+        }
+        if (m_columnar)
+        {
+            m_complete[to] = m_complete[from];
+            m_timestamps[to] = m_timestamps[from];
+        }
+    }
+
+    uint freed = Slot(m_size - 1);
+    m_buffer[freed] = TimestampedData();
+    if (m_accountBytes)
+    {
+        m_bytes[freed] = 0;
+    }
+    if (m_priorities)
+    {
+        m_priorities->Set(freed, 0);
+    }
+    if (m_columnar)
+    {
+        m_complete[freed] = 0;
+        m_timestamps[freed] = -1;
+        for (auto& column : m_columns)
+        {
+            if (column)
+            {
+                column->ShiftBack(erased, offset);
+            }
+        }
+    }
+    m_size--;
+}
+
+void
+TimestampedDataDeque::Relayout(uint capacity, const std::vector<uint>& slots)
+{
+    DropRestored();
+    // linearize the kept data entries into the new buffer, oldest first
+    std::vector<TimestampedData> buffer(capacity);
+    for (uint i = 0; i < slots.size(); i++)
+    {
+        buffer[i] = m_buffer[slots[i]];
+    }
+    m_buffer.swap(buffer);
+    m_head = 0;
+    m_size = slots.size();
+
+    if (m_accountBytes)
+    {
+        std::vector<uint32_t> bytes(capacity, 0);
+        m_storedBytes = 0;
+        for (uint i = 0; i < m_size; i++)
+        {
+            bytes[i] = m_bytes[slots[i]];
+            m_storedBytes += bytes[i];
+        }
+        m_bytes.swap(bytes);
+    }
+
+    if (m_priorities)
+    {
+        SumTree priorities(capacity);
+        for (uint i = 0; i < m_size; i++)
+        {
+            priorities.Set(i, m_priorities->Get(slots[i]));
+        }
+        m_priorities = std::move(priorities);
+    }
+
+    if (m_columnar)
+    {
+        std::vector<uint8_t> complete(capacity, 0);
+        std::vector<int64_t> timestamps(capacity, -1);
+        for (uint i = 0; i < m_size; i++)
+        {
+            complete[i] = m_complete[slots[i]];
+            timestamps[i] = m_timestamps[slots[i]];
+        }
+        m_complete.swap(complete);
+        m_timestamps.swap(timestamps);
+        for (auto& column : m_columns)
+        {
+            if (column)
+            {
+                column->Relayout(capacity, slots);
+            }
+        }
+    }
+}
+
+uint
+TimestampedDataDeque::GetCapacity() const
+{
+    return m_capacity;
+}
+
+uint
+TimestampedDataDeque::Slot(uint offset) const
+{
+    uint slot = m_head + offset;
+    return slot >= m_buffer.size() ? slot - m_buffer.size() : slot;
+}
+
+void
+TimestampedDataDeque::Push(TimestampedData value)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    DropRestored();
+    uint slot;
+    if (m_size == m_buffer.size())
+    {
+        // overwrite the oldest data entry
+        slot = m_head;
+        m_head = Slot(1);
+        if (m_accountBytes)
+        {
+            m_storedBytes -= m_bytes[slot];
+        }
+    }
+    else if (m_size == m_capacity)
+    {
+        // compressed deques have spare slots, so the oldest entry is removed before appending
+        PopOldest();
+        slot = Slot(m_size);
+        m_size++;
+    }
+    else
+    {
+        slot = Slot(m_size);
+        m_size++;
+    }
+    m_buffer[slot] = value;
+    if (m_accountBytes)
+    {
+        // estimated before the dictionary may be dropped in compressed mode, from the resolved
+        // values, which the columns reuse, so that no key is copied
+        m_bytes[slot] = value.data ? GetContainerSize(m_keys.Resolve(value.data)) : 0;
+        m_storedBytes += m_bytes[slot];
+    }
+    if (m_columnar)
+    {
+        StoreColumns(slot);
+    }
+    if (m_priorities)
+    {
+        m_priorities->Set(slot, m_maxPriority);
+    }
+}
+
+void
+TimestampedDataDeque::StoreColumns(uint slot)
+{
+    InvalidateColumns(slot);
+    const TimestampedData& entry = m_buffer[slot];
+    m_timestamps[slot] = entry.ns3timestamp;
+    if (!entry.data)
+    {
+        return;
+    }
+
+    bool complete = true;
+    for (const auto& [key, value] : m_keys.Resolve(entry.data))
+    {
+        if (key >= m_columns.size())
+        {
+            m_columns.resize(key + 1);
+        }
+        auto& column = m_columns[key];
+        if (!column)
+        {
+            HistoryColumn::Dtype dtype;
+            uint rowLength;
+            if (!HistoryColumn::GetLayout(value, dtype, rowLength))
+            {
+                complete = false;
+                continue;
+            }
+            uint paddingRows = m_frameStackDepth > 0 ? m_frameStackDepth - 1 : 0;
+            column.emplace(m_buffer.size(), dtype, rowLength, m_keyframeInterval, paddingRows);
+            const std::string& name = KeyRegistry::GetKey(key);
+            if (m_framePadding && !column->SetPadding(m_framePadding->Get(name)))
+            {
+                NS_LOG_WARN("No padding box of matching layout for key "
+                            << name << ", padding frame stacks with zeros");
+            }
+        }
+        complete = column->Store(slot, value) && complete;
+    }
+    m_complete[slot] = complete;
+    if (complete && m_keyframeInterval > 0)
+    {
+        // the dictionary can be restored from the columns, see Materialize()
+        m_buffer[slot].data = nullptr;
+    }
+}
+
+void
+TimestampedDataDeque::SetFrameStacking(uint depth, Ptr<OpenGymDictContainer> padding)
+{
+    NS_ASSERT_MSG(m_columnar && m_keyframeInterval == 0,
+                  "Frame stacking requires columnar storage without compression");
+    NS_ASSERT_MSG(m_columns.empty(), "Frame stacking has to be set before the first push");
+    NS_ASSERT_MSG(depth <= m_capacity, "A frame stack cannot be deeper than the capacity");
+    m_frameStackDepth = depth;
+    m_framePadding = padding;
+}
+
+void
+TimestampedDataDeque::EnablePriorities()
+{
+    if (m_priorities)
+    {
+        return;
+    }
+    m_priorities.emplace(m_buffer.size());
+    for (uint i = 0; i < m_size; i++)
+    {
+        m_priorities->Set(Slot(i), m_maxPriority);
+    }
+}
+
+bool
+TimestampedDataDeque::HasPriorities() const
+{
+    return m_priorities.has_value();
+}
+
+void
+TimestampedDataDeque::SetPriority(uint offset, double priority)
+{
+    NS_ASSERT_MSG(m_priorities, "Priorities are not kept, call EnablePriorities() first");
+    m_priorities->Set(GetNewestSlot(offset), priority);
+    m_maxPriority = std::max(m_maxPriority, priority);
+}
+
+double
+TimestampedDataDeque::GetPriority(uint offset) const
+{
+    NS_ASSERT_MSG(m_priorities, "Priorities are not kept, call EnablePriorities() first");
+    return m_priorities->Get(GetNewestSlot(offset));
+}
+
+double
+TimestampedDataDeque::GetTotalPriority() const
+{
+    return m_priorities ? m_priorities->GetTotal() : 0;
+}
+
+uint
+TimestampedDataDeque::FindPriority(double& prefix) const
+{
+    NS_ASSERT_MSG(m_priorities, "Priorities are not kept, call EnablePriorities() first");
+    uint slot = m_priorities->Find(prefix);
+    uint age = slot >= m_head ? slot - m_head : slot + m_buffer.size() - m_head;
+    NS_ASSERT_MSG(age < m_size, "Found a slot without data entry");
+    return m_size - 1 - age;
+}
+
+void
+TimestampedDataDeque::EnableByteAccounting()
+{
+    if (m_accountBytes)
+    {
+        return;
+    }
+    m_accountBytes = true;
+    m_bytes.assign(m_buffer.size(), 0);
+    for (uint i = 0; i < m_size; i++)
+    {
+        uint slot = Slot(i);
+        const auto& data = m_buffer[slot].data;
+        m_bytes[slot] = data ? GetContainerSize(m_keys.Resolve(data)) : 0;
+        m_storedBytes += m_bytes[slot];
+    }
+}
+
+uint64_t
+TimestampedDataDeque::GetStoredBytes() const
+{
+    return m_storedBytes;
+}
+
+uint64_t
+TimestampedDataDeque::GetBytes(uint offset) const
+{
+    return m_accountBytes ? m_bytes[GetNewestSlot(offset)] : 0;
+}
+
+uint64_t
+TimestampedDataDeque::GetSequence(uint offset) const
+{
+    return m_buffer[GetNewestSlot(offset)].sequence;
+}
+
+void
+TimestampedDataDeque::Materialize(uint slot)
+{
+    TimestampedData& entry = m_buffer[slot];
+    if (entry.data || m_keyframeInterval == 0 || !m_complete[slot])
+    {
+        return;
+    }
+    // only the dictionary of the last accessed entry is kept, so reads do not inflate the history
+    DropRestored();
+    entry.data = Restore(slot);
+    m_restored = slot;
+}
+
+Ptr<OpenGymDictContainer>
+TimestampedDataDeque::Restore(uint slot) const
+{
+    auto dict = CreateObject<InternedDictContainer>();
+    for (KeyId key = 0; key < m_columns.size(); key++)
+    {
+        if (m_columns[key] && m_columns[key]->IsValid(slot))
+        {
+            dict->Add(key, m_columns[key]->GetBox(slot));
+        }
+    }
+    return dict;
+}
+
+void
+TimestampedDataDeque::DropRestored()
+{
+    if (m_restored)
+    {
+        m_buffer[*m_restored].data = nullptr;
+        m_restored.reset();
+    }
+}
+
+void
+TimestampedDataDeque::InvalidateColumns(uint slot)
+{
+    for (auto& column : m_columns)
+    {
+        if (column)
+        {
+            column->Invalidate(slot);
+        }
+    }
+    m_complete[slot] = 0;
+    m_timestamps[slot] = -1;
+}
+
+void
+TimestampedDataDeque::PopNewest(uint count)
+{
+    DropRestored();
+    while (count > 0 && m_size > 0)
+    {
+        uint slot = Slot(m_size - 1);
+        m_buffer[slot] = TimestampedData();
+        if (m_columnar)
+        {
+            InvalidateColumns(slot);
+        }
+        if (m_accountBytes)
+        {
+            m_storedBytes -= m_bytes[slot];
+            m_bytes[slot] = 0;
+        }
+        if (m_priorities)
+        {
+            m_priorities->Set(slot, 0);
+        }
+        m_size--;
+        count--;
+    }
+}
+
+void
+TimestampedDataDeque::PopOldest(uint count)
+{
+    DropRestored();
+    while (count > 0 && m_size > 0)
+    {
+        m_buffer[m_head] = TimestampedData();
+        if (m_columnar)
+        {
+            InvalidateColumns(m_head);
+        }
+        if (m_accountBytes)
+        {
+            m_storedBytes -= m_bytes[m_head];
+            m_bytes[m_head] = 0;
+        }
+        if (m_priorities)
+        {
+            m_priorities->Set(m_head, 0);
+        }
+        m_head = Slot(1);
+        m_size--;
+        count--;
+    }
+}
+
+uint
+TimestampedDataDeque::PopOlderThan(int64_t timestamp)
+{
+    if (m_size == 0 || m_buffer[m_head].ns3timestamp >= timestamp)
+    {
+        return 0;
+    }
+    uint count = CountUntil(timestamp - 1);
+    PopOldest(count);
+    return count;
+}
+
+TimestampedDataView
+TimestampedDataDeque::GetOldest(uint count)
+{
+    return TimestampedDataView(m_buffer.data(),
+                               m_buffer.size(),
+                               m_head,
+                               std::min(count, m_size),
+                               false,
+                               GetOwner());
+}
+
+TimestampedDataView
+TimestampedDataDeque::GetNewest(uint count)
+{
+    if (m_size == 0)
+    {
+        return TimestampedDataView();
+    }
+    return TimestampedDataView(m_buffer.data(),
+                               m_buffer.size(),
+                               Slot(m_size - 1),
+                               std::min(count, m_size),
+                               true,
+                               GetOwner());
+}
+
+TimestampedData*
+TimestampedDataDeque::GetNewestAt(uint offset)
+{
+    uint slot = GetNewestSlot(offset);
+    Materialize(slot);
+    return &m_buffer[slot];
+}
+
+TimestampedDataDeque*
+TimestampedDataDeque::GetOwner()
+{
+    return m_keyframeInterval > 0 ? this : nullptr;
+}
+
+TimestampedDataView
+TimestampedDataDeque::GetAll()
+{
+    return GetNewest(Size());
+}
+
+uint
+TimestampedDataDeque::CountUntil(int64_t timestamp) const
+{
+    uint low = 0;
+    uint high = m_size;
+    while (low < high)
+    {
+        uint middle = low + (high - low) / 2;
+        if (m_buffer[Slot(middle)].ns3timestamp <= timestamp)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+TimestampedDataView
+TimestampedDataDeque::GetRange(int64_t from, int64_t to)
+{
+    if (from > to)
+    {
+        return TimestampedDataView();
+    }
+    uint begin = from == INT64_MIN ? 0 : CountUntil(from - 1);
+    uint end = CountUntil(to);
+    if (end == begin)
+    {
+        return TimestampedDataView();
+    }
+    return TimestampedDataView(m_buffer.data(),
+                               m_buffer.size(),
+                               Slot(end - 1),
+                               end - begin,
+                               true,
+                               GetOwner());
+}
+
+void
+TimestampedDataDeque::Clear()
+{
+    PopOldest(m_size);
+    m_head = 0;
+}
+
+uint
+TimestampedDataDeque::Size() const
+{
+    return m_size;
+}
+
+bool
+TimestampedDataDeque::IsColumnar() const
+{
+    return m_columnar;
+}
+
+uint
+TimestampedDataDeque::GetKeyframeInterval() const
+{
+    return m_keyframeInterval;
+}
+
+uint
+TimestampedDataDeque::GetNewestSlot(uint offset) const
+{
+    NS_ASSERT_MSG(offset < m_size, "No data entry at offset " << offset);
+    return Slot(m_size - 1 - offset);
+}
+
+const HistoryColumn*
+TimestampedDataDeque::GetColumn(const std::string& key) const
+{
+    return GetColumn(KeyRegistry::Find(key));
+}
+
+const HistoryColumn*
+TimestampedDataDeque::GetColumn(KeyId key) const
+{
+    return key < m_columns.size() && m_columns[key] ? &*m_columns[key] : nullptr;
+}
+
+const std::vector<std::optional<HistoryColumn>>&
+TimestampedDataDeque::GetColumns() const
+{
+    return m_columns;
+}
+
+bool
+TimestampedDataDeque::IsComplete(uint slot) const
+{
+    return m_columnar && m_complete[slot];
+}
+
+int64_t
+TimestampedDataDeque::GetTimestamp(uint slot) const
+{
+    NS_ASSERT_MSG(m_columnar, "The timestamp column is only kept in columnar mode");
+    return m_timestamps[slot];
+}
+
+HistoryContainer::HistoryContainer(uint historyLength,
+                                   bool trackNs3Time,
+                                   bool columnar,
+                                   bool trackWallTime)
+    : m_historyCount{0},
+      m_historyLength{historyLength},
+      m_trackNs3Time{trackNs3Time},
+      m_trackWallTime{trackWallTime},
+      m_columnar{columnar},
+      m_quantileK{0},
+      m_keyframeInterval{0},
+      m_frameStackDepth{0},
+      m_retention{LAST_N},
+      m_retentionParameter{0},
+      m_pushCount{0},
+      m_replayCapacity{0},
+      m_returnsRewardKey{KeyRegistry::INVALID},
+      m_returnsValueKey{KeyRegistry::INVALID},
+      m_returnsDoneKey{KeyRegistry::INVALID},
+      m_prioritized{false}
+{
+}
+
+HistoryContainer::~HistoryContainer()
+{
+    if (m_budgetLink.budget)
+    {
+        m_budgetLink.budget->Unregister(this, GetStoredBytes());
+    }
+}
+
+HistoryContainer::BudgetLink::BudgetLink(const BudgetLink& other)
+{
+    NS_ASSERT_MSG(!other.budget, "A HistoryContainer attached to a MemoryBudget cannot be copied");
+}
+
+HistoryContainer::BudgetLink&
+HistoryContainer::BudgetLink::operator=(const BudgetLink& other)
+{
+    NS_ASSERT_MSG(!budget && !other.budget,
+                  "A HistoryContainer attached to a MemoryBudget cannot be copied");
+    return *this;
+}
+
+uint
+HistoryContainer::GetHistoryCount() const
+{
+    return m_historyCount;
+}
+
+void
+HistoryContainer::Push(Ptr<OpenGymDictContainer> obs, uint id)
+{
+    History* history = FindHistory(id);
+    if (!history)
+    {
+        NS_LOG_INFO("No history with id " << id << " found, creating new history.");
+        History newHistory;
+        newHistory.data = TimestampedDataDeque(m_historyLength, m_columnar, m_keyframeInterval);
+        if (m_frameStackDepth > 0)
+        {
+            newHistory.data.SetFrameStacking(m_frameStackDepth, m_framePadding);
+        }
+        if (m_retention == HYBRID)
+        {
+            newHistory.reservoir.SetCapacity(m_retentionParameter);
+        }
+        if (m_budgetLink.budget)
+        {
+            newHistory.data.EnableByteAccounting();
+            newHistory.reservoir.EnableByteAccounting();
+        }
+        for (uint length : m_windowLengths)
+        {
+            newHistory.windows.emplace_back(length);
+        }
+        for (const auto& [width, bucketCount] : m_tiers)
+        {
+            newHistory.tiers.emplace_back(width, bucketCount);
+        }
+        history = &AddHistory(id, std::move(newHistory));
+        this->m_historyCount++;
+        if (m_prioritized)
+        {
+            AddSampleIndex(id, *history);
+        }
+        if (!m_replayDirectory.empty())
+        {
+            CreateReplayBuffer(id, *history);
+        }
+    }
+
+    Expire(*history);
+    Ptr<MemoryBudget> budget = m_budgetLink.budget;
+    uint64_t storedBytes = budget ? GetHistoryBytes(*history) : 0;
+    TimestampedData timestampedData = TimestampedData(obs, m_trackNs3Time, m_trackWallTime);
+    timestampedData.sequence = budget ? budget->NextSequence() : m_pushCount;
+    m_pushCount++;
+    history->pushed++;
+    bool stored = Retain(*history, timestampedData);
+    history->snapshotCurrent = history->snapshotCurrent && !stored;
+    m_snapshots.stale = m_snapshots.stale || stored;
+    m_snapshots.Reclaim();
+    if (history->replay)
+    {
+        history->replay->Append(obs, timestampedData.ns3timestamp, timestampedData.sequence);
+    }
+    if (m_returns)
+    {
+        PushReturn(id, obs);
+    }
+
+    // the windows assume that the newest entries are stored, which is not the case for reservoirs
+    bool windowed = stored && m_retention != RESERVOIR && !history->windows.empty();
+    if (windowed || !history->tiers.empty())
+    {
+        // the tiers see every pushed entry, so dropped ones are read from the dictionary
+        auto info = stored ? AggregateEntry(history->data, 0, history->keys)
+                           : GetInfoFromDict(history->keys.Resolve(obs));
+        if (windowed)
+        {
+            for (auto& window : history->windows)
+            {
+                window.Push(info);
+            }
+        }
+        for (auto& tier : history->tiers)
+        {
+            tier.Push(Simulator::Now(), info);
+        }
+    }
+    if (m_quantileK > 0)
+    {
+        UpdateHorizon(*history, obs, stored);
+    }
+    if (m_prioritized)
+    {
+        m_historyPriorities.Set(history->sampleIndex, history->data.GetTotalPriority());
+    }
+    if (budget)
+    {
+        // may evict entries of any history, but never the one just pushed
+        budget->Update(GetHistoryBytes(*history), storedBytes);
+    }
+}
+
+void
+HistoryContainer::SetMemoryBudget(Ptr<MemoryBudget> budget)
+{
+    NS_ASSERT_MSG(m_pushCount == 0, "The memory budget has to be set before the first push");
+    if (m_budgetLink.budget)
+    {
+        m_budgetLink.budget->Unregister(this, 0);
+    }
+    m_budgetLink.budget = budget;
+    if (budget)
+    {
+        budget->Register(this);
+    }
+}
+
+Ptr<MemoryBudget>
+HistoryContainer::GetMemoryBudget() const
+{
+    return m_budgetLink.budget;
+}
+
+uint64_t
+HistoryContainer::GetStoredBytes()
+{
+    uint64_t bytes = 0;
+    ForEachHistory([&bytes](uint id, History& history) { bytes += GetHistoryBytes(history); });
+    return bytes;
+}
+
+uint64_t
+HistoryContainer::GetHistoryBytes(const History& history)
+{
+    return history.data.GetStoredBytes() + history.reservoir.GetStoredBytes();
+}
+
+bool
+HistoryContainer::FindEvictable(bool leastRecent, uint64_t& sequence, uint& id)
+{
+    bool found = false;
+    ForEachHistory([&](uint historyId, History& history) {
+        const TimestampedDataDeque& data = history.data;
+        const TimestampedDataDeque& reservoir = history.reservoir;
+        if (reservoir.Size() == 0 && data.Size() <= 1)
+        {
+            return;
+        }
+        uint64_t candidate;
+        if (leastRecent)
+        {
+            candidate = data.GetSequence(0);
+        }
+        else
+        {
+            // the sample of older entries only holds entries that left the newest ones
+            candidate = reservoir.Size() > 0 ? reservoir.GetSequence(reservoir.Size() - 1)
+                                             : data.GetSequence(data.Size() - 1);
+        }
+        if (!found || candidate < sequence)
+        {
+            found = true;
+            sequence = candidate;
+            id = historyId;
+        }
+    });
+    return found;
+}
+
+std::vector<std::pair<uint, uint64_t>>
+HistoryContainer::GetEvictableBytes()
+{
+    std::vector<std::pair<uint, uint64_t>> evictable;
+    ForEachHistory([&evictable](uint id, History& history) {
+        if (history.data.Size() == 0)
+        {
+            return;
+        }
+        uint64_t bytes = GetHistoryBytes(history) - history.data.GetBytes(0);
+        if (bytes > 0)
+        {
+            evictable.emplace_back(id, bytes);
+        }
+    });
+    return evictable;
+}
+
+uint
+HistoryContainer::Evict(uint id, uint64_t bytes)
+{
+    History& history = GetHistory(id);
+    TimestampedDataDeque& data = history.data;
+    TimestampedDataDeque& reservoir = history.reservoir;
+    uint64_t evictedBytes = 0;
+    uint evicted = 0;
+    while (evicted == 0 || evictedBytes < bytes)
+    {
+        if (reservoir.Size() > 0)
+        {
+            evictedBytes += reservoir.GetBytes(reservoir.Size() - 1);
+            reservoir.PopOldest();
+        }
+        else if (data.Size() > 1)
+        {
+            evictedBytes += data.GetBytes(data.Size() - 1);
+            data.PopOldest();
+        }
+        else
+        {
+            break;
+        }
+        evicted++;
+    }
+    if (evicted == 0)
+    {
+        return 0;
+    }
+    NS_LOG_INFO("Evicted " << evicted << " data entries of history " << id);
+    m_budgetLink.budget->m_evicted += evicted;
+    OnOldestRemoved(history, evictedBytes);
+    return evicted;
+}
+
+void
+HistoryContainer::OnOldestRemoved(History& history, uint64_t bytes)
+{
+    history.snapshotCurrent = false;
+    m_snapshots.stale = true;
+    // windows longer than the remaining entries may still hold removed ones
+    for (auto& window : history.windows)
+    {
+        if (window.GetLength() > history.data.Size())
+        {
+            FillWindow(history, window);
+        }
+    }
+    if (m_prioritized)
+    {
+        m_historyPriorities.Set(history.sampleIndex, history.data.GetTotalPriority());
+    }
+    if (m_budgetLink.budget)
+    {
+        m_budgetLink.budget->Update(0, bytes);
+    }
+}
+
+void
+HistoryContainer::SetTimeToLive(Time ttl)
+{
+    NS_ASSERT_MSG(m_historyCount == 0, "The time to live has to be set before the first push");
+    NS_ASSERT_MSG(!ttl.IsStrictlyNegative(), "The time to live cannot be negative");
+    m_timeToLive = ttl;
+    m_trackNs3Time = m_trackNs3Time || ttl.IsStrictlyPositive();
+}
+
+Time
+HistoryContainer::GetTimeToLive() const
+{
+    return m_timeToLive;
+}
+
+std::shared_ptr<const HistorySnapshot>
+HistoryContainer::Snapshot()
+{
+    m_snapshots.Reclaim();
+    ExpireAll();
+    if (m_snapshots.latest && !m_snapshots.stale)
+    {
+        return m_snapshots.latest;
+    }
+    std::vector<std::pair<uint, std::shared_ptr<const SnapshotHistory>>> histories;
+    ForEachHistory([&histories](uint id, History& history) {
+        if (!history.snapshotCurrent)
+        {
+            history.snapshot = PublishHistory(history);
+            history.snapshotCurrent = true;
+        }
+        histories.emplace_back(id, history.snapshot);
+    });
+    auto snapshot = std::make_shared<const HistorySnapshot>(m_pushCount, std::move(histories));
+    // readers load the latest snapshot concurrently, the replaced one may still be in use
+    auto replaced = std::atomic_exchange(&m_snapshots.latest, snapshot);
+    if (replaced)
+    {
+        m_snapshots.retired.push_back(std::move(replaced));
+    }
+    m_snapshots.stale = false;
+    return snapshot;
+}
+
+std::shared_ptr<const HistorySnapshot>
+HistoryContainer::GetPublishedSnapshot() const
+{
+    return std::atomic_load(&m_snapshots.latest);
+}
+
+std::shared_ptr<const SnapshotHistory>
+HistoryContainer::PublishHistory(History& history)
+{
+    TimestampedDataDeque& data = history.data;
+    auto entries = std::make_shared<SnapshotHistory>();
+    entries->reserve(data.Size());
+    const SnapshotHistory empty;
+    const SnapshotHistory& previous = history.snapshot ? *history.snapshot : empty;
+    auto reused = previous.begin();
+    DictKeyCache keys;
+    const std::vector<DictKeyCache::Entry> none;
+    for (uint offset = data.Size(); offset > 0; offset--)
+    {
+        // both are ordered by push, so the entries that are still stored are found in one pass
+        uint64_t sequence = data.GetSequence(offset - 1);
+        while (reused != previous.end() && (*reused)->GetSequence() < sequence)
+        {
+            reused++;
+        }
+        if (reused != previous.end() && (*reused)->GetSequence() == sequence)
+        {
+            entries->push_back(*reused);
+            continue;
+        }
+        TimestampedData* entry = data.GetNewestAt(offset - 1);
+        const auto& values = entry->data ? keys.Resolve(entry->data) : none;
+        entries->push_back(std::make_shared<const SnapshotEntry>(entry->data,
+                                                                 values,
+                                                                 entry->ns3timestamp,
+                                                                 entry->sequence));
+    }
+    return entries;
+}
+
+HistoryContainer::SnapshotState::SnapshotState(const SnapshotState& other)
+{
+}
+
+HistoryContainer::SnapshotState&
+HistoryContainer::SnapshotState::operator=(const SnapshotState& other)
+{
+    Release();
+    stale = true;
+    return *this;
+}
+
+HistoryContainer::SnapshotState::~SnapshotState()
+{
+    Release();
+}
+
+void
+HistoryContainer::SnapshotState::Reclaim()
+{
+    if (retired.empty())
+    {
+        return;
+    }
+    auto unused = std::partition(retired.begin(), retired.end(), [](const auto& snapshot) {
+        return snapshot.use_count() > 1;
+    });
+    if (unused != retired.end())
+    {
+        // pairs with the release of the reference counts by the readers, so that their reads of
+        // the entries happen before the entries are freed
+        std::atomic_thread_fence(std::memory_order_acquire);
+        retired.erase(unused, retired.end());
+    }
+}
+
+void
+HistoryContainer::SnapshotState::Release()
+{
+    Reclaim();
+    NS_ASSERT_MSG(retired.empty() && (!latest || latest.use_count() == 1),
+                  "Snapshots have to be released before their HistoryContainer is destroyed");
+    retired.clear();
+    latest.reset();
+}
+
+void
+HistoryContainer::Expire(History& history)
+{
+    if (!m_timeToLive.IsStrictlyPositive())
+    {
+        return;
+    }
+    int64_t oldest = (Simulator::Now() - m_timeToLive).GetTimeStep();
+    uint64_t bytes = GetHistoryBytes(history);
+    // the sample of older entries only holds entries that left the newest ones
+    uint expired = history.reservoir.PopOlderThan(oldest) + history.data.PopOlderThan(oldest);
+    if (expired > 0)
+    {
+        NS_LOG_INFO("Dropped " << expired << " expired data entries");
+        OnOldestRemoved(history, bytes - GetHistoryBytes(history));
+    }
+}
+
+void
+HistoryContainer::ExpireAll()
+{
+    ForEachHistory([this](uint id, History& history) { Expire(history); });
+}
+
+bool
+HistoryContainer::Retain(History& history, const TimestampedData& entry)
+{
+    TimestampedDataDeque& data = history.data;
+    bool full = data.Size() == data.GetCapacity();
+    switch (m_retention)
+    {
+    case LAST_N:
+        break;
+    case DECIMATE:
+        if ((history.pushed - 1) % m_retentionParameter != 0)
+        {
+            return false;
+        }
+        break;
+    case RESERVOIR:
+        if (full)
+        {
+            // the new entry replaces a random one with probability capacity / pushed
+            uint64_t index = SampleIndex(history.pushed);
+            if (index >= data.GetCapacity())
+            {
+                return false;
+            }
+            data.Erase(index);
+        }
+        break;
+    case HYBRID:
+        if (full && data.GetCapacity() > 0)
+        {
+            // the oldest entry leaves the newest ones and is offered to the sample of older ones
+            TimestampedDataDeque& reservoir = history.reservoir;
+            const TimestampedData& leaving = *data.GetNewestAt(data.Size() - 1);
+            if (reservoir.Size() < reservoir.GetCapacity())
+            {
+                reservoir.Push(leaving);
+            }
+            else if (reservoir.GetCapacity() > 0)
+            {
+                uint64_t index = SampleIndex(history.pushed - data.GetCapacity());
+                if (index < reservoir.GetCapacity())
+                {
+                    reservoir.Erase(index);
+                    reservoir.Push(leaving);
+                }
+            }
+        }
+        break;
+    }
+    data.Push(entry);
+    return true;
+}
+
+uint64_t
+HistoryContainer::SampleIndex(uint64_t n)
+{
+    if (!m_random)
+    {
+        m_random = CreateObject<UniformRandomVariable>();
+    }
+    auto index = static_cast<uint64_t>(m_random->GetValue(0, static_cast<double>(n)));
+    return std::min(index, n - 1);
+}
+
+double
+HistoryContainer::SampleUniform()
+{
+    if (!m_random)
+    {
+        m_random = CreateObject<UniformRandomVariable>();
+    }
+    return m_random->GetValue(0, 1);
+}
+
+void
+HistoryContainer::EnablePrioritizedSampling()
+{
+    if (m_prioritized)
+    {
+        return;
+    }
+    m_prioritized = true;
+    ForEachHistory([this](uint id, History& history) { AddSampleIndex(id, history); });
+}
+
+void
+HistoryContainer::AddSampleIndex(uint id, History& history)
+{
+    history.data.EnablePriorities();
+    if (!m_freeSampleIndices.empty())
+    {
+        // reuse the index of a deleted history, so the tree does not grow under churn
+        history.sampleIndex = m_freeSampleIndices.back();
+        m_freeSampleIndices.pop_back();
+        m_sampleIds[history.sampleIndex] = id;
+        m_historyPriorities.Set(history.sampleIndex, history.data.GetTotalPriority());
+        return;
+    }
+    history.sampleIndex = m_sampleIds.size();
+    m_sampleIds.push_back(id);
+    if (m_historyPriorities.GetCapacity() < m_sampleIds.size())
+    {
+        m_historyPriorities.Resize(std::max<size_t>(2 * m_historyPriorities.GetCapacity(),
+                                                    m_sampleIds.size()));
+    }
+    m_historyPriorities.Set(history.sampleIndex, history.data.GetTotalPriority());
+}
+
+void
+HistoryContainer::SetPriority(uint id, uint offset, double priority)
+{
+    NS_ASSERT_MSG(m_prioritized, "Priorities are not kept, call EnablePrioritizedSampling() first");
+    History& history = GetHistory(id);
+    history.data.SetPriority(offset, priority);
+    m_historyPriorities.Set(history.sampleIndex, history.data.GetTotalPriority());
+}
+
+double
+HistoryContainer::GetPriority(uint id, uint offset)
+{
+    NS_ASSERT_MSG(m_prioritized, "Priorities are not kept, call EnablePrioritizedSampling() first");
+    return GetHistory(id).data.GetPriority(offset);
+}
+
+template <typename F>
+std::vector<PrioritizedSample>
+HistoryContainer::SampleStratified(uint n, double total, F find)
+{
+    std::vector<PrioritizedSample> samples;
+    if (n == 0 || total <= 0)
+    {
+        return samples;
+    }
+    samples.reserve(n);
+    for (uint i = 0; i < n; i++)
+    {
+        double prefix = std::min((i + SampleUniform()) * total / n, total);
+        auto [id, history] = find(prefix);
+        uint offset = history->data.FindPriority(prefix);
+        samples.push_back({id,
+                           offset,
+                           history->data.GetNewestAt(offset),
+                           history->data.GetPriority(offset) / total});
+    }
+    return samples;
+}
+
+std::vector<PrioritizedSample>
+HistoryContainer::SamplePrioritized(uint n)
+{
+    NS_ASSERT_MSG(m_prioritized, "Priorities are not kept, call EnablePrioritizedSampling() first");
+    ExpireAll();
+    return SampleStratified(n, m_historyPriorities.GetTotal(), [this](double& prefix) {
+        uint id = m_sampleIds[m_historyPriorities.Find(prefix)];
+        return std::make_pair(id, &GetHistory(id));
+    });
+}
+
+std::vector<PrioritizedSample>
+HistoryContainer::SamplePrioritized(uint id, uint n)
+{
+    NS_ASSERT_MSG(m_prioritized, "Priorities are not kept, call EnablePrioritizedSampling() first");
+    History* history = &GetHistory(id);
+    return SampleStratified(n, history->data.GetTotalPriority(), [id, history](double&) {
+        return std::make_pair(id, history);
+    });
+}
 
-NS_LOG_COMPONENT_DEFINE("HistoryContainer");
+void
+HistoryContainer::SetRetentionPolicy(RetentionPolicy policy, uint parameter)
+{
+    NS_ASSERT_MSG(m_historyCount == 0, "The retention policy has to be set before the first push");
+    NS_ASSERT_MSG(parameter > 0 || (policy != DECIMATE && policy != HYBRID),
+                  "Decimation and hybrid retention require a positive parameter");
+    m_retention = policy;
+    m_retentionParameter = parameter;
+}
 
-TimestampedData::TimestampedData(Ptr<OpenGymDictContainer> data, bool trackNs3Time)
-    : data(data),
-      timestamp(std::chrono::system_clock::now())
+HistoryContainer::RetentionPolicy
+HistoryContainer::GetRetentionPolicy() const
 {
-    if (trackNs3Time)
+    return m_retention;
+}
+
+HistoryContainer::RetentionPolicy
+HistoryContainer::ParseRetentionPolicy(const std::string& name)
+{
+    if (name == "LastN")
     {
-        ns3timestamp = Simulator::Now().ToInteger(Time::Unit::MS);
+        return LAST_N;
     }
-    else
+    if (name == "Decimate")
+    {
+        return DECIMATE;
+    }
+    if (name == "Reservoir")
     {
-        ns3timestamp = -1;
+        return RESERVOIR;
     }
+    NS_ABORT_MSG_IF(name != "Hybrid",
+                    "Unknown retention policy "
+                        << name << ", expected LastN, Decimate, Reservoir or Hybrid");
+    return HYBRID;
+}
+
+TimestampedDataView
+HistoryContainer::GetReservoir(uint id)
+{
+    return GetHistory(id).reservoir.GetAll();
 }
 
 void
-TimestampedDataDeque::Push(TimestampedData value)
+HistoryContainer::EnableCompression(uint keyframeInterval)
 {
-    m_deque.push_back(value);
+    NS_ASSERT_MSG(m_historyCount == 0, "Compression has to be enabled before the first push");
+    NS_ASSERT_MSG(keyframeInterval > 0, "The keyframe interval has to be positive");
+    NS_ASSERT_MSG(m_frameStackDepth == 0, "Compression and frame stacking exclude each other");
+    m_keyframeInterval = keyframeInterval;
+    m_columnar = true;
 }
 
 void
-TimestampedDataDeque::PopNewest(uint count)
+HistoryContainer::EnableFrameStacking(uint k, Ptr<OpenGymDictContainer> resetObservation)
 {
-    while (count > 0 && !m_deque.empty())
-    {
-        m_deque.pop_back();
-        count--;
-    }
+    NS_ASSERT_MSG(m_historyCount == 0, "Frame stacking has to be enabled before the first push");
+    NS_ASSERT_MSG(k > 0 && k <= m_historyLength,
+                  "The frame stack depth has to be in [1, history length]");
+    NS_ASSERT_MSG(m_keyframeInterval == 0, "Compression and frame stacking exclude each other");
+    m_frameStackDepth = k;
+    m_framePadding = resetObservation;
+    m_columnar = true;
 }
 
 void
-TimestampedDataDeque::PopOldest(uint count)
+HistoryContainer::AddTier(Time width, uint bucketCount)
 {
-    while (count > 0 && !m_deque.empty())
-    {
-        m_deque.pop_front();
-        count--;
-    }
+    NS_ASSERT_MSG(width.IsStrictlyPositive(), "The width of a bucket has to be positive");
+    NS_ASSERT_MSG(bucketCount > 0, "A tier needs at least one bucket");
+    // keep the tiers ordered from the finest to the coarsest buckets
+    auto position = std::upper_bound(m_tiers.begin(),
+                                     m_tiers.end(),
+                                     width,
+                                     [](Time w, const auto& tier) { return w < tier.first; });
+    uint index = std::distance(m_tiers.begin(), position);
+    m_tiers.insert(position, {width, bucketCount});
+
+    // the new tier starts empty, since the simulation time of stored entries may not be tracked
+    ForEachHistory([index, width, bucketCount](uint id, History& history) {
+        history.tiers.insert(history.tiers.begin() + index, HistoryTier(width, bucketCount));
+    });
 }
 
-std::vector<TimestampedData*>
-TimestampedDataDeque::GetOldest(uint count)
+std::map<std::string, AggregatedInfo>
+HistoryContainer::AggregateTrend(uint id, Time span)
 {
-    std::vector<TimestampedData*> firstElements;
-    uint i = 0;
-    for (auto it = m_deque.begin(); it != m_deque.end() && i < count; ++it, ++i)
-    {
-        firstElements.push_back(&*it);
-    }
-    return firstElements;
+    Time now = Simulator::Now();
+    return SelectTier(GetHistory(id), span).GetInfo(now - span, now);
 }
 
-std::vector<TimestampedData*>
-TimestampedDataDeque::GetNewest(uint count)
+AggregatedInfo
+HistoryContainer::AggregateTrend(uint id, KeyId key, Time span)
 {
-    std::vector<TimestampedData*> lastElements;
-    uint i = 0;
-    for (auto it = m_deque.rbegin(); it != m_deque.rend() && i < count; ++it, ++i)
+    Time now = Simulator::Now();
+    auto info = SelectTier(GetHistory(id), span).GetInfo(key, now - span, now);
+    return info.value_or(AggregatedInfo());
+}
+
+std::vector<TierBucket>
+HistoryContainer::GetTierBuckets(uint id, uint tier)
+{
+    auto& tiers = GetHistory(id).tiers;
+    NS_ASSERT_MSG(tier < tiers.size(), "There is no tier " << tier);
+    return tiers[tier].GetBuckets(Simulator::Now());
+}
+
+const HistoryTier&
+HistoryContainer::SelectTier(const History& history, Time span) const
+{
+    NS_ASSERT_MSG(!history.tiers.empty(), "No tiers were added, call AddTier() first");
+    for (const auto& tier : history.tiers)
     {
-        lastElements.push_back(&*it);
+        if (tier.GetSpan() >= span)
+        {
+            return tier;
+        }
     }
-    return lastElements;
+    return history.tiers.back();
 }
 
-std::vector<TimestampedData*>
-TimestampedDataDeque::GetAll()
+void
+HistoryContainer::EnableReplayBuffer(const std::string& directory, uint64_t capacity)
 {
-    return GetNewest(Size());
+    NS_ASSERT_MSG(!directory.empty(), "The replay buffer directory must not be empty");
+    m_replayDirectory = directory;
+    m_replayCapacity = capacity;
+    ForEachHistory([this](uint id, History& history) { CreateReplayBuffer(id, history); });
 }
 
 void
-TimestampedDataDeque::Clear()
+HistoryContainer::CreateReplayBuffer(uint id, History& history)
 {
-    m_deque.clear();
+    std::string path = m_replayDirectory + "/history-" + std::to_string(id) + ".replay";
+    history.replay = std::make_shared<ReplayBuffer>(path, m_replayCapacity);
 }
 
-uint
-TimestampedDataDeque::Size() const
+ReplayBuffer*
+HistoryContainer::GetReplayBuffer(uint id)
 {
-    return m_deque.size();
+    return GetHistory(id).replay.get();
 }
 
-HistoryContainer::HistoryContainer(uint historyLength, bool trackNs3Time)
-    : m_historyCount{0},
-      m_historyLength{historyLength},
-      m_trackNs3Time{trackNs3Time}
+void
+HistoryContainer::EnableReturns(const std::string& rewardKey,
+                                double gamma,
+                                double lambda,
+                                uint nSteps,
+                                uint rolloutLength,
+                                const std::string& valueKey,
+                                const std::string& doneKey)
 {
+    m_returns.emplace(gamma, lambda, nSteps, rolloutLength);
+    m_returnsRewardKey = KeyRegistry::Intern(rewardKey);
+    m_returnsValueKey = valueKey.empty() ? KeyRegistry::INVALID : KeyRegistry::Intern(valueKey);
+    m_returnsDoneKey = doneKey.empty() ? KeyRegistry::INVALID : KeyRegistry::Intern(doneKey);
 }
 
-HistoryContainer::~HistoryContainer()
+ReturnsCalculator*
+HistoryContainer::GetReturnsCalculator()
 {
+    return m_returns ? &*m_returns : nullptr;
 }
 
-uint
-HistoryContainer::GetHistoryCount() const
+bool
+HistoryContainer::ReadScalar(Ptr<OpenGymDictContainer> dict, KeyId key, float& value)
 {
-    return m_historyCount;
+    return VisitBox(GetDictValue(dict, key),
+                    [&value](auto* box) { value = static_cast<float>(box->GetValue(0)); });
 }
 
 void
-HistoryContainer::Push(Ptr<OpenGymDictContainer> obs, uint id)
+HistoryContainer::PushReturn(uint id, Ptr<OpenGymDictContainer> obs)
 {
-    if (m_histories.find(id) == m_histories.end())
+    float reward;
+    if (!ReadScalar(obs, m_returnsRewardKey, reward))
     {
-        NS_LOG_INFO("No history with id " << id << " found, creating new history.");
-        this->m_histories.insert(std::make_pair(id, TimestampedDataDeque()));
-        this->m_historyCount++;
+        NS_LOG_WARN("No reward box under key " << KeyRegistry::GetKey(m_returnsRewardKey)
+                                               << " in the data entry of history " << id);
+        return;
+    }
+    float value = 0;
+    float done = 0;
+    ReadScalar(obs, m_returnsValueKey, value);
+    ReadScalar(obs, m_returnsDoneKey, done);
+    m_returns->Push(id, reward, value, done != 0);
+}
+
+void
+HistoryContainer::TrackQuantiles(uint k)
+{
+    m_quantileK = k;
+}
+
+std::map<std::string, AggregatedInfo>
+HistoryContainer::AggregateHorizon(uint id)
+{
+    NS_ASSERT_MSG(m_quantileK > 0, "Quantiles are not tracked, call TrackQuantiles() first");
+    std::map<std::string, AggregatedInfo> horizon;
+    const auto& infos = GetHistory(id).horizon;
+    for (KeyId key = 0; key < infos.size(); key++)
+    {
+        if (infos[key])
+        {
+            horizon.emplace(KeyRegistry::GetKey(key), *infos[key]);
+        }
+    }
+    return horizon;
+}
+
+void
+HistoryContainer::UpdateHorizon(History& history, Ptr<OpenGymDictContainer> dict, bool stored)
+{
+    const auto& data = history.data;
+    uint slot = data.IsColumnar() && stored ? data.GetNewestSlot(0) : 0;
+    bool complete = stored && data.IsComplete(slot);
+    for (const auto& [key, value] : history.keys.Resolve(dict))
+    {
+        if (key >= history.horizon.size())
+        {
+            history.horizon.resize(key + 1);
+        }
+        auto& info = history.horizon[key];
+        if (!info)
+        {
+            info.emplace();
+            info->EnableQuantiles(m_quantileK);
+        }
+        const HistoryColumn* column = complete ? data.GetColumn(key) : nullptr;
+        if (column && column->IsValid(slot))
+        {
+            column->Aggregate(slot, *info);
+        }
+        else
+        {
+            AggregateBox(value, *info);
+        }
     }
+}
 
-    TimestampedData timestampedData = TimestampedData(obs, m_trackNs3Time);
-    m_histories[id].Push(timestampedData);
-    m_combinedHistory.Push(timestampedData);
-    if (m_histories[id].Size() > m_historyLength)
+void
+HistoryContainer::AddAggregationWindow(uint n)
+{
+    uint length = std::min(n, m_historyLength);
+    if (length == 0 || std::find(m_windowLengths.begin(), m_windowLengths.end(), length) !=
+                           m_windowLengths.end())
     {
-        m_histories[id].PopOldest(1);
+        return;
     }
-    if (m_combinedHistory.Size() > (m_historyLength * m_historyCount))
+    m_windowLengths.push_back(length);
+
+    // fill the new window with the entries that are already stored
+    ForEachHistory([this, length](uint id, History& history) {
+        SlidingWindowAggregator window(length);
+        FillWindow(history, window);
+        history.windows.push_back(window);
+    });
+}
+
+void
+HistoryContainer::FillWindow(History& history, SlidingWindowAggregator& window)
+{
+    window.Clear();
+    DictKeyCache keys;
+    for (uint offset = history.data.Size(); offset > 0; offset--)
     {
-        m_combinedHistory.PopOldest(1);
+        window.Push(AggregateEntry(history.data, offset - 1, keys));
     }
 }
 
 bool
 HistoryContainer::AssertHistoryExists(uint id)
 {
-    NS_ASSERT_MSG(m_histories.find(id) != m_histories.end(),
-                  "No history with id " << id << " found");
+    NS_ASSERT_MSG(FindHistory(id), "No history with id " << id << " found");
     return HistoryExists(id);
 }
 
 bool
 HistoryContainer::HistoryExists(uint id)
 {
-    return m_histories.find(id) != m_histories.end();
+    return FindHistory(id) != nullptr;
+}
+
+HistoryContainer::History*
+HistoryContainer::FindHistory(uint id)
+{
+    if (id < m_denseHistories.size())
+    {
+        auto& history = m_denseHistories[id];
+        if (history)
+        {
+            return &*history;
+        }
+    }
+    if (m_sparseHistories.empty())
+    {
+        return nullptr;
+    }
+    auto history = m_sparseHistories.find(id);
+    return history == m_sparseHistories.end() ? nullptr : &history->second;
+}
+
+HistoryContainer::History&
+HistoryContainer::GetHistory(uint id)
+{
+    History* history = FindHistory(id);
+    NS_ASSERT_MSG(history, "No history with id " << id << " found");
+    Expire(*history);
+    return *history;
+}
+
+HistoryContainer::History&
+HistoryContainer::AddHistory(uint id, History history)
+{
+    // ids are dense if they are small compared to the number of histories, so at least half of
+    // the dense slots are in use
+    if (id < std::max<size_t>(MIN_DENSE_IDS, 2 * (m_historyCount + 1)))
+    {
+        if (id >= m_denseHistories.size())
+        {
+            m_denseHistories.resize(id + 1);
+        }
+        return m_denseHistories[id].emplace(std::move(history));
+    }
+    return m_sparseHistories.emplace(id, std::move(history)).first->second;
 }
 
 std::map<std::string, AggregatedInfo>
 HistoryContainer::AggregateNewest(uint id, uint n)
 {
     std::map<std::string, AggregatedInfo> returned_agg;
-    auto datavec = GetNewestByID(id, n);
-    for (const auto& d : datavec)
+    auto& history = GetHistory(id);
+    for (const auto& window : history.windows)
     {
-        auto dict = d->data;
-        std::map<std::string, AggregatedInfo> tmp = GetInfoFromDict(dict);
+        if (m_retention != RESERVOIR && window.GetLength() == std::min(n, m_historyLength))
+        {
+            return window.GetInfo();
+        }
+    }
 
-        for (const auto& key : tmp)
+    DictKeyCache keys;
+    uint size = std::min(n, history.data.Size());
+    for (uint i = 0; i < size; i++)
+    {
+        for (const auto& [key, info] : AggregateEntry(history.data, i, keys))
         {
-            returned_agg[key.first].UpdateStatistics(tmp[key.first]);
+            returned_agg[KeyRegistry::GetKey(key)].UpdateStatistics(info);
         }
     }
     return returned_agg;
 }
 
-std::map<std::string, AggregatedInfo>
-HistoryContainer::GetInfoFromDict(Ptr<OpenGymDictContainer> dict)
+AggregatedInfo
+HistoryContainer::Aggregate(uint id, const std::string& key, uint n, int stats)
 {
-    std::map<std::string, AggregatedInfo> aggregator;
+    // a key that was never interned is not stored in any column, but may be in the dictionaries
+    return Aggregate(id, KeyRegistry::Find(key), key, n, stats);
+}
+
+AggregatedInfo
+HistoryContainer::Aggregate(uint id, KeyId key, uint n, int stats)
+{
+    if (key == KeyRegistry::INVALID)
+    {
+        // the history has to exist even if the key is unknown
+        GetHistory(id);
+        return AggregatedInfo();
+    }
+    return Aggregate(id, key, KeyRegistry::GetKey(key), n, stats);
+}
 
-    for (const auto& key : dict->GetKeys())
+AggregatedInfo
+HistoryContainer::Aggregate(uint id, KeyId key, const std::string& name, uint n, int stats)
+{
+    AggregatedInfo result;
+    auto& history = GetHistory(id);
+    for (const auto& window : history.windows)
     {
-        // turn data into box and go through object
-        Ptr<OpenGymDataContainer> tmp = dict->Get(key);
-        auto intbox = tmp->GetObject<OpenGymBoxContainer<uint>>();
-        auto floatbox = tmp->GetObject<OpenGymBoxContainer<float>>();
-        auto uintbox = tmp->GetObject<OpenGymBoxContainer<uint32_t>>();
-        auto doublebox = tmp->GetObject<OpenGymBoxContainer<double>>();
-        AggregatedInfo tmpagg;
-        // ugly casting because its the fastest way
-        if (PeekPointer(intbox))
+        if (m_retention != RESERVOIR && window.GetLength() == std::min(n, m_historyLength))
         {
-            for (auto it : intbox->GetData())
-            {
-                tmpagg.UpdateStatistics((float)it);
-            }
+            return window.GetInfo(key, stats).value_or(result);
         }
-        else if (PeekPointer(floatbox))
+    }
+
+    TimestampedDataDeque& data = history.data;
+    const HistoryColumn* column = data.GetColumn(key);
+    uint size = std::min(n, data.Size());
+    for (uint offset = 0; offset < size; offset++)
+    {
+        uint slot = data.IsColumnar() ? data.GetNewestSlot(offset) : 0;
+        if (column && column->IsValid(slot))
         {
-            for (auto it : floatbox->GetData())
-            {
-                tmpagg.UpdateStatistics(it);
-            }
+            column->AggregateEntry(slot, result, stats);
+            continue;
         }
-        else if (PeekPointer(uintbox))
+        if (data.IsComplete(slot))
         {
-            for (auto it : uintbox->GetData())
-            {
-                tmpagg.UpdateStatistics((float)it);
-            }
+            // all values of the entry are in the columns, so it does not contain the key
+            continue;
         }
-        else if (PeekPointer(doublebox))
+        auto dict = data.GetNewestAt(offset)->data;
+        auto value = dict ? dict->Get(name) : nullptr;
+        if (value)
         {
-            for (auto it : doublebox->GetData())
-            {
-                tmpagg.UpdateStatistics((float)it);
-            }
+            AggregateBoxEntry(value, result, stats);
         }
-        else
+    }
+    return result;
+}
+
+KeyedInfo
+HistoryContainer::AggregateEntry(TimestampedDataDeque& data, uint offset, DictKeyCache& keys)
+{
+    uint slot = data.IsColumnar() ? data.GetNewestSlot(offset) : 0;
+    if (!data.IsComplete(slot))
+    {
+        return GetInfoFromDict(keys.Resolve(data.GetNewestAt(offset)->data));
+    }
+
+    // read the values from the contiguous columns instead of the dictionary
+    KeyedInfo aggregator;
+    const auto& columns = data.GetColumns();
+    for (KeyId key = 0; key < columns.size(); key++)
+    {
+        if (columns[key] && columns[key]->IsValid(slot))
         {
-            NS_ABORT_MSG("not implemented!");
+            aggregator.emplace_back(key, columns[key]->Aggregate(slot));
         }
-        aggregator[key] = tmpagg;
     }
     return aggregator;
 }
 
+KeyedInfo
+HistoryContainer::GetInfoFromDict(const std::vector<DictKeyCache::Entry>& entries)
+{
+    KeyedInfo aggregator;
+
+    for (const auto& [key, value] : entries)
+    {
+        AggregateBox(value, aggregator.emplace_back(key, AggregatedInfo()).second);
+    }
+    return aggregator;
+}
+
+void
+HistoryContainer::AggregateBox(Ptr<OpenGymDataContainer> data, AggregatedInfo& info)
+{
+    bool isBox = VisitBox(data, [&info](auto* box) {
+        auto values = box->GetData();
+        info.UpdateStatistics(values.data(), values.size());
+    });
+    NS_ABORT_MSG_IF(!isBox, "not implemented!");
+}
+
+void
+HistoryContainer::AggregateBoxEntry(Ptr<OpenGymDataContainer> data, AggregatedInfo& info, int stats)
+{
+    bool isBox = VisitBox(data, [&info, stats](auto* box) {
+        auto values = box->GetData();
+        info.UpdateEntry(values.data(), values.size(), stats);
+    });
+    NS_ABORT_MSG_IF(!isBox, "not implemented!");
+}
+
+template <typename F>
+void
+HistoryContainer::ForEachLatestRow(KeyId key, const std::string& name, F function)
+{
+    ExpireAll();
+    ForEachHistory([&](uint id, History& history) {
+        TimestampedDataDeque& data = history.data;
+        if (data.Size() == 0)
+        {
+            return;
+        }
+        uint slot = data.IsColumnar() ? data.GetNewestSlot(0) : 0;
+        const HistoryColumn* column = data.GetColumn(key);
+        if (column && column->IsValid(slot))
+        {
+            column->VisitRow(slot,
+                             [&](const auto* row) { function(id, row, column->GetRowLength()); });
+            return;
+        }
+        if (data.IsComplete(slot))
+        {
+            return;
+        }
+        auto dict = data.GetNewestAt(0)->data;
+        auto value = dict ? dict->Get(name) : nullptr;
+        if (value)
+        {
+            VisitBox(value, [&](auto* box) {
+                auto values = box->GetData();
+                function(id, values.data(), values.size());
+            });
+        }
+    });
+}
+
+AggregatedInfo
+HistoryContainer::ReduceLatest(const std::string& key)
+{
+    // a key that was never interned is not stored in any column, but may be in the dictionaries
+    return ReduceLatest(KeyRegistry::Find(key), key);
+}
+
+AggregatedInfo
+HistoryContainer::ReduceLatest(KeyId key)
+{
+    if (key == KeyRegistry::INVALID)
+    {
+        return AggregatedInfo();
+    }
+    return ReduceLatest(key, KeyRegistry::GetKey(key));
+}
+
+AggregatedInfo
+HistoryContainer::ReduceLatest(KeyId key, const std::string& name)
+{
+    AggregatedInfo info;
+    ForEachLatestRow(key, name, [&info](uint id, const auto* row, uint length) {
+        info.UpdateStatistics(row, length);
+    });
+    return info;
+}
+
+StackedRows
+HistoryContainer::StackLatest(const std::string& key)
+{
+    StackedRows stack;
+    StackLatest(KeyRegistry::Find(key), key, stack);
+    return stack;
+}
+
+void
+HistoryContainer::StackLatest(KeyId key, StackedRows& stack)
+{
+    if (key == KeyRegistry::INVALID)
+    {
+        stack.values.clear();
+        stack.ids.clear();
+        stack.rowLength = 0;
+        stack.info = AggregatedInfo();
+        return;
+    }
+    StackLatest(key, KeyRegistry::GetKey(key), stack);
+}
+
+void
+HistoryContainer::StackLatest(KeyId key, const std::string& name, StackedRows& stack)
+{
+    stack.values.clear();
+    stack.ids.clear();
+    stack.rowLength = 0;
+    stack.info = AggregatedInfo();
+    ForEachLatestRow(key, name, [&stack](uint id, const auto* row, uint length) {
+        if (stack.ids.empty())
+        {
+            stack.rowLength = length;
+        }
+        else if (length != stack.rowLength)
+        {
+            return;
+        }
+        size_t start = stack.values.size();
+        stack.values.insert(stack.values.end(), row, row + length);
+        stack.ids.push_back(id);
+        stack.info.UpdateStatistics(stack.values.data() + start, length);
+    });
+}
+
 std::vector<TimestampedData*>
 HistoryContainer::GetNewestOfCombinedHistory(uint n)
 {
-    return m_combinedHistory.GetNewest(n);
+    // the next candidate of each history deque, the newest candidate on top of the heap
+    struct Cursor
+    {
+        uint64_t sequence;
+        TimestampedDataDeque* deque;
+        uint offset;
+
+        bool operator<(const Cursor& other) const
+        {
+            return sequence < other.sequence;
+        }
+    };
+
+    ExpireAll();
+    std::vector<Cursor> cursors;
+    cursors.reserve(m_historyCount);
+    ForEachHistory([&cursors](uint id, History& history) {
+        if (history.data.Size() > 0)
+        {
+            cursors.push_back({history.data.GetSequence(0), &history.data, 0});
+        }
+    });
+    std::priority_queue<Cursor> heap(std::less<Cursor>(), std::move(cursors));
+
+    // restored dictionaries of compressed deques are only kept until the next call
+    m_combinedEntries.clear();
+    m_combinedEntries.reserve(std::min(n, GetSizeOfHistory()));
+    std::vector<TimestampedData*> newest;
+    while (newest.size() < n && !heap.empty())
+    {
+        Cursor cursor = heap.top();
+        heap.pop();
+        TimestampedData* entry = cursor.deque->GetNewestAt(cursor.offset);
+        if (cursor.deque->GetKeyframeInterval() > 0)
+        {
+            m_combinedEntries.push_back(*entry);
+            entry = &m_combinedEntries.back();
+        }
+        newest.push_back(entry);
+        if (++cursor.offset < cursor.deque->Size())
+        {
+            cursor.sequence = cursor.deque->GetSequence(cursor.offset);
+            heap.push(cursor);
+        }
+    }
+    return newest;
 }
 
-std::vector<TimestampedData*>
+TimestampedDataView
 HistoryContainer::GetNewestByID(uint id, uint n)
 {
-    AssertHistoryExists(id);
-    return m_histories[id].GetNewest(n);
+    return GetHistory(id).data.GetNewest(n);
 }
 
 TimestampedData*
 HistoryContainer::GetNewestByID(uint id)
 {
-    return GetNewestByID(id, 1)[0];
+    return GetHistory(id).data.GetNewestAt(0);
+}
+
+TimestampedDataView
+HistoryContainer::GetRangeByID(uint id, Time from, Time to)
+{
+    NS_ASSERT_MSG(m_trackNs3Time, "Range queries require tracking the ns3 simulation time");
+    return GetHistory(id).data.GetRange(from.GetTimeStep(), to.GetTimeStep());
+}
+
+TimestampedDataView
+HistoryContainer::GetSince(uint id, Time t)
+{
+    return GetRangeByID(id, t, Time::Max());
 }
 
 TimestampedData*
 HistoryContainer::GetNewestOfCombinedHistory()
 {
-    return GetNewestOfCombinedHistory(1)[0];
+    auto newest = GetNewestOfCombinedHistory(1);
+    NS_ASSERT_MSG(!newest.empty(), "No data entries stored");
+    return newest[0];
+}
+
+const HistoryColumn*
+HistoryContainer::GetColumn(uint id, const std::string& key)
+{
+    return GetHistory(id).data.GetColumn(key);
+}
+
+const HistoryColumn*
+HistoryContainer::GetColumn(uint id, KeyId key)
+{
+    return GetHistory(id).data.GetColumn(key);
 }
 
 uint
 HistoryContainer::GetSize(uint id)
 {
-    AssertHistoryExists(id);
-    return m_histories[id].Size();
+    return GetHistory(id).data.Size();
 };
 
 uint
 HistoryContainer::GetSizeOfHistory()
 {
-    return m_combinedHistory.Size();
+    uint size = 0;
+    ExpireAll();
+    ForEachHistory([&size](uint id, History& history) { size += history.data.Size(); });
+    return size;
 };
 
 void
 HistoryContainer::Print(std::ostream& where)
 {
     uint i = 0;
-    for (auto& [id, history] : m_histories)
-    {
-        if (history.Size() > 0)
+    ExpireAll();
+    ForEachHistory([&where, &i](uint id, History& history) {
+        if (history.data.Size() > 0)
         {
             where << "History at: " << std::to_string(i)
-                  << " of type: " << history.GetNewest(1)[0]->data->GetTypeId() << " with size "
-                  << history.Size() << "\n";
+                  << " of type: " << history.data.GetNewestAt(0)->data->GetTypeId()
+                  << " with size " << history.data.Size() << "\n";
         }
         i++;
-    }
+    });
 }
 
 void
@@ -272,42 +1999,20 @@ HistoryContainer::PrintHistory(std::ostream& where, uint id, ns3_ai_gym::SpaceTy
 {
     if (type == ns3_ai_gym::Box)
     {
-        for (auto obs : m_histories[id].GetAll())
+        for (auto obs : GetHistory(id).data.GetAll())
         {
-            std::time_t currentTime = std::chrono::system_clock::to_time_t(obs->timestamp);
-
             auto dict = obs->data->GetObject<OpenGymDictContainer>();
             for (auto key : dict->GetKeys())
             {
                 Ptr<OpenGymDataContainer> tmp = dict->Get(key);
-                auto intbox = tmp->GetObject<OpenGymBoxContainer<uint>>();
-                auto floatbox = tmp->GetObject<OpenGymBoxContainer<float>>();
-                auto uintbox = tmp->GetObject<OpenGymBoxContainer<uint32_t>>();
-                auto doublebox = tmp->GetObject<OpenGymBoxContainer<double>>();
                 where << "Data collected, id=" << id << ": ";
-
-                // ugly casting because its the fastest way
-                if (PeekPointer(intbox))
-                {
-                    intbox->Print(where);
-                }
-                else if (PeekPointer(floatbox))
-                {
-                    floatbox->Print(where);
-                }
-                else if (uintbox)
-                {
-                    uintbox->Print(where);
-                }
-                else if (PeekPointer(doublebox))
-                {
-                    doublebox->Print(where);
-                }
-                else
+                bool isBox = VisitBox(tmp, [&where](auto* box) { box->Print(where); });
+                NS_ABORT_MSG_IF(!isBox, "not implemented!");
+                if (obs->ns3timestamp >= 0)
                 {
-                    NS_ABORT_MSG("not implemented!");
+                    where << " at time: " << obs->GetNs3Time();
                 }
-                where << " at time: " << std::ctime(&currentTime);
+                where << "\n";
             }
         }
         where << "\n";
@@ -322,8 +2027,26 @@ void
 HistoryContainer::DeleteHistory(uint id)
 {
     AssertHistoryExists(id);
-    auto history = m_histories.find(id);
-    this->m_histories.erase(history);
+    if (m_budgetLink.budget)
+    {
+        m_budgetLink.budget->Update(0, GetHistoryBytes(GetHistory(id)));
+    }
+    if (m_prioritized)
+    {
+        // the index cannot be drawn anymore until it is reused by a new history
+        uint sampleIndex = GetHistory(id).sampleIndex;
+        m_historyPriorities.Set(sampleIndex, 0);
+        m_freeSampleIndices.push_back(sampleIndex);
+    }
+    if (id < m_denseHistories.size() && m_denseHistories[id])
+    {
+        m_denseHistories[id].reset();
+    }
+    else
+    {
+        m_sparseHistories.erase(id);
+    }
+    m_snapshots.stale = true;
 
     this->m_historyCount--;
 }
@@ -2,6 +2,15 @@
 #define HISTORY_CONTAINER_H
 
 #include "aggregated-info.h"
+#include "history-column.h"
+#include "history-snapshot.h"
+#include "history-tier.h"
+#include "key-registry.h"
+#include "memory-budget.h"
+#include "replay-buffer.h"
+#include "returns-calculator.h"
+#include "sliding-window-aggregator.h"
+#include "sum-tree.h"
 
 #include <ns3/ai-module.h>
 #include <ns3/core-module.h>
@@ -11,25 +20,40 @@
 #include <climits>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
 #include <sys/types.h>
 #include <vector>
 
 namespace ns3
 {
 
+class TimestampedDataDeque;
+
 /**
  * \ingroup defiance
  * \class TimestampedData
  * \brief A helper class to store OpenGymDictContainer data with a timestamp.
- * The timestamp is recorded both at simulation time and system time. One can choose whether to
- * track the ns3 simulation time, because it adds runtime overhead (for 100k obs ~ 0.1s).
+ * The timestamp can be recorded at simulation time and at wall-clock time. Both are opt-in,
+ * because reading the clocks adds runtime overhead to every push (for 100k obs ~ 0.1s).
  */
 class TimestampedData
 {
   public:
     Ptr<OpenGymDictContainer> data;
-    std::chrono::system_clock::time_point timestamp;
-    int64_t ns3timestamp;
+    std::chrono::steady_clock::time_point timestamp; //!< Wall-clock time, epoch if not tracked
+    int64_t ns3timestamp; //!< Simulation time in ns-3 time steps, -1 if not tracked
+    uint64_t sequence;    //!< Position in the push order of the owning HistoryContainer or its
+                          //!< MemoryBudget
+
+    /**
+     * \brief Creates an empty TimestampedData object. Used to preallocate the slots of a
+     * TimestampedDataDeque.
+     */
+    TimestampedData();
 
     /**
      * \brief Creates a new TimestampedData object.
@@ -37,21 +61,229 @@ class TimestampedData
      * \param data contains the dictionary with the observation/reward data as key-value pairs of
      * strings and OpenGymBoxContainers.
      * \param trackNs3Time boolean to decide whether the ns3 simulation time should be tracked.
+     * \param trackWallTime boolean to decide whether the monotonic wall-clock time should be
+     * tracked.
      */
-    TimestampedData(Ptr<OpenGymDictContainer> data, bool trackNs3Time);
+    TimestampedData(Ptr<OpenGymDictContainer> data, bool trackNs3Time, bool trackWallTime = false);
+
+    /**
+     * \return the simulation time at which the data was stored. Only meaningful if the ns3
+     * simulation time is tracked.
+     */
+    Time GetNs3Time() const;
+};
+
+/**
+ * \ingroup defiance
+ * \class TimestampedDataView
+ * \brief A lightweight range over data entries stored in a TimestampedDataDeque, ordered either
+ * newest first or oldest first. The view refers to the storage of the deque instead of copying
+ * pointers into a vector, so creating and iterating it does not allocate memory. Like a
+ * \c std::span, the view is only valid until the deque is modified. The dictionary of an entry of
+ * a compressed deque is restored when the entry is accessed and only kept until another entry of
+ * the deque is restored, so a Ptr to it has to be held to use it longer.
+ */
+class TimestampedDataView
+{
+  public:
+    /**
+     * \brief Iterator over the data entries of a view, dereferencing to a pointer to the entry.
+     */
+    class Iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TimestampedData*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = TimestampedData**;
+        using reference = TimestampedData*;
+
+        Iterator(const TimestampedDataView* view, uint index)
+            : m_view(view),
+              m_index(index)
+        {
+        }
+
+        TimestampedData* operator*() const
+        {
+            return (*m_view)[m_index];
+        }
+
+        Iterator& operator++()
+        {
+            m_index++;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            m_index++;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return m_index == other.m_index;
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+            return m_index != other.m_index;
+        }
+
+      private:
+        const TimestampedDataView* m_view; //!< The iterated view
+        uint m_index;                      //!< Position in the view
+    };
+
+    /**
+     * \brief Creates an empty view.
+     */
+    TimestampedDataView()
+        : m_buffer(nullptr),
+          m_capacity(0),
+          m_first(0),
+          m_size(0),
+          m_newestFirst(true),
+          m_owner(nullptr)
+    {
+    }
+
+    /**
+     * \brief Creates a view over a ring buffer.
+     * \param buffer the slots of the ring buffer.
+     * \param capacity the number of slots.
+     * \param first the slot of the first data entry of the view.
+     * \param size the number of data entries in the view.
+     * \param newestFirst whether the view walks from newer to older entries, i.e. backwards
+     * through the slots.
+     * \param owner the compressed deque to restore dropped dictionaries from, \c nullptr if the
+     * dictionaries are always stored.
+     */
+    TimestampedDataView(TimestampedData* buffer,
+                        uint capacity,
+                        uint first,
+                        uint size,
+                        bool newestFirst,
+                        TimestampedDataDeque* owner = nullptr)
+        : m_buffer(buffer),
+          m_capacity(capacity),
+          m_first(first),
+          m_size(size),
+          m_newestFirst(newestFirst),
+          m_owner(owner)
+    {
+    }
+
+    /**
+     * \param index the position in the view, has to be smaller than \c size().
+     * \return the data entry at the position.
+     */
+    TimestampedData* operator[](uint index) const;
+
+    /**
+     * \return the number of data entries in the view.
+     */
+    uint size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * \return \c true if the view contains no data entries, \c false otherwise.
+     */
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, 0);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, m_size);
+    }
+
+    /**
+     * \brief Copy the pointers to the data entries into a vector, e.g. to keep them across
+     * modifications of the deque.
+     */
+    operator std::vector<TimestampedData*>() const
+    {
+        return std::vector<TimestampedData*>(begin(), end());
+    }
+
+  private:
+    TimestampedData* m_buffer;     //!< Slots of the viewed ring buffer
+    uint m_capacity;               //!< Number of slots
+    uint m_first;                  //!< Slot of the first data entry of the view
+    uint m_size;                   //!< Number of data entries in the view
+    bool m_newestFirst;            //!< Whether the view walks backwards through the slots
+    TimestampedDataDeque* m_owner; //!< Compressed deque of the slots, if any
 };
 
 /**
  * \ingroup defiance
  * \class TimestampedDataDeque
- * \brief A class to store observation/reward data with timestamps in a deque. The class provides
- * basic methods for manipulation of the deque.
+ * \brief A class to store observation/reward data with timestamps in a fixed-capacity ring buffer.
+ * All slots are allocated when the capacity is set, so pushing data does not allocate memory. Once
+ * the buffer is full, every push overwrites the oldest data entry. The class provides basic methods
+ * for manipulation of the buffer.
+ *
+ * In columnar mode, the values of all OpenGymBoxContainers in the stored dictionaries are
+ * additionally copied into one HistoryColumn per dictionary key, and the ns-3 timestamps are kept
+ * in a parallel timestamp column. Rows of the columns are addressed by the slot of the data entry,
+ * see \c GetNewestSlot().
+ *
+ * In compressed mode, the columns of \c float boxes are XOR-encoded in blocks of
+ * \c keyframeInterval slots, see CompressedColumn, and the dictionaries of entries whose values
+ * are all stored in columns are dropped. A dropped dictionary is restored from the columns when
+ * the entry is accessed and kept in the entry until another entry is restored or the deque is
+ * modified, so reading a history does not inflate it. The deque keeps one spare block of slots,
+ * so that a block is only restarted once all of its entries were removed.
+ *
+ * With frame stacking, the uncompressed columns are laid out so that the rows of the newest
+ * \c depth entries form one contiguous block, see HistoryColumn::GetFrames(), which lets
+ * \c GetFrameStack() return a pointer into the column instead of copying the entries.
+ *
+ * With priorities, a SumTree over the slots holds a sampling priority of every stored entry. The
+ * priorities move with the entries and are reset when an entry is removed.
+ *
+ * With byte accounting, the estimated size of the dictionary of every stored entry is kept per
+ * slot, see GetContainerSize(), so that a MemoryBudget can be kept without estimating entries again
+ * when they are removed.
  */
 class TimestampedDataDeque
 {
   public:
     /**
-     * \brief Add a new data entry to the deque.
+     * \brief Creates a new TimestampedDataDeque.
+     * \param capacity the maximum number of data entries the deque can hold.
+     * \param columnar whether box values are additionally stored in HistoryColumns.
+     * \param keyframeInterval the number of slots per block of compressed columns, or 0 to keep
+     * the dictionaries uncompressed. Implies \c columnar if not 0.
+     */
+    TimestampedDataDeque(uint capacity = 0, bool columnar = false, uint keyframeInterval = 0);
+
+    /**
+     * \brief Change the maximum number of data entries the deque can hold. If the deque holds more
+     * data entries than the new capacity, the oldest ones are removed.
+     * \param capacity the new capacity.
+     */
+    void SetCapacity(uint capacity);
+
+    /**
+     * \return the maximum number of data entries the deque can hold.
+     */
+    uint GetCapacity() const;
+
+    /**
+     * \brief Add a new data entry to the deque. If the deque is full, the oldest data entry is
+     * overwritten.
      */
     void Push(TimestampedData value);
 
@@ -65,23 +297,58 @@ class TimestampedDataDeque
      */
     void PopOldest(uint count = 1);
 
+    /**
+     * \brief Remove the data entries with an ns-3 timestamp before \c timestamp, which are the
+     * oldest ones. Like \c GetRange(), this relies on the timestamps increasing in push order.
+     * \param timestamp the ns-3 timestamp of the oldest data entry to keep.
+     * \return the number of removed data entries.
+     */
+    uint PopOlderThan(int64_t timestamp);
+
+    /**
+     * \brief Remove a single data entry, keeping the order of the others. The newer entries are
+     * moved back by one slot within the ring buffer, so this takes time linear in \c offset and
+     * does not allocate memory.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     */
+    void Erase(uint offset);
+
     /**
      * \brief Get the \c count oldest data entries from the deque.
-     * \return a vector of data entries.
+     * \return a view of the data entries, starting with the oldest one.
      */
-    std::vector<TimestampedData*> GetOldest(uint count = 1);
+    TimestampedDataView GetOldest(uint count = 1);
 
     /**
      * \brief Get the \c count newest data entries from the deque.
-     * \return a vector of data entries.
+     * \return a view of the data entries, starting with the newest one.
      */
-    std::vector<TimestampedData*> GetNewest(uint count = 1);
+    TimestampedDataView GetNewest(uint count = 1);
+
+    /**
+     * \brief Get a single data entry without collecting the newer ones.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \return the data entry.
+     */
+    TimestampedData* GetNewestAt(uint offset);
 
     /**
      * \brief Get all data entries from the deque.
-     * \return a vector of data entries.
+     * \return a view of the data entries, starting with the newest one.
+     */
+    TimestampedDataView GetAll();
+
+    /**
+     * \brief Get the data entries whose ns-3 timestamp lies within a range. The range is found by
+     * binary search, which relies on the timestamps increasing in push order. Thus, the ns-3
+     * timestamps of all entries have to be tracked.
+     * \param from the first ns-3 timestamp of the range.
+     * \param to the last ns-3 timestamp of the range.
+     * \return a view of the data entries, starting with the newest one.
      */
-    std::vector<TimestampedData*> GetAll();
+    TimestampedDataView GetRange(int64_t from, int64_t to);
 
     /**
      * \brief Clear the deque.
@@ -93,8 +360,283 @@ class TimestampedDataDeque
      */
     uint Size() const;
 
+    /**
+     * \return \c true if box values are stored in HistoryColumns, \c false otherwise.
+     */
+    bool IsColumnar() const;
+
+    /**
+     * \return the number of slots per block of compressed columns, 0 if not compressed.
+     */
+    uint GetKeyframeInterval() const;
+
+    /**
+     * \brief Lay out the columns for stacks of the newest \c depth data entries. Has to be called
+     * before the first push in columnar mode without compression.
+     * \param depth the number of data entries per stack, at most the capacity.
+     * \param padding the dictionary whose boxes pad stacks of short histories, e.g. the reset
+     * observation, or \c nullptr to pad with zeros.
+     */
+    void SetFrameStacking(uint depth, Ptr<OpenGymDictContainer> padding = nullptr);
+
+    /**
+     * \brief Access the box values of the newest \c k data entries under an interned dictionary
+     * key as one block, oldest first. If fewer than \c k entries are stored, the block starts with
+     * padding rows.
+     * \param key the id of the dictionary key.
+     * \param k the number of data entries.
+     * \return a pointer to \c k x \c GetColumn(key)->GetRowLength() values, or \c nullptr if there
+     * is no uncompressed column of element type \c T for the key. The block points into the
+     * column for \c k up to the depth set with \c SetFrameStacking() and is valid until the next
+     * push.
+     */
+    template <typename T>
+    const T* GetFrameStack(KeyId key, uint k) const
+    {
+        auto column = GetColumn(key);
+        if (!column)
+        {
+            return nullptr;
+        }
+        return column->template GetFrames<T>(m_size ? GetNewestSlot() : 0, k, std::min(k, m_size));
+    }
+
+    /**
+     * \brief Keep a sampling priority for every data entry. Stored entries and entries pushed
+     * later get the largest priority set so far, initially 1.
+     */
+    void EnablePriorities();
+
+    /**
+     * \return \c true if the deque keeps sampling priorities, \c false otherwise.
+     */
+    bool HasPriorities() const;
+
+    /**
+     * \brief Set the sampling priority of a data entry.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \param priority the non-negative priority.
+     */
+    void SetPriority(uint offset, double priority);
+
+    /**
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \return the sampling priority of the data entry.
+     */
+    double GetPriority(uint offset) const;
+
+    /**
+     * \return the sum of the sampling priorities of all data entries, 0 without priorities.
+     */
+    double GetTotalPriority() const;
+
+    /**
+     * \brief Find the data entry at a prefix sum of the sampling priorities, see SumTree::Find().
+     * \param prefix the prefix sum in [0, \c GetTotalPriority()), set to the remainder within the
+     * found entry.
+     * \return the position of the data entry, 0 being the newest one.
+     */
+    uint FindPriority(double& prefix) const;
+
+    /**
+     * \brief Keep the estimated size of every data entry, see GetContainerSize(). The size is
+     * estimated once when an entry is pushed.
+     */
+    void EnableByteAccounting();
+
+    /**
+     * \return the estimated bytes of all stored data entries, 0 without byte accounting.
+     */
+    uint64_t GetStoredBytes() const;
+
+    /**
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \return the estimated bytes of the data entry, 0 without byte accounting.
+     */
+    uint64_t GetBytes(uint offset) const;
+
+    /**
+     * \brief Get the sequence number of a data entry without restoring its dictionary.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \return the sequence number of the data entry.
+     */
+    uint64_t GetSequence(uint offset) const;
+
+    /**
+     * \brief Restore the dictionary of the data entry in a slot if it was dropped in compressed
+     * mode. Does nothing otherwise. The dictionary of the previously restored entry is dropped
+     * again, so only one restored dictionary is kept at a time.
+     * \param slot the slot of the data entry.
+     */
+    void Materialize(uint slot);
+
+    /**
+     * \brief Restore the dictionary of the data entry in a slot from the columns without keeping
+     * it in the entry.
+     * \param slot the slot of a data entry whose values are all stored in columns.
+     * \return a new dictionary with the boxes of the entry.
+     */
+    Ptr<OpenGymDictContainer> Restore(uint slot) const;
+
+    /**
+     * \brief Get the slot of a data entry, which is the row of the entry in the HistoryColumns.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c Size().
+     * \return the slot of the data entry.
+     */
+    uint GetNewestSlot(uint offset = 0) const;
+
+    /**
+     * \brief Get the column of a dictionary key.
+     * \param key the dictionary key.
+     * \return the column, or \c nullptr if no box was stored under this key in columnar mode.
+     */
+    const HistoryColumn* GetColumn(const std::string& key) const;
+
+    /**
+     * \brief Get the column of an interned dictionary key.
+     * \param key the id of the dictionary key.
+     * \return the column, or \c nullptr if no box was stored under this key in columnar mode.
+     */
+    const HistoryColumn* GetColumn(KeyId key) const;
+
+    /**
+     * \return the columns of all dictionary keys stored in columnar mode, indexed by key id.
+     */
+    const std::vector<std::optional<HistoryColumn>>& GetColumns() const;
+
+    /**
+     * \brief Check whether all values of the data entry in a slot are stored in the columns.
+     * \param slot the slot of the data entry.
+     * \return \c true if every key of the dictionary has a valid row in its column, \c false if
+     * the dictionary has to be read instead.
+     */
+    bool IsComplete(uint slot) const;
+
+    /**
+     * \brief Read the timestamp column.
+     * \param slot the slot of the data entry.
+     * \return the ns-3 timestamp of the data entry in the slot.
+     */
+    int64_t GetTimestamp(uint slot) const;
+
   private:
-    std::deque<TimestampedData> m_deque;
+    std::vector<TimestampedData> m_buffer; //!< Preallocated slots of the ring buffer
+    uint m_head;                           //!< Slot of the oldest data entry
+    uint m_size;                           //!< Number of stored data entries
+    uint m_capacity;                       //!< Maximum number of stored data entries
+    bool m_columnar;                       //!< Whether box values are stored in columns
+    uint m_keyframeInterval;               //!< Slots per compressed block, 0 if not compressed
+    uint m_frameStackDepth;                //!< Entries per contiguous stack, 0 if not stacked
+    Ptr<OpenGymDictContainer> m_framePadding; //!< Boxes padding the stacks of short histories
+    std::optional<SumTree> m_priorities;      //!< Sampling priorities indexed by slot, if kept
+    double m_maxPriority;                     //!< Largest sampling priority set so far
+    bool m_accountBytes;                      //!< Whether the bytes of the entries are kept
+    std::vector<uint32_t> m_bytes;            //!< Estimated bytes of the entry in each slot
+    uint64_t m_storedBytes;                   //!< Estimated bytes of all stored entries
+    std::vector<std::optional<HistoryColumn>> m_columns; //!< Columns indexed by key id
+    DictKeyCache m_keys; //!< Key ids of the stored dictionaries, for the columns and their bytes
+    std::vector<uint8_t> m_complete; //!< Whether all values of a slot are stored in columns
+    std::vector<int64_t> m_timestamps; //!< Timestamp column with the ns-3 time of each slot
+    std::optional<uint> m_restored;    //!< Slot whose dictionary was restored by Materialize()
+
+    /**
+     * \param capacity a capacity in data entries.
+     * \return the number of slots needed for the capacity, including spare slots.
+     */
+    uint GetSlotCount(uint capacity) const;
+
+    /**
+     * \return this deque if dictionaries may have to be restored, \c nullptr otherwise.
+     */
+    TimestampedDataDeque* GetOwner();
+
+    /**
+     * \brief Drop the dictionary restored by \c Materialize(), if any.
+     */
+    void DropRestored();
+
+    /**
+     * \brief Move data entries into a new buffer, oldest first, and drop all others.
+     * \param capacity the capacity of the new buffer.
+     * \param slots the slots of the data entries to keep, oldest first.
+     */
+    void Relayout(uint capacity, const std::vector<uint>& slots);
+
+    /**
+     * \brief Copy the box values of the data entry in a slot into the columns.
+     * \param slot the slot of the data entry.
+     */
+    void StoreColumns(uint slot);
+
+    /**
+     * \brief Invalidate the rows of a slot in all columns.
+     * \param slot the slot to invalidate.
+     */
+    void InvalidateColumns(uint slot);
+
+    /**
+     * \brief Map a position relative to the oldest data entry to a slot in \c m_buffer.
+     * \param offset the position, 0 being the oldest data entry.
+     * \return the slot index.
+     */
+    uint Slot(uint offset) const;
+
+    /**
+     * \brief Count the data entries with an ns-3 timestamp of at most \c timestamp by binary
+     * search.
+     * \param timestamp the ns-3 timestamp.
+     * \return the number of data entries, which are the oldest ones.
+     */
+    uint CountUntil(int64_t timestamp) const;
+};
+
+inline TimestampedData*
+TimestampedDataView::operator[](uint index) const
+{
+    uint slot;
+    if (m_newestFirst)
+    {
+        slot = m_first >= index ? m_first - index : m_first + m_capacity - index;
+    }
+    else
+    {
+        slot = m_first + index < m_capacity ? m_first + index : m_first + index - m_capacity;
+    }
+    if (m_owner)
+    {
+        m_owner->Materialize(slot);
+    }
+    return &m_buffer[slot];
+}
+
+/**
+ * \ingroup defiance
+ * \brief The values of one dictionary key in the newest data entry of each history deque,
+ * stacked into a contiguous row-major buffer, see HistoryContainer::StackLatest().
+ */
+struct StackedRows
+{
+    std::vector<float> values; //!< Rows of all histories back to back, ids.size() x rowLength
+    std::vector<uint> ids;     //!< ID of the history deque of each row, in ascending order
+    uint rowLength = 0;        //!< Number of values per row
+    AggregatedInfo info;       //!< Statistics of all values in \c values
+};
+
+/**
+ * \ingroup defiance
+ * \brief A data entry drawn by HistoryContainer::SamplePrioritized().
+ */
+struct PrioritizedSample
+{
+    uint id;               //!< ID of the history deque of the entry
+    uint offset;           //!< Position of the entry in its history deque, 0 being the newest one
+    TimestampedData* data; //!< The data entry, valid until the next push to the history deque
+    double probability;    //!< Probability of drawing the entry, e.g. for importance weights
 };
 
 /**
@@ -102,22 +644,43 @@ class TimestampedDataDeque
  * \class HistoryContainer
  * \brief The main datastructure to store observation/reward data from different observation/reward
  * spaces.
- * It stores different deques for each observation/reward space \c m_deques and a history deque
- * containing all data \c m_historydeque. The number of last data to store each observation/reward
- * space deque is defined by \c m_historyLimit and the number of observation/reward spaces is
- * defined by \c m_dequeNumber. The class provides methods to manage the data.
+ * It stores different deques for each observation/reward space. The number of last
+ * data to store in each observation/reward space deque is defined by \c m_historyLength and the
+ * number of observation/reward spaces is defined by \c m_historyCount. All deques are ring buffers
+ * that are allocated once when a history is created, so pushing data does not allocate memory
+ * afterwards. Queries across all deques are answered by merging the deques in push order, so every
+ * data entry is stored only once. The class provides methods to manage the data.
  */
 class HistoryContainer
 {
   public:
+    /**
+     * \brief Decides which of the pushed data entries a history deque retains. The memory of
+     * every history deque is fixed by \c m_historyLength regardless of the policy.
+     */
+    enum RetentionPolicy
+    {
+        LAST_N,    //!< The newest \c m_historyLength entries
+        DECIMATE,  //!< Every k-th pushed entry, the newest \c m_historyLength of them
+        RESERVOIR, //!< A uniform sample of \c m_historyLength entries of all pushed ones
+        HYBRID,    //!< The newest entries plus a separate uniform sample of the older ones
+    };
+
     /**
      * \brief Creates a new \c HistoryContainer object.
      * \param m_historyLimit the number data entries to store in each observation/reward space deque
      * before overwriting the oldest data.
      * \param trackNs3Time boolean to decide whether the ns3 simulation time should be tracked with
      * every data entry.
+     * \param columnar boolean to decide whether box values are additionally stored in contiguous
+     * typed columns, see HistoryColumn.
+     * \param trackWallTime boolean to decide whether the monotonic wall-clock time should be
+     * tracked with every data entry.
      */
-    HistoryContainer(uint historyLimit, bool trackNs3Time = false);
+    HistoryContainer(uint historyLimit,
+                     bool trackNs3Time = false,
+                     bool columnar = false,
+                     bool trackWallTime = false);
     ~HistoryContainer();
 
     /**
@@ -135,7 +698,118 @@ class HistoryContainer
     void Push(Ptr<OpenGymDictContainer> data, uint id);
 
     /**
-     * \brief Aggregate the latest \c n data entries of the specified history deque.
+     * \brief Set which pushed data entries the history deques retain. Has to be called before the
+     * first push. The history deques stay ordered by push time under every policy.
+     *
+     * - \c LAST_N keeps the newest entries.
+     * - \c DECIMATE keeps every \c parameter-th entry, starting with the first one.
+     * - \c RESERVOIR keeps a uniform random sample of all entries pushed so far (Algorithm R).
+     *   Aggregation windows are not used, since the newest entries are not all retained.
+     * - \c HYBRID keeps the newest entries like \c LAST_N and additionally a uniform random
+     *   sample of \c parameter entries of the older ones, see \c GetReservoir().
+     *
+     * Replay buffers and \c AggregateHorizon() still see every pushed entry.
+     * \param policy the retention policy.
+     * \param parameter the decimation factor for \c DECIMATE and the size of the sample for
+     * \c HYBRID, ignored otherwise.
+     */
+    void SetRetentionPolicy(RetentionPolicy policy, uint parameter = 0);
+
+    /**
+     * \return the retention policy of the history deques.
+     */
+    RetentionPolicy GetRetentionPolicy() const;
+
+    /**
+     * \brief Convert the name of a retention policy, as used by the attributes of the
+     * AgentApplication, to the policy. Throw an NS_ABORT_MSG() if the name is unknown.
+     * \param name one of \c LastN, \c Decimate, \c Reservoir and \c Hybrid.
+     * \return the retention policy.
+     */
+    static RetentionPolicy ParseRetentionPolicy(const std::string& name);
+
+    /**
+     * \brief Retrieve the sample of older data entries a history deque keeps under the \c HYBRID
+     * retention policy.
+     * \param id the ID of the history deque.
+     * \return a view of the sampled data entries, starting with the newest one. Empty under the
+     * other policies.
+     */
+    TimestampedDataView GetReservoir(uint id);
+
+    /**
+     * \brief Store the \c float boxes of the history deques XOR-compressed, see CompressedColumn,
+     * and drop the dictionaries of data entries whose values are all stored in columns. Accessing
+     * such an entry restores its dictionary, so the accessors behave as without compression, while
+     * the boxes have to keep the shape of the first box pushed under their key. Has to be called
+     * before the first push and implies columnar storage.
+     * \param keyframeInterval the number of data entries per compressed block. Larger blocks
+     * compress better, but reading one entry decodes its whole block.
+     */
+    void EnableCompression(uint keyframeInterval = 16);
+
+    /**
+     * \brief Lay out the columns of the history deques so that the box values of the newest
+     * \c k data entries are contiguous in memory, see \c GetFrameStack(). The newest entries then
+     * are passed to a frame-stacking model without copying them. Has to be called before the
+     * first push, implies columnar storage and excludes compression.
+     * \param k the number of data entries per stack, at most \c m_historyLength.
+     * \param resetObservation the dictionary whose boxes pad the stacks of histories with fewer
+     * than \c k entries, e.g. the observation of a reset environment, or \c nullptr to pad with
+     * zeros.
+     */
+    void EnableFrameStacking(uint k, Ptr<OpenGymDictContainer> resetObservation = nullptr);
+
+    /**
+     * \brief Drop data entries once they are older than \c ttl of simulation time, in addition to
+     * keeping at most \c m_historyLength entries. This suits producers with irregular arrival
+     * rates, for which a number of entries covers an unknown span of time. Entries are dropped
+     * lazily: a history deque drops its expired entries when data is pushed to it or when it is
+     * queried, so no cleanup event has to be scheduled. Aggregation windows are refilled from the
+     * remaining entries, while the tiers, the statistics of \c AggregateHorizon() and the replay
+     * buffers keep the expired ones. A history deque whose entries all expired stays empty until
+     * the next push to it. Has to be called before the first push and implies tracking the ns3
+     * simulation time.
+     * \param ttl the maximum age of a data entry, or zero to keep entries regardless of their age.
+     */
+    void SetTimeToLive(Time ttl);
+
+    /**
+     * \return the maximum age of a data entry, zero if entries are kept regardless of their age.
+     */
+    Time GetTimeToLive() const;
+
+    /**
+     * \brief Publish an immutable view of the stored data entries of all history deques, which
+     * other threads can read without locks while data is pushed to the container, e.g. to extract
+     * the features of many agents in parallel.
+     *
+     * A snapshot does not copy the dictionaries. It reuses the view of every history deque that
+     * did not change since the previous snapshot, and the entries that are still stored in the
+     * ones that did, so taking it costs O(h) for h history deques plus O(n) for each changed
+     * history deque with n entries. Without any change, the previous snapshot is returned. The
+     * snapshot holds the entries returned by \c GetHistory(), without the sample of older entries
+     * under \c HYBRID retention.
+     *
+     * Has to be called on the thread that pushes to the container, like all other methods except
+     * \c GetPublishedSnapshot(). Snapshots are only freed by this thread as well, when a later
+     * call finds that no reader holds them anymore, since the reference counts of the ns-3
+     * objects they point to are not atomic. Readers therefore must not copy a \c Ptr out of a
+     * snapshot, and must release their snapshots before the container is destroyed.
+     * \return the published snapshot.
+     */
+    std::shared_ptr<const HistorySnapshot> Snapshot();
+
+    /**
+     * \brief Retrieve the snapshot published last by \c Snapshot(). May be called from any thread.
+     * \return the snapshot, or \c nullptr if none was published yet.
+     */
+    std::shared_ptr<const HistorySnapshot> GetPublishedSnapshot() const;
+
+    /**
+     * \brief Aggregate the latest \c n data entries of the specified history deque. If an
+     * aggregation window of length \c n was added with \c AddAggregationWindow(), the result is
+     * read from the window instead of aggregating the entries.
      * \param n the number of data entries to aggregate.
      * \param id the ID of the history deque.
      * \return a map with the keys of the dictionary and the aggregated information for each key.
@@ -143,33 +817,390 @@ class HistoryContainer
     std::map<std::string, AggregatedInfo> AggregateNewest(uint id, uint n = 1);
 
     /**
-     * \brief Aggregate the latest data entry of all history deques.
+     * \brief Aggregate a single dictionary key over the latest \c n data entries of the specified
+     * history deque. The result equals \c AggregateNewest(id, n)[key] for the selected statistics,
+     * but only the values of \c key are read and no map is built. An aggregation window of
+     * length \c n is used if there is one.
+     * \param id the ID of the history deque.
+     * \param key the dictionary key.
+     * \param n the number of data entries to aggregate.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     * The other statistics of the result keep their initial values unless a window is used.
+     * \return the aggregated information of the key, empty if no entry contains the key.
+     */
+    AggregatedInfo Aggregate(uint id,
+                             const std::string& key,
+                             uint n = 1,
+                             int stats = AggregatedInfo::ALL);
+
+    /**
+     * \brief Aggregate a single interned dictionary key over the latest \c n data entries. This is
+     * the fast path of \c Aggregate() for keys interned at setup time.
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param n the number of data entries to aggregate.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     * \return the aggregated information of the key, empty if no entry contains the key.
+     */
+    AggregatedInfo Aggregate(uint id, KeyId key, uint n = 1, int stats = AggregatedInfo::ALL);
+
+    /**
+     * \brief Keep the aggregation of the latest \c n data entries of every history deque up to
+     * date on every push, so that \c AggregateNewest() with this \c n answers in constant time
+     * per dictionary key instead of scanning the entries. Pushing then aggregates every new data
+     * entry once, which requires the dictionaries to contain only OpenGymBoxContainers.
+     * \param n the number of data entries to aggregate.
+     */
+    void AddAggregationWindow(uint n);
+
+    /**
+     * \brief Keep statistics with quantile estimates of all values ever pushed to each history
+     * deque, per dictionary key. Unlike \c AggregateNewest(), these statistics are not limited to
+     * the stored data entries, while the memory per key stays bounded by the QuantileSketch.
+     * \param k the accuracy parameter of the QuantileSketch of each key.
+     */
+    void TrackQuantiles(uint k = 200);
+
+    /**
+     * \brief Retrieve the statistics of all values pushed to a history deque since
+     * \c TrackQuantiles() was called. The average is taken over all values instead of over the
+     * averages of the data entries, and \c AggregatedInfo::GetQuantile() is available.
+     * \param id the ID of the history deque.
+     * \return a map with the keys of the dictionary and the aggregated information for each key.
+     */
+    std::map<std::string, AggregatedInfo> AggregateHorizon(uint id);
+
+    /**
+     * \brief Additionally roll every data entry pushed from now on up into buckets of \c width
+     * simulation time per history deque, keeping the newest \c bucketCount buckets, see
+     * HistoryTier. Several tiers of different widths, e.g. 1 s and 10 s, let agents aggregate
+     * trends over minutes of simulation time with bounded memory instead of storing thousands of
+     * raw data entries.
+     * \param width the simulation time covered by each bucket.
+     * \param bucketCount the number of buckets of the tier.
+     */
+    void AddTier(Time width, uint bucketCount);
+
+    /**
+     * \brief Aggregate the data entries of a history deque pushed within the last \c span of
+     * simulation time, read from the finest tier that covers the span, or the coarsest tier if
+     * none does. The range is rounded to the buckets of that tier, so the entries of the oldest
+     * bucket may be older than \c span. Like \c AggregateHorizon(), the average is taken over all
+     * values.
+     * \param id the ID of the history deque.
+     * \param span the simulation time to look back from \c Simulator::Now().
+     * \return a map with the keys of the dictionary and the aggregated information for each key.
+     */
+    std::map<std::string, AggregatedInfo> AggregateTrend(uint id, Time span);
+
+    /**
+     * \brief Aggregate a single interned dictionary key over the last \c span of simulation time.
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param span the simulation time to look back from \c Simulator::Now().
+     * \return the aggregated information of the key, empty if no entry in the range contains the
+     * key.
+     */
+    AggregatedInfo AggregateTrend(uint id, KeyId key, Time span);
+
+    /**
+     * \brief Retrieve the buckets of a tier of a history deque, e.g. to compute the slope of a
+     * value over the buckets.
+     * \param id the ID of the history deque.
+     * \param tier the index of the tier, 0 being the one with the finest buckets.
+     * \return the buckets holding entries within the span of the tier, oldest first.
+     */
+    std::vector<TierBucket> GetTierBuckets(uint id, uint tier);
+
+    /**
+     * \brief Additionally append every data entry pushed from now on to a memory-mapped
+     * ReplayBuffer file per history deque, named \c history-<id>.replay. This keeps experience
+     * beyond \c m_historyLength on disk with a flat RAM footprint. The dictionaries have to
+     * contain only OpenGymBoxContainers with a fixed layout.
+     * \param directory the existing directory to create the files in.
+     * \param capacity the number of records to retain in each file.
+     */
+    void EnableReplayBuffer(const std::string& directory, uint64_t capacity);
+
+    /**
+     * \brief Retrieve the replay buffer of a history deque for random-access reads.
+     * \param id the ID of the history deque.
+     * \return the replay buffer, or \c nullptr if \c EnableReplayBuffer() was not called.
+     */
+    ReplayBuffer* GetReplayBuffer(uint id);
+
+    /**
+     * \brief Feed the rewards of every data entry pushed from now on into a ReturnsCalculator,
+     * using the ID of the history deque as the ID of the agent. Entries are fed regardless of the
+     * retention policy, so the returns cover all pushed rewards. Entries without a box under
+     * \c rewardKey are skipped.
+     * \param rewardKey the dictionary key of the reward, the first value of the box is used.
+     * \param gamma the discount factor in [0, 1].
+     * \param lambda the GAE parameter in [0, 1].
+     * \param nSteps the number of rewards of an n-step return, at least 1.
+     * \param rolloutLength the maximum number of steps of a rollout, at least 1.
+     * \param valueKey the dictionary key of the value estimate of the state the agent acted in,
+     * or an empty string to use 0.
+     * \param doneKey the dictionary key of a flag that is not 0 if the episode ended with the
+     * entry, or an empty string if episodes are only ended by
+     * \c GetReturnsCalculator()->Finish().
+     */
+    void EnableReturns(const std::string& rewardKey,
+                       double gamma = 0.99,
+                       double lambda = 0.95,
+                       uint nSteps = 1,
+                       uint rolloutLength = 128,
+                       const std::string& valueKey = "",
+                       const std::string& doneKey = "");
+
+    /**
+     * \brief Retrieve the ReturnsCalculator fed by the pushed rewards, e.g. to take the batch of
+     * processed steps with \c TakeBatch().
+     * \return the calculator, or \c nullptr if \c EnableReturns() was not called.
+     */
+    ReturnsCalculator* GetReturnsCalculator();
+
+    /**
+     * \brief Keep a sampling priority for every stored data entry in a SumTree per history deque,
+     * and the total priority of every history deque in another SumTree, so that
+     * \c SamplePrioritized() draws entries with a probability proportional to their priority in
+     * O(log N) time. New entries get the largest priority set so far in their history deque,
+     * initially 1, so that they are likely drawn before their priority is known.
+     */
+    void EnablePrioritizedSampling();
+
+    /**
+     * \brief Set the sampling priority of a data entry, e.g. from the magnitude of its TD error.
+     * The priority is used as is, so an exponent or offset has to be applied beforehand.
+     * \param id the ID of the history deque.
+     * \param offset the position of the data entry, 0 being the newest one.
+     * \param priority the non-negative priority.
+     */
+    void SetPriority(uint id, uint offset, double priority);
+
+    /**
+     * \param id the ID of the history deque.
+     * \param offset the position of the data entry, 0 being the newest one.
+     * \return the sampling priority of the data entry.
+     */
+    double GetPriority(uint id, uint offset);
+
+    /**
+     * \brief Draw a batch of data entries across all history deques with a probability
+     * proportional to their priority. The batch is stratified: the total priority is split into
+     * \c n equal ranges and one entry is drawn from each, which takes O(log N) time per entry.
+     * \param n the number of entries to draw, with replacement.
+     * \return the drawn entries, empty if all priorities are 0.
+     */
+    std::vector<PrioritizedSample> SamplePrioritized(uint n);
+
+    /**
+     * \brief Draw a stratified batch of data entries of one history deque with a probability
+     * proportional to their priority.
+     * \param id the ID of the history deque.
+     * \param n the number of entries to draw, with replacement.
+     * \return the drawn entries, empty if all priorities of the history deque are 0.
+     */
+    std::vector<PrioritizedSample> SamplePrioritized(uint id, uint n);
+
+    /**
+     * \brief Account the data entries of this container against a MemoryBudget shared with other
+     * containers, e.g. all containers of the process. Once the budget is exceeded, data entries of
+     * the attached containers are evicted according to its policy. Evicted entries are removed
+     * like entries overwritten by newer ones: the tiers, the statistics of \c AggregateHorizon()
+     * and the replay buffers keep them, while the aggregation windows are refilled from the
+     * remaining entries. Has to be called before the first push. A container attached to a
+     * budget cannot be copied.
+     * \param budget the budget, by default the one shared by the whole process.
+     */
+    void SetMemoryBudget(Ptr<MemoryBudget> budget = MemoryBudget::GetGlobal());
+
+    /**
+     * \return the memory budget the container is attached to, or \c nullptr if there is none.
+     */
+    Ptr<MemoryBudget> GetMemoryBudget() const;
+
+    /**
+     * \brief Retrieve the estimated bytes of the data entries stored in all history deques, see
+     * GetContainerSize(). Only available with a memory budget.
+     * \return the estimated bytes, 0 without a memory budget.
+     */
+    uint64_t GetStoredBytes();
+
+    /**
+     * \brief Retrieve the latest data entry of all history deques.
      * \return the newest data entry.
      */
     TimestampedData* GetNewestOfCombinedHistory();
 
     /**
-     * \brief Retrieve the latest \c n data entries of all history deques.
+     * \brief Retrieve the latest \c n data entries of all history deques. The entries are found by
+     * a k-way merge of the history deques in push order, which takes O(n log k) time for k history
+     * deques. The entries of compressed history deques are copies with a restored dictionary,
+     * which are valid until the next call.
      * \param n the number of data entries to return.
-     * \return a vector with the newest \c n data entries.
+     * \return a vector with the newest \c n data entries, starting with the newest one.
      */
     std::vector<TimestampedData*> GetNewestOfCombinedHistory(uint n);
 
+    /**
+     * \brief Reduce the values of a dictionary key in the newest data entry of every history
+     * deque, e.g. the mean or the maximum over the latest observations of all remote apps.
+     * Histories whose newest entry does not contain the key as a box are skipped. Values are
+     * read from the columns in columnar mode.
+     * \param key the dictionary key.
+     * \return the statistics of all values, each value counting once.
+     */
+    AggregatedInfo ReduceLatest(const std::string& key);
+
+    /**
+     * \copydoc ReduceLatest(const std::string&)
+     */
+    AggregatedInfo ReduceLatest(KeyId key);
+
+    /**
+     * \brief Stack the values of a dictionary key in the newest data entry of every history deque
+     * into one contiguous buffer and reduce them in the same pass. Histories whose newest entry
+     * does not contain the key as a box with the length of the first row are skipped.
+     * \param key the dictionary key.
+     * \return the stacked rows, converted to \c float, and their statistics.
+     */
+    StackedRows StackLatest(const std::string& key);
+
+    /**
+     * \brief Stack the values of an interned dictionary key, reusing the memory of a previous
+     * result, so that stacking in every step does not allocate memory.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param stack the stacked rows to overwrite.
+     */
+    void StackLatest(KeyId key, StackedRows& stack);
+
     /**
      * \brief Retrieve the latest \c n collected data entries of one history deque.
      * \param n the number of data entries to return.
      * \param id the ID of the history deque.
-     * \return a vector with the newest \c n data entries.
+     * \return a view of the newest \c n data entries, starting with the newest one. The view is
+     * valid until the next push to or deletion of the history deque.
      */
-    std::vector<TimestampedData*> GetNewestByID(uint id, uint n);
+    TimestampedDataView GetNewestByID(uint id, uint n);
 
     /**
-     * \brief Retrieve the latest data entry of a history deque.
+     * \brief Retrieve the latest data entry of a history deque in constant time.
      * \param id the ID of the history deque.
      * \return the newest data entry of the history deque.
      */
     TimestampedData* GetNewestByID(uint id);
 
+    /**
+     * \brief Retrieve the data entries of a history deque that were pushed within a range of
+     * simulation time. Requires tracking the ns3 simulation time. The range is found by binary
+     * search instead of scanning the deque.
+     * \param id the ID of the history deque.
+     * \param from the start of the range.
+     * \param to the end of the range, inclusive.
+     * \return a view of the data entries, starting with the newest one.
+     */
+    TimestampedDataView GetRangeByID(uint id, Time from, Time to);
+
+    /**
+     * \brief Retrieve the data entries of a history deque that were pushed at or after a point in
+     * simulation time, e.g. all observations of the last 500 ms with
+     * \c GetSince(id, Simulator::Now() - MilliSeconds(500)). Requires tracking the ns3 simulation
+     * time.
+     * \param id the ID of the history deque.
+     * \param t the start of the range.
+     * \return a view of the data entries, starting with the newest one.
+     */
+    TimestampedDataView GetSince(uint id, Time t);
+
+    /**
+     * \brief Retrieve the column of a dictionary key of a history deque. Only available in
+     * columnar mode.
+     * \param id the ID of the history deque.
+     * \param key the dictionary key.
+     * \return the column, or \c nullptr if no box was stored under this key in columnar mode.
+     */
+    const HistoryColumn* GetColumn(uint id, const std::string& key);
+
+    /**
+     * \brief Retrieve the column of an interned dictionary key of a history deque without looking
+     * up the key string. Only available in columnar mode.
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \return the column, or \c nullptr if no box was stored under this key in columnar mode.
+     */
+    const HistoryColumn* GetColumn(uint id, KeyId key);
+
+    /**
+     * \brief Retrieve the box values a data entry stored under a dictionary key, read from the
+     * contiguous column instead of the dictionary. Only available in columnar mode.
+     * \param id the ID of the history deque.
+     * \param key the dictionary key.
+     * \param offset the position of the data entry, 0 being the newest one.
+     * \return a pointer to the first of \c GetColumn(id, key)->GetRowLength() values, or
+     * \c nullptr if the values are not stored with element type \c T.
+     */
+    template <typename T>
+    const T* GetNewestValues(uint id, const std::string& key, uint offset = 0)
+    {
+        return GetNewestValues<T>(id, KeyRegistry::Find(key), offset);
+    }
+
+    /**
+     * \brief Retrieve the box values a data entry stored under an interned dictionary key. This is
+     * the fast path of \c GetNewestValues() for keys interned at setup time.
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param offset the position of the data entry, 0 being the newest one.
+     * \return a pointer to the first of \c GetColumn(id, key)->GetRowLength() values, or
+     * \c nullptr if the values are not stored with element type \c T.
+     */
+    template <typename T>
+    const T* GetNewestValues(uint id, KeyId key, uint offset = 0)
+    {
+        auto column = GetColumn(id, key);
+        auto& history = GetHistory(id).data;
+        if (!column || offset >= history.Size())
+        {
+            return nullptr;
+        }
+        return column->GetRow<T>(history.GetNewestSlot(offset));
+    }
+
+    /**
+     * \brief Retrieve the box values of the newest \c k data entries of a history deque under a
+     * dictionary key as one block, e.g. the input of a model stacking the last \c k observations.
+     * Only available in columnar mode.
+     * \param id the ID of the history deque.
+     * \param key the dictionary key.
+     * \param k the number of data entries.
+     * \return a pointer to \c k x \c GetColumn(id, key)->GetRowLength() values, oldest entry
+     * first and padded at the front if fewer than \c k entries are stored, or \c nullptr if the
+     * values are not stored with element type \c T. For \c k up to the depth set with
+     * \c EnableFrameStacking(), the pointer points into the column without copying. It is valid
+     * until the next push to the history deque.
+     */
+    template <typename T>
+    const T* GetFrameStack(uint id, const std::string& key, uint k)
+    {
+        return GetFrameStack<T>(id, KeyRegistry::Find(key), k);
+    }
+
+    /**
+     * \brief Retrieve the newest \c k data entries under an interned dictionary key as one block.
+     * This is the fast path of \c GetFrameStack() for keys interned at setup time.
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param k the number of data entries.
+     * \return a pointer to \c k x \c GetColumn(id, key)->GetRowLength() values, oldest entry
+     * first, or \c nullptr if the values are not stored with element type \c T.
+     */
+    template <typename T>
+    const T* GetFrameStack(uint id, KeyId key, uint k)
+    {
+        return GetHistory(id).data.GetFrameStack<T>(key, k);
+    }
+
     /**
      * \brief Retrieve the size of a certain history deque.
      * \param id the ID of the history deque.
@@ -178,12 +1209,9 @@ class HistoryContainer
     uint GetSize(uint id);
 
     /**
-     * \brief Retrieve the size of the combined history deque. The size can be larger than the sum
-     * of the sizes of the individual history deques, because the combined history deque contains
-     * at most \c m_historyLength * \c m_historyCount data entries. Thus, if some history deques
-     * receive data entries more frequently than others, the combined history deque can contain
-     * more entries of that deque than \c m_historyLength.
-     * \return the size of the combined history deque.
+     * \brief Retrieve the number of data entries stored in all history deques, i.e. the number of
+     * entries \c GetNewestOfCombinedHistory() can return.
+     * \return the sum of the sizes of all history deques.
      */
     uint GetSizeOfHistory();
 
@@ -198,7 +1226,7 @@ class HistoryContainer
      * \param where the stream to print the data entries to
      * \param id the ID of the history deque.
      * \param type the space type of the data entry. Currently only \c ns3_ai_gym::Box is supported
-     * with data of type \c uint, \c float, \c uint32_t or \c double.
+     * with data of one of the element types of BoxDtype.
      */
     void PrintHistory(std::ostream& where, uint id, ns3_ai_gym::SpaceType type = ns3_ai_gym::Box);
 
@@ -219,9 +1247,126 @@ class HistoryContainer
     uint m_historyCount;  //!< Amount of history deques
     uint m_historyLength; //!< Length of each history deque
     bool m_trackNs3Time;  //!< whether the ns3 sim time is tracked for all history deques
+    bool m_trackWallTime; //!< whether the wall-clock time is tracked for all history deques
+    bool m_columnar;      //!< whether box values are stored in columns for all history deques
+    uint m_quantileK;     //!< Accuracy of the quantile sketches, 0 if quantiles are not tracked
+
+    uint m_keyframeInterval;                  //!< Entries per compressed block, 0 if none
+    uint m_frameStackDepth;                   //!< Entries per contiguous frame stack, 0 if none
+    Ptr<OpenGymDictContainer> m_framePadding; //!< Boxes padding the frame stacks
+
+    RetentionPolicy m_retention;         //!< Which pushed data entries the histories retain
+    uint m_retentionParameter;           //!< Decimation factor or sample size of the policy
+    Ptr<UniformRandomVariable> m_random; //!< Random source of the reservoir sampling
+    Time m_timeToLive;                   //!< Maximum age of the stored entries, zero for none
+
+    /**
+     * \brief The data of one history and the state derived from it.
+     */
+    struct History
+    {
+        TimestampedDataDeque data;                    //!< The stored data entries
+        std::vector<SlidingWindowAggregator> windows; //!< Aggregation windows over the entries
+        std::vector<std::optional<AggregatedInfo>> horizon; //!< Statistics indexed by key id
+        std::shared_ptr<ReplayBuffer> replay; //!< Persistent copy of the entries, if any
+        DictKeyCache keys;                    //!< Key ids of the pushed dictionaries
+        uint64_t pushed = 0;                  //!< Number of entries pushed to this history
+        TimestampedDataDeque reservoir;       //!< Sample of older entries under HYBRID retention
+        std::vector<HistoryTier> tiers;       //!< Buckets of all pushed entries, finest first
+        uint sampleIndex = 0;                 //!< Index of the history in m_historyPriorities
+        std::shared_ptr<const SnapshotHistory> snapshot; //!< Entries as of the last snapshot
+        bool snapshotCurrent = false; //!< Whether \c snapshot holds the stored entries
+    };
+
+    /**
+     * Histories of small ids, indexed by id. Remote app ids are assigned densely, so most
+     * lookups take this path in constant time.
+     */
+    std::vector<std::optional<History>> m_denseHistories;
+    std::map<uint, History> m_sparseHistories; //!< Histories of ids too large for dense storage
+    uint64_t m_pushCount;                      //!< Number of data entries pushed so far
+    std::vector<TimestampedData>
+        m_combinedEntries; //!< Restored entries returned by GetNewestOfCombinedHistory()
+    std::vector<uint> m_windowLengths; //!< Lengths of the aggregation windows of each history
+    std::string m_replayDirectory;     //!< Directory of the replay buffers, empty if disabled
+    uint64_t m_replayCapacity;         //!< Number of records of each replay buffer
+    std::optional<ReturnsCalculator> m_returns; //!< Returns of the pushed rewards, if enabled
+    KeyId m_returnsRewardKey;                   //!< Key of the reward fed to \c m_returns
+    KeyId m_returnsValueKey;                    //!< Key of the value estimate, INVALID for 0
+    KeyId m_returnsDoneKey;                     //!< Key of the episode end flag, INVALID if none
 
-    TimestampedDataDeque m_combinedHistory;           //!< History deque containing all recent data
-    std::map<uint, TimestampedDataDeque> m_histories; //!< Different deques for each history deque
+    std::vector<std::pair<Time, uint>> m_tiers; //!< Width and bucket count of each tier
+    bool m_prioritized;                         //!< Whether sampling priorities are kept
+    SumTree m_historyPriorities;                //!< Total priority of each history
+    std::vector<uint> m_sampleIds;              //!< ID of the history at each index of the tree
+    std::vector<uint> m_freeSampleIndices;      //!< Indices of the tree of deleted histories
+
+    /**
+     * \brief Attaches a container to a memory budget. Copying an attached container is not
+     * allowed, since the budget would not know about the data entries of the copy.
+     */
+    struct BudgetLink
+    {
+        Ptr<MemoryBudget> budget; //!< The budget, or \c nullptr if the container is not attached
+
+        BudgetLink() = default;
+        /**
+         * \brief Copy an unattached link. Throw an NS_ASSERT_MSG() if \c other is attached.
+         * \param other the link to copy.
+         */
+        BudgetLink(const BudgetLink& other);
+        /**
+         * \brief Assign an unattached link. Throw an NS_ASSERT_MSG() if a link is attached.
+         * \param other the link to assign.
+         * \return this link.
+         */
+        BudgetLink& operator=(const BudgetLink& other);
+    };
+
+    BudgetLink m_budgetLink; //!< The memory budget the data entries are accounted against
+
+    /**
+     * \brief The snapshots published by a container. A copy of a container starts without
+     * snapshots, since readers may still hold the ones of the original.
+     */
+    struct SnapshotState
+    {
+        std::shared_ptr<const HistorySnapshot> latest; //!< Latest snapshot, accessed atomically
+        std::vector<std::shared_ptr<const HistorySnapshot>>
+            retired;       //!< Replaced snapshots that readers may still hold
+        bool stale = true; //!< Whether data entries changed since the latest snapshot
+
+        SnapshotState() = default;
+        /**
+         * \brief Start without snapshots.
+         * \param other the state to copy, ignored.
+         */
+        SnapshotState(const SnapshotState& other);
+        /**
+         * \brief Drop the snapshots. Throw an NS_ASSERT_MSG() if readers still hold one.
+         * \param other the state to assign, ignored.
+         * \return this state.
+         */
+        SnapshotState& operator=(const SnapshotState& other);
+        /**
+         * \brief Throw an NS_ASSERT_MSG() if readers still hold a snapshot.
+         */
+        ~SnapshotState();
+
+        /**
+         * \brief Free the retired snapshots that no reader holds anymore.
+         */
+        void Reclaim();
+
+        /**
+         * \brief Free all snapshots. Throw an NS_ASSERT_MSG() if readers still hold one.
+         */
+        void Release();
+    };
+
+    SnapshotState m_snapshots; //!< The snapshots published for reader threads
+
+    friend class MemoryBudget;
 
     /**
      * \brief Assert that the history deque with the given ID exists. Throw an NS_ASSERT_MSG() if
@@ -231,12 +1376,277 @@ class HistoryContainer
      */
     bool AssertHistoryExists(uint id);
 
+    static constexpr size_t MIN_DENSE_IDS = 64; //!< Ids below this bound are always stored densely
+
+    /**
+     * \brief Look up a history.
+     * \param id the ID of the history.
+     * \return the history, or \c nullptr if it does not exist.
+     */
+    History* FindHistory(uint id);
+
+    /**
+     * \brief Look up a history that has to exist. Throw an NS_ASSERT_MSG() if it does not.
+     * \param id the ID of the history.
+     * \return the history.
+     */
+    History& GetHistory(uint id);
+
+    /**
+     * \brief Store a new history, densely if the ID is small enough and sparsely otherwise.
+     * \param id the ID of the history, which must not exist yet.
+     * \param history the history to store.
+     * \return the stored history.
+     */
+    History& AddHistory(uint id, History history);
+
+    /**
+     * \brief Call a function for every history, in ascending order of the IDs.
+     * \param function called with the ID and the history.
+     */
+    template <typename F>
+    void ForEachHistory(F function)
+    {
+        // the dense threshold grows with the number of histories, so a sparse id can be smaller
+        // than a dense id added later, and both are merged by id
+        auto sparse = m_sparseHistories.begin();
+        for (uint id = 0; id < m_denseHistories.size(); id++)
+        {
+            for (; sparse != m_sparseHistories.end() && sparse->first < id; sparse++)
+            {
+                function(sparse->first, sparse->second);
+            }
+            if (m_denseHistories[id])
+            {
+                function(id, *m_denseHistories[id]);
+            }
+        }
+        for (; sparse != m_sparseHistories.end(); sparse++)
+        {
+            function(sparse->first, sparse->second);
+        }
+    }
+
+    /**
+     * \brief Call a function with the values of a dictionary key in the newest data entry of each
+     * history deque that contains the key as a box, in ascending order of the IDs.
+     * \param key the id of the dictionary key, or KeyRegistry::INVALID if the key was never
+     * interned, in which case only the dictionaries are read.
+     * \param name the dictionary key.
+     * \param function called with the ID of the history, a pointer to the values and their
+     * number. The pointer is typed with the element type of the box.
+     */
+    template <typename F>
+    void ForEachLatestRow(KeyId key, const std::string& name, F function);
+
+    /**
+     * \brief Aggregate a single dictionary key over the latest \c n data entries, see
+     * \c Aggregate(uint, const std::string&, uint, int).
+     * \param id the ID of the history deque.
+     * \param key the id of the dictionary key, or KeyRegistry::INVALID if it was never interned.
+     * \param name the dictionary key.
+     * \param n the number of data entries to aggregate.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     * \return the aggregated information of the key, empty if no entry contains the key.
+     */
+    AggregatedInfo Aggregate(uint id, KeyId key, const std::string& name, uint n, int stats);
+
+    /**
+     * \brief Reduce the values of a dictionary key in the newest data entry of every history
+     * deque, see \c ReduceLatest(const std::string&).
+     * \param key the id of the dictionary key, or KeyRegistry::INVALID if it was never interned.
+     * \param name the dictionary key.
+     * \return the statistics of all values.
+     */
+    AggregatedInfo ReduceLatest(KeyId key, const std::string& name);
+
+    /**
+     * \brief Stack the values of a dictionary key in the newest data entry of every history
+     * deque, see \c StackLatest(const std::string&).
+     * \param key the id of the dictionary key, or KeyRegistry::INVALID if it was never interned.
+     * \param name the dictionary key.
+     * \param stack the stacked rows, overwritten.
+     */
+    void StackLatest(KeyId key, const std::string& name, StackedRows& stack);
+
     /**
      * \brief Aggregates OpenGymBoxContainers and returns the aggregated information for each box.
-     * \param dict contains data as key-value pairs of strings and OpenGymBoxContainers to aggregate
-     * \return a map with the dictionary keys and the aggregated information for each key
+     * \param entries the resolved values of a dictionary, see DictKeyCache::Resolve().
+     * \return the aggregated information for each key id
+     */
+    KeyedInfo GetInfoFromDict(const std::vector<DictKeyCache::Entry>& entries);
+
+    /**
+     * \brief Add the values of an OpenGymBoxContainer to aggregated information. Throw an
+     * NS_ABORT_MSG() if the container is not a box of a supported element type.
+     * \param data the box to aggregate.
+     * \param info the aggregated information to update.
+     */
+    static void AggregateBox(Ptr<OpenGymDataContainer> data, AggregatedInfo& info);
+
+    /**
+     * \brief Add selected statistics of the values of a box as a single data entry, see
+     * AggregatedInfo::UpdateEntry().
+     * \param data the container holding the box.
+     * \param info the aggregated information to update.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     */
+    static void AggregateBoxEntry(Ptr<OpenGymDataContainer> data, AggregatedInfo& info, int stats);
+
+    /**
+     * \brief Add the values of the newest data entry of a history to its horizon statistics.
+     * \param history the history the entry was pushed to.
+     * \param dict the dictionary of the entry.
+     * \param stored whether the entry was retained, so its values can be read from the columns.
+     */
+    void UpdateHorizon(History& history, Ptr<OpenGymDictContainer> dict, bool stored);
+
+    /**
+     * \brief Store a pushed data entry in its history according to the retention policy.
+     * \param history the history the entry was pushed to.
+     * \param entry the data entry.
+     * \return \c true if the entry was stored as the newest one, \c false if it was dropped.
+     */
+    bool Retain(History& history, const TimestampedData& entry);
+
+    /**
+     * \brief Draw a uniform random number.
+     * \return a number in [0, 1).
+     */
+    double SampleUniform();
+
+    /**
+     * \brief Keep sampling priorities for a history and add it to the priorities of all
+     * histories, reusing the index of a deleted history if there is one.
+     * \param id the ID of the history.
+     * \param history the history.
+     */
+    void AddSampleIndex(uint id, History& history);
+
+    /**
+     * \brief Draw a stratified batch of data entries from the histories of a SumTree.
+     * \param n the number of entries to draw.
+     * \param total the total priority to draw from.
+     * \param find maps a prefix sum of the priorities to the ID of a history and its history,
+     * setting the prefix sum to the remainder within the history.
+     * \return the drawn entries.
+     */
+    template <typename F>
+    std::vector<PrioritizedSample> SampleStratified(uint n, double total, F find);
+
+    /**
+     * \brief Draw a uniform random index.
+     * \param n the number of indices, has to be positive.
+     * \return an index in [0, n).
+     */
+    uint64_t SampleIndex(uint64_t n);
+
+    /**
+     * \brief Create the replay buffer of a history.
+     * \param id the ID of the history.
+     * \param history the history.
+     */
+    void CreateReplayBuffer(uint id, History& history);
+
+    /**
+     * \brief Feed the reward of a pushed data entry into \c m_returns.
+     * \param id the ID of the history.
+     * \param obs the pushed dictionary.
+     */
+    void PushReturn(uint id, Ptr<OpenGymDictContainer> obs);
+
+    /**
+     * \brief Read the first value of the box stored under a key.
+     * \param dict the dictionary, may be \c nullptr.
+     * \param key the id of the dictionary key, may be KeyRegistry::INVALID.
+     * \param value set to the first value of the box, converted to \c float.
+     * \return \c true if the key holds a box, \c false otherwise.
+     */
+    static bool ReadScalar(Ptr<OpenGymDictContainer> dict, KeyId key, float& value);
+
+    /**
+     * \brief Aggregate a single data entry, reading the columns if all of its values are stored
+     * there and the dictionary otherwise.
+     * \param data the deque holding the entry.
+     * \param offset the position of the entry, 0 being the newest one.
+     * \param keys resolves the keys of the dictionary of the entry if it has to be read.
+     * \return the aggregated information for each key id
+     */
+    KeyedInfo AggregateEntry(TimestampedDataDeque& data, uint offset, DictKeyCache& keys);
+
+    /**
+     * \brief Select the tier to aggregate a span of simulation time from.
+     * \param history the history.
+     * \param span the span of simulation time.
+     * \return the finest tier covering the span, or the coarsest tier if none does.
+     */
+    const HistoryTier& SelectTier(const History& history, Time span) const;
+
+    /**
+     * \brief Refill an aggregation window from the entries stored in a history, oldest first.
+     * \param history the history.
+     * \param window the window to refill.
+     */
+    void FillWindow(History& history, SlidingWindowAggregator& window);
+
+    /**
+     * \param history a history.
+     * \return the estimated bytes of the data entries stored in the history.
+     */
+    static uint64_t GetHistoryBytes(const History& history);
+
+    /**
+     * \brief Find the history to evict a data entry from. Only histories holding an entry besides
+     * their newest one are considered.
+     * \param leastRecent whether to find the history pushed to least recently instead of the one
+     * holding the oldest entry.
+     * \param sequence set to the sequence number of the newest or oldest entry of the history.
+     * \param id set to the ID of the history.
+     * \return \c true if a history was found, \c false otherwise.
+     */
+    bool FindEvictable(bool leastRecent, uint64_t& sequence, uint& id);
+
+    /**
+     * \return the ID and the estimated bytes of the data entries besides the newest one of every
+     * history holding such entries.
+     */
+    std::vector<std::pair<uint, uint64_t>> GetEvictableBytes();
+
+    /**
+     * \brief Evict the oldest data entries of a history, the sample of older entries under
+     * \c HYBRID retention first, and report them to the memory budget. The newest entry is kept.
+     * \param id the ID of the history.
+     * \param bytes the estimated bytes to evict at least. At least one entry is evicted.
+     * \return the number of evicted entries.
+     */
+    uint Evict(uint id, uint64_t bytes);
+
+    /**
+     * \brief Drop the data entries of a history that are older than \c m_timeToLive.
+     * \param history the history.
+     */
+    void Expire(History& history);
+
+    /**
+     * \brief Drop the expired data entries of all histories, before a query across all of them.
+     */
+    void ExpireAll();
+
+    /**
+     * \brief Update the state derived from the entries of a history after its oldest entries were
+     * removed.
+     * \param history the history.
+     * \param bytes the estimated bytes of the removed entries, reported to the memory budget.
+     */
+    void OnOldestRemoved(History& history, uint64_t bytes);
+
+    /**
+     * \brief Build the snapshot view of a history deque, reusing the entries of its previous view
+     * that are still stored.
+     * \param history the history.
+     * \return the entries of the history deque, oldest first.
      */
-    std::map<std::string, AggregatedInfo> GetInfoFromDict(Ptr<OpenGymDictContainer> dict);
+    static std::shared_ptr<const SnapshotHistory> PublishHistory(History& history);
 };
 } // namespace ns3
 #endif
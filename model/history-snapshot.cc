@@ -0,0 +1,174 @@
+#include "history-snapshot.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HistorySnapshot");
+
+SnapshotEntry::SnapshotEntry(Ptr<OpenGymDictContainer> data,
+                             const std::vector<DictKeyCache::Entry>& values,
+                             int64_t ns3timestamp,
+                             uint64_t sequence)
+    : m_data(data),
+      m_ns3timestamp(ns3timestamp),
+      m_sequence(sequence)
+{
+    m_values.reserve(values.size());
+    for (const auto& value : values)
+    {
+        Value resolved{value.key, PeekPointer(value.value), 0};
+        VisitBox(value.value, [&resolved](auto* box) {
+            std::vector<uint32_t> shape = box->GetShape();
+            resolved.count = std::accumulate(shape.begin(),
+                                             shape.end(),
+                                             size_t{1},
+                                             std::multiplies<size_t>());
+        });
+        m_values.push_back(resolved);
+    }
+    std::sort(m_values.begin(), m_values.end(), [](const Value& a, const Value& b) {
+        return a.key < b.key;
+    });
+}
+
+int64_t
+SnapshotEntry::GetNs3Timestamp() const
+{
+    return m_ns3timestamp;
+}
+
+uint64_t
+SnapshotEntry::GetSequence() const
+{
+    return m_sequence;
+}
+
+const SnapshotEntry::Value*
+SnapshotEntry::Find(KeyId key) const
+{
+    auto value = std::lower_bound(m_values.begin(),
+                                  m_values.end(),
+                                  key,
+                                  [](const Value& value, KeyId key) { return value.key < key; });
+    return value != m_values.end() && value->key == key ? &*value : nullptr;
+}
+
+OpenGymDataContainer*
+SnapshotEntry::Get(KeyId key) const
+{
+    const Value* value = Find(key);
+    return value ? value->box : nullptr;
+}
+
+HistorySnapshot::HistorySnapshot(
+    uint64_t version,
+    std::vector<std::pair<uint, std::shared_ptr<const SnapshotHistory>>> histories)
+    : m_version(version),
+      m_histories(std::move(histories))
+{
+    std::sort(m_histories.begin(), m_histories.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+}
+
+uint64_t
+HistorySnapshot::GetVersion() const
+{
+    return m_version;
+}
+
+std::vector<uint>
+HistorySnapshot::GetIds() const
+{
+    std::vector<uint> ids;
+    ids.reserve(m_histories.size());
+    for (const auto& history : m_histories)
+    {
+        ids.push_back(history.first);
+    }
+    return ids;
+}
+
+const SnapshotHistory*
+HistorySnapshot::FindHistory(uint id) const
+{
+    auto history =
+        std::lower_bound(m_histories.begin(),
+                         m_histories.end(),
+                         id,
+                         [](const auto& history, uint id) { return history.first < id; });
+    return history != m_histories.end() && history->first == id ? history->second.get() : nullptr;
+}
+
+const SnapshotHistory&
+HistorySnapshot::GetHistory(uint id) const
+{
+    const SnapshotHistory* history = FindHistory(id);
+    NS_ASSERT_MSG(history, "No history with id " << id << " found");
+    return *history;
+}
+
+bool
+HistorySnapshot::HistoryExists(uint id) const
+{
+    return FindHistory(id) != nullptr;
+}
+
+uint
+HistorySnapshot::GetSize(uint id) const
+{
+    return GetHistory(id).size();
+}
+
+const SnapshotEntry&
+HistorySnapshot::GetNewest(uint id, uint offset) const
+{
+    const SnapshotHistory& history = GetHistory(id);
+    NS_ASSERT_MSG(offset < history.size(), "No data entry at offset " << offset);
+    return *history[history.size() - 1 - offset];
+}
+
+AggregatedInfo
+HistorySnapshot::Aggregate(uint id, KeyId key, uint n, int stats) const
+{
+    AggregatedInfo result;
+    const SnapshotHistory& history = GetHistory(id);
+    uint size = std::min<size_t>(n, history.size());
+    for (uint offset = 0; offset < size; offset++)
+    {
+        // every entry counts as one value, like in HistoryContainer::Aggregate()
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0;
+        size_t count = 0;
+        history[history.size() - 1 - offset]->ForEachValue(key, [&](auto value) {
+            min = std::min<double>(min, value);
+            max = std::max<double>(max, value);
+            sum += value;
+            count++;
+        });
+        if (count == 0)
+        {
+            continue;
+        }
+        if (stats & AggregatedInfo::MIN)
+        {
+            result.UpdateMin(min);
+        }
+        if (stats & AggregatedInfo::MAX)
+        {
+            result.UpdateMax(max);
+        }
+        if (stats & AggregatedInfo::AVG)
+        {
+            result.UpdateAverage(sum / count);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,216 @@
+#ifndef HISTORY_SNAPSHOT_H
+#define HISTORY_SNAPSHOT_H
+
+#include "aggregated-info.h"
+#include "box-visitor.h"
+#include "key-registry.h"
+
+#include <ns3/ai-module.h>
+
+#include <cstdint>
+#include <memory>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class SnapshotEntry
+ * \brief An immutable data entry of a HistorySnapshot.
+ *
+ * The boxes of the dictionary are resolved to raw pointers when the entry is published, so that
+ * readers on other threads access them without copying a Ptr, whose reference count is not
+ * atomic. The boxes are shared with the HistoryContainer, which never changes a box after it was
+ * pushed, and their number of values is taken from their shape at the same time, so that
+ * \c ForEachValue() reads the values in place without copying or allocating. The entry keeps its
+ * dictionary alive, and it is only created and destroyed by the thread owning the
+ * HistoryContainer.
+ */
+class SnapshotEntry
+{
+  public:
+    /**
+     * \brief Creates a new SnapshotEntry.
+     * \param data the dictionary of the data entry, may be \c nullptr.
+     * \param values the resolved values of the dictionary, see DictKeyCache::Resolve().
+     * \param ns3timestamp the simulation time of the data entry in ns-3 time steps, -1 if not
+     * tracked.
+     * \param sequence the sequence number of the data entry.
+     */
+    SnapshotEntry(Ptr<OpenGymDictContainer> data,
+                  const std::vector<DictKeyCache::Entry>& values,
+                  int64_t ns3timestamp,
+                  uint64_t sequence);
+
+    /**
+     * \return the simulation time of the data entry in ns-3 time steps, -1 if not tracked.
+     */
+    int64_t GetNs3Timestamp() const;
+
+    /**
+     * \return the sequence number of the data entry, see TimestampedData::sequence.
+     */
+    uint64_t GetSequence() const;
+
+    /**
+     * \param key the id of the dictionary key.
+     * \return the value stored under the key, or \c nullptr if the dictionary has no such key.
+     */
+    OpenGymDataContainer* Get(KeyId key) const;
+
+    /**
+     * \brief Call a function with the box stored under a key, cast to the OpenGymBoxContainer of
+     * its element type, see VisitBox(). The function must only read the box.
+     * \param key the id of the dictionary key.
+     * \param function called with an \c OpenGymBoxContainer<T>* pointing to the box.
+     * \return \c true if the key holds a box of a supported element type, \c false otherwise.
+     */
+    template <typename F>
+    bool Visit(KeyId key, F&& function) const
+    {
+        return VisitBox(Get(key), std::forward<F>(function));
+    }
+
+    /**
+     * \brief Call a function with every value of the box stored under a key, typed with the
+     * element type of the box. The values are read from the shared box without copying.
+     * \param key the id of the dictionary key.
+     * \param function called with each value, in the order of the box.
+     * \return \c true if the key holds a box of a supported element type, \c false otherwise.
+     */
+    template <typename F>
+    bool ForEachValue(KeyId key, F&& function) const
+    {
+        const Value* value = Find(key);
+        if (!value)
+        {
+            return false;
+        }
+        return VisitBox(value->box, [&](auto* box) {
+            for (size_t i = 0; i < value->count; i++)
+            {
+                function(box->GetValue(i));
+            }
+        });
+    }
+
+  private:
+    /**
+     * \brief A value of the dictionary of the entry.
+     */
+    struct Value
+    {
+        KeyId key;                 //!< Id of the dictionary key
+        OpenGymDataContainer* box; //!< The stored container
+        size_t count;              //!< Number of values of the box, 0 if it is not a box
+    };
+
+    Ptr<OpenGymDictContainer> m_data; //!< Keeps the dictionary alive
+    std::vector<Value> m_values;      //!< Values sorted by key id
+    int64_t m_ns3timestamp; //!< Simulation time in ns-3 time steps, -1 if not tracked
+    uint64_t m_sequence;    //!< Sequence number of the data entry
+
+    /**
+     * \param key the id of the dictionary key.
+     * \return the value stored under the key, or \c nullptr if the dictionary has no such key.
+     */
+    const Value* Find(KeyId key) const;
+};
+
+/**
+ * \ingroup defiance
+ * \brief The entries of one history deque in a HistorySnapshot, oldest first.
+ */
+using SnapshotHistory = std::vector<std::shared_ptr<const SnapshotEntry>>;
+
+/**
+ * \ingroup defiance
+ * \class HistorySnapshot
+ * \brief An immutable view of the data entries of all history deques of a HistoryContainer at the
+ * time it was taken, see HistoryContainer::Snapshot().
+ *
+ * A snapshot shares its entries with the snapshots taken before and after it, and the entries
+ * point to the stored dictionaries instead of copying them. All methods are const and may be
+ * called from any thread without locks while the owning thread keeps pushing to the container.
+ * Keys have to be interned before readers start, e.g. at setup time, since the KeyRegistry is not
+ * thread-safe.
+ */
+class HistorySnapshot
+{
+  public:
+    /**
+     * \brief Creates a new HistorySnapshot.
+     * \param version the number of data entries pushed to the container when it was taken.
+     * \param histories the entries of every history deque with the ID of the deque.
+     */
+    HistorySnapshot(uint64_t version,
+                    std::vector<std::pair<uint, std::shared_ptr<const SnapshotHistory>>> histories);
+
+    /**
+     * \return the number of data entries pushed to the container when the snapshot was taken.
+     * Later snapshots of the same container have a larger or equal version.
+     */
+    uint64_t GetVersion() const;
+
+    /**
+     * \return the IDs of all history deques, in ascending order.
+     */
+    std::vector<uint> GetIds() const;
+
+    /**
+     * \param id the ID of the history deque.
+     * \return \c true if the history deque exists in the snapshot, \c false otherwise.
+     */
+    bool HistoryExists(uint id) const;
+
+    /**
+     * \param id the ID of the history deque, which has to exist.
+     * \return the number of data entries of the history deque.
+     */
+    uint GetSize(uint id) const;
+
+    /**
+     * \brief Retrieve a data entry of a history deque.
+     * \param id the ID of the history deque, which has to exist.
+     * \param offset the position of the data entry, 0 being the newest one. Has to be smaller than
+     * \c GetSize(id).
+     * \return the data entry, valid as long as the snapshot.
+     */
+    const SnapshotEntry& GetNewest(uint id, uint offset = 0) const;
+
+    /**
+     * \brief Aggregate a single interned dictionary key over the latest \c n data entries of a
+     * history deque, like HistoryContainer::Aggregate().
+     * \param id the ID of the history deque, which has to exist.
+     * \param key the id of the dictionary key, see KeyRegistry::Intern().
+     * \param n the number of data entries to aggregate.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     * \return the aggregated information of the key, empty if no entry contains the key.
+     */
+    AggregatedInfo Aggregate(uint id, KeyId key, uint n = 1, int stats = AggregatedInfo::ALL) const;
+
+  private:
+    uint64_t m_version; //!< Number of pushed data entries when the snapshot was taken
+    std::vector<std::pair<uint, std::shared_ptr<const SnapshotHistory>>>
+        m_histories; //!< Entries of every history deque, sorted by ID
+
+    /**
+     * \param id the ID of the history deque.
+     * \return the entries of the history deque, or \c nullptr if it does not exist.
+     */
+    const SnapshotHistory* FindHistory(uint id) const;
+
+    /**
+     * \brief Look up a history deque that has to exist. Throw an NS_ASSERT_MSG() if it does not.
+     * \param id the ID of the history deque.
+     * \return the entries of the history deque.
+     */
+    const SnapshotHistory& GetHistory(uint id) const;
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,147 @@
+#include "history-tier.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HistoryTier");
+
+HistoryTier::HistoryTier(Time width, uint bucketCount)
+    : m_width(width.GetTimeStep()),
+      m_buckets(bucketCount)
+{
+    NS_ASSERT_MSG(m_width > 0, "The width of a bucket has to be positive");
+    NS_ASSERT_MSG(bucketCount > 0, "A tier needs at least one bucket");
+}
+
+int64_t
+HistoryTier::GetIndex(Time time) const
+{
+    return std::max<int64_t>(time.GetTimeStep(), 0) / m_width;
+}
+
+void
+HistoryTier::Push(Time time, const KeyedInfo& info)
+{
+    int64_t index = GetIndex(time);
+    Bucket& bucket = m_buckets[index % m_buckets.size()];
+    if (bucket.index != index)
+    {
+        // the bucket held entries older than the span of the ring, keep its memory
+        NS_ASSERT_MSG(bucket.index < index, "Entries have to be pushed in the order of their time");
+        for (auto& keyInfo : bucket.info)
+        {
+            keyInfo.reset();
+        }
+        bucket.index = index;
+    }
+    for (const auto& [key, entryInfo] : info)
+    {
+        if (key >= bucket.info.size())
+        {
+            bucket.info.resize(key + 1);
+        }
+        auto& keyInfo = bucket.info[key];
+        if (!keyInfo)
+        {
+            keyInfo.emplace();
+        }
+        keyInfo->Merge(entryInfo);
+    }
+}
+
+template <typename F>
+void
+HistoryTier::ForEachBucket(int64_t first, int64_t last, F&& f) const
+{
+    // only the last m_buckets.size() indices can still be in the ring
+    first = std::max<int64_t>(first, last - static_cast<int64_t>(m_buckets.size()) + 1);
+    for (int64_t index = std::max<int64_t>(first, 0); index <= last; index++)
+    {
+        const Bucket& bucket = m_buckets[index % m_buckets.size()];
+        if (bucket.index == index)
+        {
+            f(bucket);
+        }
+    }
+}
+
+std::optional<AggregatedInfo>
+HistoryTier::GetInfo(KeyId key, Time from, Time to) const
+{
+    std::optional<AggregatedInfo> result;
+    ForEachBucket(GetIndex(from), GetIndex(to), [&](const Bucket& bucket) {
+        if (key < bucket.info.size() && bucket.info[key])
+        {
+            if (!result)
+            {
+                result.emplace();
+            }
+            result->Merge(*bucket.info[key]);
+        }
+    });
+    return result;
+}
+
+std::map<std::string, AggregatedInfo>
+HistoryTier::GetInfo(Time from, Time to) const
+{
+    std::map<std::string, AggregatedInfo> result;
+    ForEachBucket(GetIndex(from), GetIndex(to), [&](const Bucket& bucket) {
+        for (KeyId key = 0; key < bucket.info.size(); key++)
+        {
+            if (bucket.info[key])
+            {
+                result[KeyRegistry::GetKey(key)].Merge(*bucket.info[key]);
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<TierBucket>
+HistoryTier::GetBuckets(Time now) const
+{
+    std::vector<TierBucket> buckets;
+    int64_t last = GetIndex(now);
+    int64_t first = last - static_cast<int64_t>(m_buckets.size()) + 1;
+    ForEachBucket(first, last, [&](const Bucket& bucket) {
+        TierBucket result{TimeStep(bucket.index * m_width), {}};
+        for (KeyId key = 0; key < bucket.info.size(); key++)
+        {
+            if (bucket.info[key])
+            {
+                result.info.emplace(KeyRegistry::GetKey(key), *bucket.info[key]);
+            }
+        }
+        if (!result.info.empty())
+        {
+            buckets.push_back(std::move(result));
+        }
+    });
+    return buckets;
+}
+
+Time
+HistoryTier::GetWidth() const
+{
+    return TimeStep(m_width);
+}
+
+Time
+HistoryTier::GetSpan() const
+{
+    return TimeStep(m_width * static_cast<int64_t>(m_buckets.size()));
+}
+
+void
+HistoryTier::Clear()
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.index = -1;
+        bucket.info.clear();
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef HISTORY_TIER_H
+#define HISTORY_TIER_H
+
+#include "aggregated-info.h"
+#include "key-registry.h"
+#include "sliding-window-aggregator.h"
+
+#include <ns3/nstime.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \brief The aggregated information of all data entries pushed within one bucket of simulation
+ * time, see HistoryTier::GetBuckets().
+ */
+struct TierBucket
+{
+    Time start;                                 //!< ns-3 time the bucket starts at
+    std::map<std::string, AggregatedInfo> info; //!< Aggregated information per dictionary key
+};
+
+/**
+ * \ingroup defiance
+ * \class HistoryTier
+ * \brief Rolls the data entries of one history up into buckets of a fixed width of simulation
+ * time, e.g. 1 s or 10 s.
+ *
+ * The tier keeps the newest \c bucketCount buckets in a ring, each holding one AggregatedInfo per
+ * dictionary key, so its memory is bounded by the number of buckets and keys no matter how many
+ * entries are pushed. A bucket is reused once the simulation time has advanced past the span of
+ * the ring. Pushing an entry takes O(1) time per key, and aggregating a range of simulation time
+ * merges at most \c bucketCount buckets per key. Like \c AggregatedInfo::Merge(), the average is
+ * taken over all values instead of over the averages of the entries.
+ */
+class HistoryTier
+{
+  public:
+    /**
+     * \brief Creates a new HistoryTier.
+     * \param width the simulation time covered by each bucket.
+     * \param bucketCount the number of buckets to keep.
+     */
+    HistoryTier(Time width, uint bucketCount);
+
+    /**
+     * \brief Add a data entry to the bucket containing its simulation time. Entries have to be
+     * pushed in the order of their simulation time.
+     * \param time the simulation time of the entry.
+     * \param info the aggregated information of the entry for each of its dictionary keys.
+     */
+    void Push(Time time, const KeyedInfo& info);
+
+    /**
+     * \brief Aggregate a dictionary key over all buckets overlapping a range of simulation time.
+     * \param key the id of the dictionary key.
+     * \param from the first simulation time of the range.
+     * \param to the last simulation time of the range.
+     * \return the aggregated information, or \c std::nullopt if no entry in the range contains the
+     * key.
+     */
+    std::optional<AggregatedInfo> GetInfo(KeyId key, Time from, Time to) const;
+
+    /**
+     * \brief Aggregate all dictionary keys over all buckets overlapping a range of simulation time.
+     * \param from the first simulation time of the range.
+     * \param to the last simulation time of the range.
+     * \return a map with the keys of the dictionary and the aggregated information for each key.
+     */
+    std::map<std::string, AggregatedInfo> GetInfo(Time from, Time to) const;
+
+    /**
+     * \brief Get the buckets of the tier that hold entries and are still within the span of the
+     * ring at a point in simulation time.
+     * \param now the current simulation time.
+     * \return the buckets, oldest first.
+     */
+    std::vector<TierBucket> GetBuckets(Time now) const;
+
+    /**
+     * \return the simulation time covered by each bucket.
+     */
+    Time GetWidth() const;
+
+    /**
+     * \return the simulation time covered by all buckets, i.e. the width times the bucket count.
+     */
+    Time GetSpan() const;
+
+    /**
+     * \brief Remove all data entries from the tier.
+     */
+    void Clear();
+
+  private:
+    /**
+     * \brief The aggregated information of one bucket.
+     */
+    struct Bucket
+    {
+        int64_t index = -1;                              //!< Index of the bucket in time, or -1
+        std::vector<std::optional<AggregatedInfo>> info; //!< Information indexed by key id
+    };
+
+    int64_t m_width;               //!< Width of each bucket in time steps
+    std::vector<Bucket> m_buckets; //!< Ring of buckets, addressed by index modulo its size
+
+    /**
+     * \brief Call a function for every bucket within a range of bucket indices.
+     * \param first the index of the first bucket.
+     * \param last the index of the last bucket.
+     * \param f the function to call with each bucket, oldest first.
+     */
+    template <typename F>
+    void ForEachBucket(int64_t first, int64_t last, F&& f) const;
+
+    /**
+     * \param time a simulation time.
+     * \return the index of the bucket containing the time.
+     */
+    int64_t GetIndex(Time time) const;
+};
+
+} // namespace ns3
+
+#endif
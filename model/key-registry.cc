@@ -0,0 +1,186 @@
+#include "key-registry.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("KeyRegistry");
+
+NS_OBJECT_ENSURE_REGISTERED(InternedDictContainer);
+
+KeyRegistry::Registry&
+KeyRegistry::Get()
+{
+    static Registry registry;
+    return registry;
+}
+
+KeyId
+KeyRegistry::Intern(const std::string& key)
+{
+    Registry& registry = Get();
+    auto [id, inserted] = registry.ids.emplace(key, registry.keys.size());
+    if (inserted)
+    {
+        NS_LOG_DEBUG("Interned key " << key << " as " << id->second);
+        registry.keys.push_back(key);
+    }
+    return id->second;
+}
+
+KeyId
+KeyRegistry::Find(const std::string& key)
+{
+    const Registry& registry = Get();
+    auto id = registry.ids.find(key);
+    return id == registry.ids.end() ? INVALID : id->second;
+}
+
+const std::string&
+KeyRegistry::GetKey(KeyId id)
+{
+    const Registry& registry = Get();
+    NS_ASSERT_MSG(id < registry.keys.size(), "No key with id " << id << " was interned");
+    return registry.keys[id];
+}
+
+uint32_t
+KeyRegistry::GetSize()
+{
+    return Get().keys.size();
+}
+
+const std::vector<DictKeyCache::Entry>&
+DictKeyCache::Resolve(Ptr<OpenGymDictContainer> dict)
+{
+    // the same dictionary is often resolved several times in a row, e.g. to store and to size it
+    if (dict && dict == m_dict)
+    {
+        return m_entries;
+    }
+    m_dict = dict;
+    for (const auto& entry : m_entries)
+    {
+        m_values[entry.key] = nullptr;
+    }
+    m_entries.clear();
+    if (!dict)
+    {
+        return m_entries;
+    }
+
+    if (auto interned = dynamic_cast<const InternedDictContainer*>(PeekPointer(dict)))
+    {
+        // the producer interned the keys while building the dictionary
+        for (const auto& entry : interned->GetEntries())
+        {
+            if (entry.key >= m_values.size())
+            {
+                m_values.resize(KeyRegistry::GetSize());
+            }
+            m_entries.push_back(entry);
+            m_values[entry.key] = entry.value;
+        }
+        return m_entries;
+    }
+
+    // comparing the keys with the previous layout is cheaper than hashing them
+    std::vector<std::string> keys = dict->GetKeys();
+    if (keys != m_keys)
+    {
+        m_ids.clear();
+        for (const auto& key : keys)
+        {
+            m_ids.push_back(KeyRegistry::Intern(key));
+        }
+        m_keys = std::move(keys);
+        m_values.resize(KeyRegistry::GetSize());
+    }
+
+    for (uint32_t i = 0; i < m_keys.size(); i++)
+    {
+        Ptr<OpenGymDataContainer> value = dict->Get(m_keys[i]);
+        m_entries.push_back({m_ids[i], value});
+        m_values[m_ids[i]] = value;
+    }
+    return m_entries;
+}
+
+const std::vector<DictKeyCache::Entry>&
+DictKeyCache::GetEntries() const
+{
+    return m_entries;
+}
+
+Ptr<OpenGymDataContainer>
+DictKeyCache::Get(KeyId key) const
+{
+    return key < m_values.size() ? m_values[key] : nullptr;
+}
+
+TypeId
+InternedDictContainer::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::InternedDictContainer")
+                            .SetParent<OpenGymDictContainer>()
+                            .SetGroupName("defiance")
+                            .AddConstructor<InternedDictContainer>();
+    return tid;
+}
+
+bool
+InternedDictContainer::Add(KeyId key, Ptr<OpenGymDataContainer> value)
+{
+    auto entry = std::find_if(m_entries.begin(), m_entries.end(), [key](const auto& entry) {
+        return entry.key == key;
+    });
+    if (entry != m_entries.end())
+    {
+        // like the map of the base class, which keeps the value added first
+        return false;
+    }
+    m_entries.push_back({key, value});
+    return OpenGymDictContainer::Add(KeyRegistry::GetKey(key), value);
+}
+
+bool
+InternedDictContainer::Add(const std::string& key, Ptr<OpenGymDataContainer> value)
+{
+    return Add(KeyRegistry::Intern(key), value);
+}
+
+Ptr<OpenGymDataContainer>
+InternedDictContainer::Get(KeyId key) const
+{
+    // dictionaries of messages hold few keys, so a scan beats any lookup structure
+    for (const auto& entry : m_entries)
+    {
+        if (entry.key == key)
+        {
+            return entry.value;
+        }
+    }
+    return nullptr;
+}
+
+const std::vector<DictKeyCache::Entry>&
+InternedDictContainer::GetEntries() const
+{
+    return m_entries;
+}
+
+Ptr<OpenGymDataContainer>
+ns3::GetDictValue(Ptr<OpenGymDictContainer> dict, KeyId key)
+{
+    if (!dict || key == KeyRegistry::INVALID)
+    {
+        return nullptr;
+    }
+    if (auto interned = dynamic_cast<const InternedDictContainer*>(PeekPointer(dict)))
+    {
+        return interned->Get(key);
+    }
+    return dict->Get(KeyRegistry::GetKey(key));
+}
@@ -0,0 +1,198 @@
+#ifndef KEY_REGISTRY_H
+#define KEY_REGISTRY_H
+
+#include <ns3/ai-module.h>
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Interned id of a dictionary key.
+ */
+using KeyId = uint32_t;
+
+/**
+ * \ingroup defiance
+ * \class KeyRegistry
+ * \brief Process-wide mapping of the keys of OpenGymDictContainers to small integer ids.
+ *
+ * Keys are interned once, e.g. at setup time, and the ids are then used to index per-key state in
+ * vectors instead of looking it up by string on every message. Ids are assigned densely in the
+ * order in which the keys are interned and stay valid until the end of the process.
+ */
+class KeyRegistry
+{
+  public:
+    static constexpr KeyId INVALID = std::numeric_limits<KeyId>::max(); //!< Id of unknown keys
+
+    /**
+     * \brief Get the id of a key, assigning a new one if the key was not interned yet.
+     * \param key the dictionary key.
+     * \return the id of the key.
+     */
+    static KeyId Intern(const std::string& key);
+
+    /**
+     * \brief Get the id of a key without interning it.
+     * \param key the dictionary key.
+     * \return the id of the key, or \c INVALID if it was never interned.
+     */
+    static KeyId Find(const std::string& key);
+
+    /**
+     * \param id the id of an interned key.
+     * \return the key.
+     */
+    static const std::string& GetKey(KeyId id);
+
+    /**
+     * \return the number of interned keys, which is larger than all ids.
+     */
+    static uint32_t GetSize();
+
+  private:
+    /**
+     * \brief The interned keys.
+     */
+    struct Registry
+    {
+        std::unordered_map<std::string, KeyId> ids; //!< Id of each key
+        std::deque<std::string> keys; //!< Key of each id, a deque so references stay valid
+    };
+
+    /**
+     * \return the registry shared by all users.
+     */
+    static Registry& Get();
+};
+
+/**
+ * \ingroup defiance
+ * \class DictKeyCache
+ * \brief Resolves the keys of a stream of dictionaries to interned ids.
+ *
+ * An InternedDictContainer already carries the ids of its keys, which were interned by its
+ * producer, so it is resolved without touching a key string. The keys of other dictionaries, e.g.
+ * ones received over a socket, are compared with the ones of the previously resolved dictionary,
+ * and only interned again if they differ, so no string is hashed as long as the layout stays the
+ * same. Since such a dictionary only lists its keys by copying them, producers should build
+ * InternedDictContainers where they can. Resolving the same dictionary again, e.g. to store it in
+ * columns and to estimate its size, returns the previous result without reading the dictionary,
+ * so a dictionary must not change once it was resolved, like the data entries of a
+ * HistoryContainer. The last resolved dictionary is kept alive for this. After resolving a
+ * dictionary, its values can be accessed by id in constant time.
+ */
+class DictKeyCache
+{
+  public:
+    /**
+     * \brief A value of the resolved dictionary.
+     */
+    struct Entry
+    {
+        KeyId key;                       //!< Id of the dictionary key
+        Ptr<OpenGymDataContainer> value; //!< Value stored under the key
+    };
+
+    /**
+     * \brief Resolve the keys of a dictionary.
+     * \param dict the dictionary, which may be \c nullptr.
+     * \return the values of the dictionary with their key ids, in the order in which they were
+     * added to an InternedDictContainer, ordered like \c dict->GetKeys() otherwise.
+     */
+    const std::vector<Entry>& Resolve(Ptr<OpenGymDictContainer> dict);
+
+    /**
+     * \return the values of the last resolved dictionary.
+     */
+    const std::vector<Entry>& GetEntries() const;
+
+    /**
+     * \brief Access a value of the last resolved dictionary.
+     * \param key the id of the key.
+     * \return the value, or \c nullptr if the dictionary has no such key.
+     */
+    Ptr<OpenGymDataContainer> Get(KeyId key) const;
+
+  private:
+    Ptr<OpenGymDictContainer> m_dict;                //!< Last resolved dictionary
+    std::vector<std::string> m_keys;                 //!< Keys of the last resolved layout
+    std::vector<KeyId> m_ids;                        //!< Ids of \c m_keys
+    std::vector<Entry> m_entries;                    //!< Values of the last resolved dictionary
+    std::vector<Ptr<OpenGymDataContainer>> m_values; //!< Values of \c m_entries indexed by id
+};
+
+/**
+ * \ingroup defiance
+ * \class InternedDictContainer
+ * \brief An OpenGymDictContainer that records the interned ids of its keys while values are added.
+ *
+ * Consumers resolve it by id, see DictKeyCache, without enumerating or comparing its key strings.
+ * Producers that intern their keys at setup time and add values by id hash no string per message.
+ * It is serialized like any other OpenGymDictContainer. Values have to be added through this class,
+ * since values added through a pointer to the base class are not recorded.
+ */
+class InternedDictContainer : public OpenGymDictContainer
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \brief Add a value under an interned key. Like OpenGymDictContainer::Add(), a key that is
+     * already present keeps its previous value.
+     * \param key the id of the key, see KeyRegistry::Intern().
+     * \param value the value.
+     * \return \c true if the value was added, \c false if the key is already present.
+     */
+    bool Add(KeyId key, Ptr<OpenGymDataContainer> value);
+
+    /**
+     * \brief Add a value under a key, interning the key, see
+     * \c Add(KeyId, Ptr<OpenGymDataContainer>).
+     * \param key the key.
+     * \param value the value.
+     * \return \c true if the value was added, \c false if the key is already present.
+     */
+    bool Add(const std::string& key, Ptr<OpenGymDataContainer> value);
+
+    using OpenGymDictContainer::Get;
+
+    /**
+     * \param key the id of the key.
+     * \return the value stored under the key, or \c nullptr if the dictionary has no such key.
+     */
+    Ptr<OpenGymDataContainer> Get(KeyId key) const;
+
+    /**
+     * \return the values with the ids of their keys, in the order in which they were added.
+     */
+    const std::vector<DictKeyCache::Entry>& GetEntries() const;
+
+  private:
+    std::vector<DictKeyCache::Entry> m_entries; //!< Values with the ids of their keys
+};
+
+/**
+ * \ingroup defiance
+ * \brief Retrieve a value of a dictionary by the interned id of its key. The key string is only
+ * looked up if the dictionary is not an InternedDictContainer.
+ * \param dict the dictionary.
+ * \param key the id of the key.
+ * \return the value stored under the key, or \c nullptr if the dictionary has no such key.
+ */
+Ptr<OpenGymDataContainer> GetDictValue(Ptr<OpenGymDictContainer> dict, KeyId key);
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,270 @@
+#include "memory-budget.h"
+
+#include "history-container.h"
+
+#include <ns3/log.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MemoryBudget");
+
+NS_OBJECT_ENSURE_REGISTERED(MemoryBudget);
+
+TypeId
+MemoryBudget::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::MemoryBudget")
+            .SetParent<Object>()
+            .SetGroupName("defiance")
+            .AddConstructor<MemoryBudget>()
+            .AddAttribute("Limit",
+                          "Maximum number of bytes of the data entries stored by all attached "
+                          "HistoryContainers, or 0 for no limit.",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&MemoryBudget::SetLimit, &MemoryBudget::GetLimit),
+                          MakeUintegerChecker<uint64_t>())
+            .AddAttribute("EvictionPolicy",
+                          "Which data entries are evicted once the limit is exceeded: "
+                          "LruHistory, Oldest or Proportional.",
+                          StringValue("Oldest"),
+                          MakeStringAccessor(&MemoryBudget::SetEvictionPolicyName,
+                                             &MemoryBudget::GetEvictionPolicyName),
+                          MakeStringChecker())
+            .AddTraceSource("Usage",
+                            "Estimated number of bytes of the data entries stored by all attached "
+                            "HistoryContainers.",
+                            MakeTraceSourceAccessor(&MemoryBudget::m_usage),
+                            "ns3::TracedValueCallback::Uint64");
+    return tid;
+}
+
+MemoryBudget::MemoryBudget()
+    : m_limit(0),
+      m_policy(OLDEST),
+      m_usage(0),
+      m_evicted(0),
+      m_clock(0),
+      m_enforcing(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+Ptr<MemoryBudget>
+MemoryBudget::GetGlobal()
+{
+    static Ptr<MemoryBudget> global = CreateObject<MemoryBudget>();
+    return global;
+}
+
+MemoryBudget::EvictionPolicy
+MemoryBudget::ParseEvictionPolicy(const std::string& name)
+{
+    if (name == "LruHistory")
+    {
+        return LRU_HISTORY;
+    }
+    if (name == "Oldest")
+    {
+        return OLDEST;
+    }
+    NS_ABORT_MSG_IF(name != "Proportional",
+                    "Unknown eviction policy " << name
+                                               << ", expected LruHistory, Oldest or Proportional");
+    return PROPORTIONAL;
+}
+
+void
+MemoryBudget::SetLimit(uint64_t bytes)
+{
+    m_limit = bytes;
+    Enforce();
+}
+
+uint64_t
+MemoryBudget::GetLimit() const
+{
+    return m_limit;
+}
+
+void
+MemoryBudget::SetEvictionPolicy(EvictionPolicy policy)
+{
+    m_policy = policy;
+}
+
+MemoryBudget::EvictionPolicy
+MemoryBudget::GetEvictionPolicy() const
+{
+    return m_policy;
+}
+
+void
+MemoryBudget::SetEvictionPolicyName(std::string name)
+{
+    m_policy = ParseEvictionPolicy(name);
+}
+
+std::string
+MemoryBudget::GetEvictionPolicyName() const
+{
+    switch (m_policy)
+    {
+    case LRU_HISTORY:
+        return "LruHistory";
+    case OLDEST:
+        return "Oldest";
+    case PROPORTIONAL:
+        return "Proportional";
+    }
+    return "Oldest";
+}
+
+uint64_t
+MemoryBudget::GetUsage() const
+{
+    return m_usage;
+}
+
+uint64_t
+MemoryBudget::GetEvictedCount() const
+{
+    return m_evicted;
+}
+
+void
+MemoryBudget::Register(HistoryContainer* container)
+{
+    m_members.push_back(container);
+}
+
+void
+MemoryBudget::Unregister(HistoryContainer* container, uint64_t bytes)
+{
+    m_members.erase(std::remove(m_members.begin(), m_members.end(), container), m_members.end());
+    m_usage = m_usage - std::min<uint64_t>(bytes, m_usage);
+}
+
+uint64_t
+MemoryBudget::NextSequence()
+{
+    return m_clock++;
+}
+
+void
+MemoryBudget::Update(uint64_t added, uint64_t removed)
+{
+    if (added == removed)
+    {
+        return;
+    }
+    m_usage = m_usage + added - removed;
+    Enforce();
+}
+
+void
+MemoryBudget::Enforce()
+{
+    // evicting reports the removed entries, which must not start another eviction
+    if (m_enforcing)
+    {
+        return;
+    }
+    m_enforcing = true;
+    while (m_limit > 0 && m_usage > m_limit)
+    {
+        uint evicted = 0;
+        if (m_policy == PROPORTIONAL)
+        {
+            // every history gives up the share of the excess that its evictable entries hold
+            std::vector<std::pair<HistoryContainer*, std::pair<uint, uint64_t>>> candidates;
+            uint64_t total = 0;
+            for (auto container : m_members)
+            {
+                for (const auto& history : container->GetEvictableBytes())
+                {
+                    candidates.emplace_back(container, history);
+                    total += history.second;
+                }
+            }
+            uint64_t excess = m_usage - m_limit;
+            // the shares are rounded down and the bytes lost by rounding go to the histories with
+            // the largest fractions, so that they add up to the excess
+            std::vector<uint64_t> shares;
+            std::vector<double> fractions;
+            uint64_t assigned = 0;
+            for (const auto& candidate : candidates)
+            {
+                double exact = total > 0 ? static_cast<double>(excess) *
+                                               candidate.second.second / total
+                                         : 0;
+                shares.push_back(static_cast<uint64_t>(exact));
+                fractions.push_back(exact - shares.back());
+                assigned += shares.back();
+            }
+            std::vector<size_t> order(candidates.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&fractions](size_t a, size_t b) {
+                return fractions[a] > fractions[b];
+            });
+            for (size_t i = 0; i < order.size() && assigned < excess && total > 0; i++)
+            {
+                shares[order[i]]++;
+                assigned++;
+            }
+            for (size_t i = 0; i < candidates.size(); i++)
+            {
+                // evicting removes at least one entry, so histories without a share are skipped
+                if (shares[i] > 0)
+                {
+                    evicted += candidates[i].first->Evict(candidates[i].second.first, shares[i]);
+                }
+            }
+        }
+        else
+        {
+            bool leastRecent = m_policy == LRU_HISTORY;
+            HistoryContainer* victim = nullptr;
+            uint64_t oldest = 0;
+            uint victimId = 0;
+            for (auto container : m_members)
+            {
+                uint64_t sequence;
+                uint id;
+                if (container->FindEvictable(leastRecent, sequence, id) &&
+                    (!victim || sequence < oldest))
+                {
+                    victim = container;
+                    oldest = sequence;
+                    victimId = id;
+                }
+            }
+            if (victim)
+            {
+                // the history pushed to least recently gives up all entries that are needed
+                evicted = victim->Evict(victimId, leastRecent ? m_usage - m_limit : 1);
+            }
+        }
+        if (evicted == 0)
+        {
+            NS_LOG_WARN("Memory budget of " << m_limit << " bytes exceeded by the newest data "
+                                            << "entries, which are not evicted");
+            break;
+        }
+    }
+    m_enforcing = false;
+}
+
+} // namespace ns3
@@ -0,0 +1,160 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <ns3/object.h>
+#include <ns3/traced-value.h>
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+class HistoryContainer;
+
+/**
+ * \ingroup defiance
+ * \class MemoryBudget
+ * \brief A limit on the bytes of data entries stored by a group of HistoryContainers, usually all
+ * containers of a simulation process, see \c GetGlobal().
+ *
+ * Attached containers report the estimated size of every data entry they store or remove, see
+ * \c GetContainerSize(). Once the total exceeds the limit, entries are evicted across all attached
+ * containers according to the eviction policy until the total is within the limit again. The
+ * newest entry of every history deque is never evicted, so the total may stay above a limit that
+ * is smaller than these entries. Evicting takes O(h) time per evicted entry, or per history for
+ * \c PROPORTIONAL, for h history deques in all attached containers. \c PROPORTIONAL rounds the
+ * shares of the excess down and gives the remaining bytes to the largest fractions, so a small
+ * excess is only taken from the history deques holding the most bytes.
+ */
+class MemoryBudget : public Object
+{
+  public:
+    /**
+     * \brief Decides which data entries are evicted once the limit is exceeded.
+     */
+    enum EvictionPolicy
+    {
+        LRU_HISTORY,  //!< The older entries of the history deque pushed to least recently
+        OLDEST,       //!< The entry pushed first, across all history deques
+        PROPORTIONAL, //!< The oldest entries of every history deque, in proportion to its size
+    };
+
+    MemoryBudget();
+    ~MemoryBudget() override;
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \brief Retrieve the budget shared by all HistoryContainers of the process that are attached
+     * with \c HistoryContainer::SetMemoryBudget() without an explicit budget. It is created with
+     * the default attribute values on the first call.
+     * \return the global budget.
+     */
+    static Ptr<MemoryBudget> GetGlobal();
+
+    /**
+     * \brief Convert the name of an eviction policy to the policy. Throw an NS_ABORT_MSG() if the
+     * name is unknown.
+     * \param name one of \c LruHistory, \c Oldest and \c Proportional.
+     * \return the eviction policy.
+     */
+    static EvictionPolicy ParseEvictionPolicy(const std::string& name);
+
+    /**
+     * \brief Set the limit and evict data entries if the current usage exceeds it.
+     * \param bytes the maximum number of bytes, 0 for no limit.
+     */
+    void SetLimit(uint64_t bytes);
+
+    /**
+     * \return the maximum number of bytes, 0 for no limit.
+     */
+    uint64_t GetLimit() const;
+
+    /**
+     * \param policy the policy deciding which data entries are evicted.
+     */
+    void SetEvictionPolicy(EvictionPolicy policy);
+
+    /**
+     * \return the policy deciding which data entries are evicted.
+     */
+    EvictionPolicy GetEvictionPolicy() const;
+
+    /**
+     * \return the estimated number of bytes of all data entries stored by the attached
+     * containers.
+     */
+    uint64_t GetUsage() const;
+
+    /**
+     * \return the number of data entries evicted so far.
+     */
+    uint64_t GetEvictedCount() const;
+
+  private:
+    friend class HistoryContainer;
+
+    uint64_t m_limit;                         //!< Maximum number of bytes, 0 for no limit
+    EvictionPolicy m_policy;                  //!< Policy deciding which data entries are evicted
+    TracedValue<uint64_t> m_usage;            //!< Bytes of the stored data entries
+    uint64_t m_evicted;                       //!< Number of data entries evicted so far
+    uint64_t m_clock;                         //!< Sequence number of the next pushed data entry
+    bool m_enforcing;                         //!< Whether entries are being evicted right now
+    std::vector<HistoryContainer*> m_members; //!< Attached containers
+
+    /**
+     * \brief Attach a container, which has to report the bytes of its data entries from now on.
+     * \param container the container.
+     */
+    void Register(HistoryContainer* container);
+
+    /**
+     * \brief Detach a container.
+     * \param container the container.
+     * \param bytes the bytes of the data entries the container still stores.
+     */
+    void Unregister(HistoryContainer* container, uint64_t bytes);
+
+    /**
+     * \brief Number the data entries pushed to the attached containers in one common order, so
+     * that the oldest entry across all containers can be found.
+     * \return the sequence number of the next pushed data entry.
+     */
+    uint64_t NextSequence();
+
+    /**
+     * \brief Update the usage after data entries were stored or removed, and evict entries if the
+     * usage exceeds the limit.
+     * \param added the bytes of the stored data entries.
+     * \param removed the bytes of the removed data entries.
+     */
+    void Update(uint64_t added, uint64_t removed);
+
+    /**
+     * \brief Evict data entries until the usage is within the limit or no entry can be evicted.
+     */
+    void Enforce();
+
+    /**
+     * \brief Set the eviction policy by its name, see the attribute \c EvictionPolicy.
+     * \param name the name of the eviction policy.
+     */
+    void SetEvictionPolicyName(std::string name);
+
+    /**
+     * \return the name of the eviction policy, see the attribute.
+     */
+    std::string GetEvictionPolicyName() const;
+};
+
+} // namespace ns3
+
+#endif
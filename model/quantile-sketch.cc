@@ -0,0 +1,170 @@
+#include "quantile-sketch.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("QuantileSketch");
+
+QuantileSketch::QuantileSketch(uint k)
+    : m_k(k),
+      m_count(0),
+      m_retained(0),
+      m_maxRetained(0),
+      m_min(std::numeric_limits<float>::max()),
+      m_max(std::numeric_limits<float>::lowest())
+{
+    NS_ASSERT_MSG(k >= 8, "The accuracy parameter of a QuantileSketch has to be at least 8");
+    Grow();
+}
+
+uint
+QuantileSketch::GetCapacity(uint level) const
+{
+    // lower levels shrink geometrically, so most memory is spent on the heavy top levels
+    uint depth = m_levels.size() - level - 1;
+    return static_cast<uint>(std::ceil(std::pow(2.0 / 3.0, depth) * m_k)) + 1;
+}
+
+void
+QuantileSketch::Grow()
+{
+    m_levels.emplace_back();
+    m_offsets.push_back(0);
+    m_maxRetained = 0;
+    for (uint level = 0; level < m_levels.size(); level++)
+    {
+        m_maxRetained += GetCapacity(level);
+    }
+}
+
+void
+QuantileSketch::Compress()
+{
+    for (uint level = 0; level < m_levels.size(); level++)
+    {
+        if (m_levels[level].size() < GetCapacity(level))
+        {
+            continue;
+        }
+        if (level + 1 == m_levels.size())
+        {
+            Grow();
+        }
+
+        auto& compactor = m_levels[level];
+        std::sort(compactor.begin(), compactor.end());
+        // an odd value out stays in this level
+        uint pairs = compactor.size() / 2;
+        auto& next = m_levels[level + 1];
+        for (uint i = 0; i < pairs; i++)
+        {
+            next.push_back(compactor[2 * i + m_offsets[level]]);
+        }
+        m_offsets[level] ^= 1;
+        compactor.erase(compactor.begin(), compactor.begin() + 2 * pairs);
+        m_retained -= pairs;
+        return;
+    }
+}
+
+void
+QuantileSketch::Update(float value)
+{
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_levels[0].push_back(value);
+    m_count++;
+    m_retained++;
+    if (m_retained >= m_maxRetained)
+    {
+        Compress();
+    }
+}
+
+void
+QuantileSketch::Merge(const QuantileSketch& other)
+{
+    while (m_levels.size() < other.m_levels.size())
+    {
+        Grow();
+    }
+    for (uint level = 0; level < other.m_levels.size(); level++)
+    {
+        m_levels[level].insert(m_levels[level].end(),
+                               other.m_levels[level].begin(),
+                               other.m_levels[level].end());
+    }
+    m_count += other.m_count;
+    m_retained += other.m_retained;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    while (m_retained >= m_maxRetained)
+    {
+        uint retained = m_retained;
+        Compress();
+        if (m_retained == retained)
+        {
+            break;
+        }
+    }
+}
+
+float
+QuantileSketch::GetQuantile(double q) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    if (q <= 0)
+    {
+        return m_min;
+    }
+    if (q >= 1)
+    {
+        return m_max;
+    }
+
+    std::vector<std::pair<float, uint64_t>> weighted;
+    weighted.reserve(m_retained);
+    uint64_t total = 0;
+    for (uint level = 0; level < m_levels.size(); level++)
+    {
+        for (float value : m_levels[level])
+        {
+            weighted.emplace_back(value, uint64_t{1} << level);
+            total += uint64_t{1} << level;
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    double rank = q * total;
+    uint64_t cumulative = 0;
+    for (const auto& [value, weight] : weighted)
+    {
+        cumulative += weight;
+        if (cumulative >= rank)
+        {
+            return value;
+        }
+    }
+    return m_max;
+}
+
+uint64_t
+QuantileSketch::GetCount() const
+{
+    return m_count;
+}
+
+uint
+QuantileSketch::GetRetained() const
+{
+    return m_retained;
+}
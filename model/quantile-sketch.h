@@ -0,0 +1,90 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class QuantileSketch
+ * \brief A mergeable streaming quantile sketch (KLL) with bounded memory.
+ *
+ * Values are collected in a hierarchy of compactors. Once a compactor is full, it is sorted and
+ * every other value is promoted to the next level, where each value represents twice as many
+ * samples. The sketch keeps O(k log(n / k)) values for n samples, and the rank error of a quantile
+ * query is roughly proportional to 1 / k. The compaction offsets alternate instead of being drawn
+ * randomly, so a simulation run is reproducible.
+ */
+class QuantileSketch
+{
+  public:
+    /**
+     * \brief Creates a new QuantileSketch.
+     * \param k the accuracy parameter, i.e. the capacity of the top compactor.
+     */
+    QuantileSketch(uint k = 200);
+
+    /**
+     * \brief Add a value to the sketch.
+     * \param value the value to add.
+     */
+    void Update(float value);
+
+    /**
+     * \brief Add all values of another sketch to this sketch.
+     * \param other the sketch to merge.
+     */
+    void Merge(const QuantileSketch& other);
+
+    /**
+     * \brief Estimate a quantile of all added values.
+     * \param q the quantile in [0, 1], e.g. 0.95 for the 95th percentile.
+     * \return the estimated quantile, or 0 if the sketch is empty.
+     */
+    float GetQuantile(double q) const;
+
+    /**
+     * \return the number of added values.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * \return the number of values currently kept by the sketch.
+     */
+    uint GetRetained() const;
+
+  private:
+    uint m_k;                                //!< Accuracy parameter
+    uint64_t m_count;                        //!< Number of added values
+    uint m_retained;                         //!< Number of values kept in all compactors
+    uint m_maxRetained;                      //!< Number of kept values that triggers a compaction
+    float m_min;                             //!< Smallest added value
+    float m_max;                             //!< Largest added value
+    std::vector<std::vector<float>> m_levels; //!< Compactors, level h has weight 2^h
+    std::vector<uint8_t> m_offsets; //!< Offset of the next compaction of each level
+
+    /**
+     * \brief Capacity of the compactor of a level.
+     * \param level the level.
+     * \return the capacity.
+     */
+    uint GetCapacity(uint level) const;
+
+    /**
+     * \brief Add a level on top of the compactors.
+     */
+    void Grow();
+
+    /**
+     * \brief Compact the lowest full compactor into the next level.
+     */
+    void Compress();
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,248 @@
+#include "replay-buffer.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ReplayBuffer");
+
+namespace
+{
+
+constexpr char kMagic[8] = "DEFRPLY";
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kFieldsOffset = 40;
+constexpr uint32_t kFieldSize = 48;
+constexpr uint32_t kValuesOffset = 16; // after the timestamp and the sequence number
+
+uint32_t
+ElementSize(HistoryColumn::Dtype dtype)
+{
+    return dtype == HistoryColumn::DOUBLE ? 8 : 4;
+}
+
+/**
+ * \brief Copy the values of a box into a record.
+ * \return \c false if the container is not a box of element type \c T and the given length.
+ */
+template <typename T>
+bool
+CopyBox(Ptr<OpenGymDataContainer> data, uint8_t* destination, uint32_t length)
+{
+    auto box = DynamicCast<OpenGymBoxContainer<T>>(data);
+    if (!box)
+    {
+        return false;
+    }
+    auto values = box->GetData();
+    if (values.size() != length)
+    {
+        return false;
+    }
+    std::memcpy(destination, values.data(), length * sizeof(T));
+    return true;
+}
+
+} // namespace
+
+ReplayBuffer::ReplayBuffer(const std::string& path, uint64_t capacity)
+    : m_path(path),
+      m_capacity(capacity),
+      m_count(0),
+      m_recordSize(0),
+      m_fd(-1),
+      m_map(nullptr),
+      m_mapSize(0)
+{
+    NS_ASSERT_MSG(capacity > 0, "A replay buffer has to retain at least one record");
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+    if (m_map)
+    {
+        Flush();
+        munmap(m_map, m_mapSize);
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+void
+ReplayBuffer::Create(Ptr<OpenGymDictContainer> data)
+{
+    uint32_t offset = kValuesOffset;
+    for (const auto& key : data->GetKeys())
+    {
+        Field field;
+        uint rowLength;
+        NS_ABORT_MSG_IF(!HistoryColumn::GetLayout(data->Get(key), field.dtype, rowLength),
+                        "Replay buffers only store OpenGymBoxContainers, but key "
+                            << key << " holds another container");
+        NS_ABORT_MSG_IF(key.size() >= KEY_SIZE,
+                        "Key " << key << " is too long for the replay buffer");
+        uint32_t elementSize = ElementSize(field.dtype);
+        field.key = key;
+        field.length = rowLength;
+        field.offset = (offset + elementSize - 1) / elementSize * elementSize;
+        offset = field.offset + field.length * elementSize;
+        m_fields.push_back(field);
+    }
+    NS_ABORT_MSG_IF(kFieldsOffset + m_fields.size() * kFieldSize > HEADER_SIZE,
+                    "Too many keys for the replay buffer");
+    m_recordSize = (offset + 7) / 8 * 8;
+
+    m_fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    NS_ABORT_MSG_IF(m_fd < 0, "Could not open replay buffer file " << m_path);
+    m_mapSize = HEADER_SIZE + m_capacity * m_recordSize;
+    NS_ABORT_MSG_IF(ftruncate(m_fd, m_mapSize) != 0,
+                    "Could not resize replay buffer file " << m_path);
+    void* map = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    NS_ABORT_MSG_IF(map == MAP_FAILED, "Could not map replay buffer file " << m_path);
+    m_map = static_cast<uint8_t*>(map);
+
+    // the file is zero-filled, so only the nonzero header fields are written
+    uint32_t fieldCount = m_fields.size();
+    std::memcpy(m_map, kMagic, sizeof(kMagic));
+    std::memcpy(m_map + 8, &kVersion, sizeof(kVersion));
+    std::memcpy(m_map + 12, &m_recordSize, sizeof(m_recordSize));
+    std::memcpy(m_map + 16, &m_capacity, sizeof(m_capacity));
+    std::memcpy(m_map + 32, &fieldCount, sizeof(fieldCount));
+    for (uint32_t i = 0; i < fieldCount; i++)
+    {
+        uint8_t* descriptor = m_map + kFieldsOffset + i * kFieldSize;
+        uint32_t dtype = m_fields[i].dtype;
+        std::memcpy(descriptor, m_fields[i].key.c_str(), m_fields[i].key.size());
+        std::memcpy(descriptor + KEY_SIZE, &dtype, sizeof(dtype));
+        std::memcpy(descriptor + KEY_SIZE + 4, &m_fields[i].length, sizeof(uint32_t));
+        std::memcpy(descriptor + KEY_SIZE + 8, &m_fields[i].offset, sizeof(uint32_t));
+    }
+}
+
+void
+ReplayBuffer::Append(Ptr<OpenGymDictContainer> data, int64_t ns3timestamp, uint64_t sequence)
+{
+    if (!m_map)
+    {
+        Create(data);
+    }
+
+    uint8_t* record = m_map + HEADER_SIZE + (m_count % m_capacity) * m_recordSize;
+    std::memcpy(record, &ns3timestamp, sizeof(ns3timestamp));
+    std::memcpy(record + 8, &sequence, sizeof(sequence));
+    for (const auto& field : m_fields)
+    {
+        Ptr<OpenGymDataContainer> values = data->Get(field.key);
+        bool copied = false;
+        if (values)
+        {
+            uint8_t* destination = record + field.offset;
+            switch (field.dtype)
+            {
+            case HistoryColumn::FLOAT:
+                copied = CopyBox<float>(values, destination, field.length);
+                break;
+            case HistoryColumn::DOUBLE:
+                copied = CopyBox<double>(values, destination, field.length);
+                break;
+            case HistoryColumn::INT32:
+                copied = CopyBox<int32_t>(values, destination, field.length);
+                break;
+            case HistoryColumn::UINT32:
+                copied = CopyBox<uint32_t>(values, destination, field.length);
+                break;
+            }
+        }
+        NS_ABORT_MSG_IF(!copied,
+                        "The box under key " << field.key
+                                             << " does not match the layout of the replay buffer");
+    }
+
+    // publish the record only after it was written completely
+    m_count++;
+    std::memcpy(m_map + 24, &m_count, sizeof(m_count));
+}
+
+uint64_t
+ReplayBuffer::GetSize() const
+{
+    return std::min(m_count, m_capacity);
+}
+
+uint64_t
+ReplayBuffer::GetCount() const
+{
+    return m_count;
+}
+
+uint64_t
+ReplayBuffer::GetCapacity() const
+{
+    return m_capacity;
+}
+
+const std::string&
+ReplayBuffer::GetPath() const
+{
+    return m_path;
+}
+
+const std::vector<ReplayBuffer::Field>&
+ReplayBuffer::GetFields() const
+{
+    return m_fields;
+}
+
+uint8_t*
+ReplayBuffer::Record(uint64_t index) const
+{
+    NS_ASSERT_MSG(index < GetSize(), "No record at index " << index);
+    uint64_t oldest = m_count - GetSize();
+    return m_map + HEADER_SIZE + ((oldest + index) % m_capacity) * m_recordSize;
+}
+
+int64_t
+ReplayBuffer::GetTimestamp(uint64_t index) const
+{
+    int64_t timestamp;
+    std::memcpy(&timestamp, Record(index), sizeof(timestamp));
+    return timestamp;
+}
+
+uint64_t
+ReplayBuffer::GetSequence(uint64_t index) const
+{
+    uint64_t sequence;
+    std::memcpy(&sequence, Record(index) + 8, sizeof(sequence));
+    return sequence;
+}
+
+const uint8_t*
+ReplayBuffer::GetField(uint64_t index, const std::string& key, HistoryColumn::Dtype dtype) const
+{
+    for (const auto& field : m_fields)
+    {
+        if (field.key == key)
+        {
+            return field.dtype == dtype ? Record(index) + field.offset : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void
+ReplayBuffer::Flush()
+{
+    if (m_map)
+    {
+        msync(m_map, m_mapSize, MS_SYNC);
+    }
+}
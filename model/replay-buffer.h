@@ -0,0 +1,198 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include "history-column.h"
+
+#include <ns3/ai-module.h>
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <type_traits>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class ReplayBuffer
+ * \brief A persistent ring buffer of fixed-layout records in a memory-mapped file.
+ *
+ * Every record holds the ns-3 timestamp, the push sequence number and the flattened values of all
+ * OpenGymBoxContainers of one data entry. The layout is taken from the first appended dictionary,
+ * and all later dictionaries have to contain boxes with the same keys, element types and lengths.
+ * Once \c capacity records were appended, every new record overwrites the oldest one. Since the
+ * operating system pages the file in and out, the RAM footprint does not grow with the capacity.
+ *
+ * The file consists of a header of \c HEADER_SIZE bytes followed by \c capacity record slots. The
+ * header is made of little-endian fields:
+ *
+ * | Offset | Type       | Content                                                  |
+ * |--------|------------|----------------------------------------------------------|
+ * | 0      | char[8]    | magic \c "DEFRPLY" with a terminating zero               |
+ * | 8      | uint32     | format version, currently 1                              |
+ * | 12     | uint32     | record size in bytes                                     |
+ * | 16     | uint64     | capacity in records                                      |
+ * | 24     | uint64     | number of records appended so far                        |
+ * | 32     | uint32     | number of fields                                         |
+ * | 40     | field[]    | 48 bytes per field: char[32] zero-terminated key, uint32 |
+ * |        |            | HistoryColumn::Dtype, uint32 length, uint32 offset       |
+ *
+ * A record starts with the int64 ns-3 timestamp and the uint64 sequence number, followed by the
+ * values of each field at its offset. Offsets are aligned to the element size. Record \c i of all
+ * appended records is stored in slot \c i \c % \c capacity. The trainers can read the file with
+ * \c utils/replay_buffer.py without going through protobuf.
+ */
+class ReplayBuffer
+{
+  public:
+    static constexpr uint32_t HEADER_SIZE = 4096; //!< Size of the file header in bytes
+    static constexpr uint32_t KEY_SIZE = 32;      //!< Maximum key length including the zero
+
+    /**
+     * \brief Description of the values stored under one dictionary key.
+     */
+    struct Field
+    {
+        std::string key;            //!< Dictionary key
+        HistoryColumn::Dtype dtype; //!< Element type of the box
+        uint32_t length;            //!< Number of values of the box
+        uint32_t offset;            //!< Offset of the values within a record
+    };
+
+    /**
+     * \brief Creates a new replay buffer. An existing file at \c path is overwritten. The file is
+     * created when the first record is appended.
+     * \param path the path of the file.
+     * \param capacity the number of records to retain.
+     */
+    ReplayBuffer(const std::string& path, uint64_t capacity);
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    /**
+     * \brief Append a record, overwriting the oldest one if the buffer is full.
+     * \param data the dictionary with the values of the record.
+     * \param ns3timestamp the ns-3 timestamp of the record, -1 if not tracked.
+     * \param sequence the push sequence number of the record.
+     */
+    void Append(Ptr<OpenGymDictContainer> data, int64_t ns3timestamp, uint64_t sequence);
+
+    /**
+     * \return the number of records that can be read, i.e. at most the capacity.
+     */
+    uint64_t GetSize() const;
+
+    /**
+     * \return the number of records appended so far.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * \return the number of records to retain.
+     */
+    uint64_t GetCapacity() const;
+
+    /**
+     * \return the path of the file.
+     */
+    const std::string& GetPath() const;
+
+    /**
+     * \return the fields of the record layout, empty before the first record is appended.
+     */
+    const std::vector<Field>& GetFields() const;
+
+    /**
+     * \brief Read the ns-3 timestamp of a record.
+     * \param index the position of the record, 0 being the oldest retained one. Has to be smaller
+     * than \c GetSize().
+     * \return the ns-3 timestamp.
+     */
+    int64_t GetTimestamp(uint64_t index) const;
+
+    /**
+     * \brief Read the sequence number of a record.
+     * \param index the position of the record, 0 being the oldest retained one.
+     * \return the sequence number.
+     */
+    uint64_t GetSequence(uint64_t index) const;
+
+    /**
+     * \brief Access the values a record stores under a dictionary key.
+     * \param index the position of the record, 0 being the oldest retained one.
+     * \param key the dictionary key.
+     * \return a pointer into the mapped file to the values of the field, or \c nullptr if there is
+     * no such key or \c T is not its element type.
+     */
+    template <typename T>
+    const T* GetValues(uint64_t index, const std::string& key) const
+    {
+        HistoryColumn::Dtype dtype;
+        if constexpr (std::is_same_v<T, float>)
+        {
+            dtype = HistoryColumn::FLOAT;
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            dtype = HistoryColumn::DOUBLE;
+        }
+        else if constexpr (std::is_same_v<T, int32_t>)
+        {
+            dtype = HistoryColumn::INT32;
+        }
+        else
+        {
+            static_assert(std::is_same_v<T, uint32_t>, "Unsupported element type");
+            dtype = HistoryColumn::UINT32;
+        }
+        return reinterpret_cast<const T*>(GetField(index, key, dtype));
+    }
+
+    /**
+     * \brief Write all modified pages of the file back to disk.
+     */
+    void Flush();
+
+  private:
+    std::string m_path;          //!< Path of the file
+    uint64_t m_capacity;         //!< Number of records to retain
+    uint64_t m_count;            //!< Number of records appended so far
+    uint32_t m_recordSize;       //!< Size of a record in bytes
+    std::vector<Field> m_fields; //!< Layout of the records
+    int m_fd;                    //!< File descriptor of the file, -1 before the first append
+    uint8_t* m_map;              //!< Start of the mapped file
+    size_t m_mapSize;            //!< Size of the mapped file
+
+    /**
+     * \brief Derive the record layout from a dictionary, then create and map the file.
+     * \param data the first dictionary.
+     */
+    void Create(Ptr<OpenGymDictContainer> data);
+
+    /**
+     * \brief Map a position relative to the oldest retained record to the start of its slot.
+     * \param index the position of the record.
+     * \return a pointer to the record.
+     */
+    uint8_t* Record(uint64_t index) const;
+
+    /**
+     * \brief Access the values of a field of a record.
+     * \param index the position of the record.
+     * \param key the dictionary key.
+     * \param dtype the expected element type.
+     * \return a pointer to the values, or \c nullptr if the field does not exist or has another
+     * element type.
+     */
+    const uint8_t* GetField(uint64_t index,
+                            const std::string& key,
+                            HistoryColumn::Dtype dtype) const;
+};
+
+} // namespace ns3
+
+#endif
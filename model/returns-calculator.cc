@@ -0,0 +1,148 @@
+#include "returns-calculator.h"
+
+#include <ns3/log.h>
+
+#include <cmath>
+#include <utility>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ReturnsCalculator");
+
+size_t
+ReturnsCalculator::Batch::Size() const
+{
+    return ids.size();
+}
+
+void
+ReturnsCalculator::Batch::Clear()
+{
+    ids.clear();
+    steps.clear();
+    rewards.clear();
+    values.clear();
+    returns.clear();
+    advantages.clear();
+    lambdaReturns.clear();
+}
+
+ReturnsCalculator::ReturnsCalculator(double gamma, double lambda, uint nSteps, uint rolloutLength)
+    : m_gamma(gamma),
+      m_lambda(lambda),
+      m_nSteps(nSteps),
+      m_rolloutLength(rolloutLength)
+{
+    NS_ASSERT_MSG(gamma >= 0 && gamma <= 1, "The discount factor has to be in [0, 1]");
+    NS_ASSERT_MSG(lambda >= 0 && lambda <= 1, "The GAE parameter has to be in [0, 1]");
+    NS_ASSERT_MSG(nSteps > 0, "n-step returns need at least one step");
+    NS_ASSERT_MSG(rolloutLength > 0, "A rollout needs at least one step");
+}
+
+void
+ReturnsCalculator::Push(uint id, float reward, float value, bool done)
+{
+    Rollout& rollout = m_rollouts[id];
+    if (rollout.rewards.size() == m_rolloutLength)
+    {
+        Process(id, rollout, false, value);
+    }
+    rollout.rewards.push_back(reward);
+    rollout.values.push_back(value);
+    if (done)
+    {
+        Process(id, rollout, true, 0);
+    }
+}
+
+void
+ReturnsCalculator::Finish(uint id, float bootstrapValue)
+{
+    auto rollout = m_rollouts.find(id);
+    if (rollout != m_rollouts.end())
+    {
+        Process(id, rollout->second, false, bootstrapValue);
+    }
+}
+
+void
+ReturnsCalculator::Process(uint id, Rollout& rollout, bool terminal, float bootstrapValue)
+{
+    size_t count = rollout.rewards.size();
+    if (count == 0)
+    {
+        return;
+    }
+    const auto& rewards = rollout.rewards;
+    const auto& values = rollout.values;
+    double bootstrap = terminal ? 0 : bootstrapValue;
+
+    // m_suffix[t] is the discounted sum of the rewards from step t to the end of the rollout, so
+    // the sum of n rewards is a difference of two suffixes
+    m_suffix.assign(count + 1, 0);
+    for (size_t t = count; t > 0; t--)
+    {
+        m_suffix[t - 1] = rewards[t - 1] + m_gamma * m_suffix[t];
+    }
+    double gammaN = std::pow(m_gamma, m_nSteps);
+
+    size_t first = m_batch.Size();
+    m_batch.ids.resize(first + count, id);
+    m_batch.steps.resize(first + count);
+    m_batch.rewards.insert(m_batch.rewards.end(), rewards.begin(), rewards.end());
+    m_batch.values.insert(m_batch.values.end(), values.begin(), values.end());
+    m_batch.returns.resize(first + count);
+    m_batch.advantages.resize(first + count);
+    m_batch.lambdaReturns.resize(first + count);
+
+    double advantage = 0;
+    double nextValue = bootstrap;
+    for (size_t t = count; t > 0; t--)
+    {
+        size_t step = t - 1;
+        double delta = rewards[step] + m_gamma * nextValue - values[step];
+        advantage = delta + m_gamma * m_lambda * advantage;
+        nextValue = values[step];
+
+        double nStepReturn;
+        size_t end = step + m_nSteps;
+        if (end < count)
+        {
+            nStepReturn = m_suffix[step] - gammaN * m_suffix[end] + gammaN * values[end];
+        }
+        else
+        {
+            // the rollout ends within n steps, so the return is truncated there
+            nStepReturn = m_suffix[step] + std::pow(m_gamma, count - step) * bootstrap;
+        }
+
+        m_batch.steps[first + step] = rollout.processed + step;
+        m_batch.returns[first + step] = nStepReturn;
+        m_batch.advantages[first + step] = advantage;
+        m_batch.lambdaReturns[first + step] = advantage + values[step];
+    }
+
+    rollout.processed += count;
+    rollout.rewards.clear();
+    rollout.values.clear();
+}
+
+uint
+ReturnsCalculator::GetPendingCount(uint id) const
+{
+    auto rollout = m_rollouts.find(id);
+    return rollout == m_rollouts.end() ? 0 : rollout->second.rewards.size();
+}
+
+const ReturnsCalculator::Batch&
+ReturnsCalculator::GetBatch() const
+{
+    return m_batch;
+}
+
+void
+ReturnsCalculator::TakeBatch(Batch& batch)
+{
+    batch.Clear();
+    std::swap(batch, m_batch);
+}
@@ -0,0 +1,143 @@
+#ifndef RETURNS_CALCULATOR_H
+#define RETURNS_CALCULATOR_H
+
+#include <cstdint>
+#include <map>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class ReturnsCalculator
+ * \brief Computes discounted n-step returns and generalized advantage estimates (GAE) from the
+ * per-step rewards of each agent while they arrive.
+ *
+ * Every step \c t of an agent consists of the reward \c r_t received after acting in state \c s_t,
+ * the value estimate \c V(s_t) and whether the episode ended with the step. The steps of an agent
+ * are collected into a rollout, which is processed in one backward pass once it is complete:
+ * - when a step ends the episode, without bootstrapping,
+ * - when \c rolloutLength steps are pending and the next step arrives, bootstrapping from the value
+ *   of that step, which then starts the next rollout,
+ * - or when \c Finish() is called, bootstrapping from the given value.
+ *
+ * For each step, the n-step return is
+ * \f$G_t = \sum_{k=0}^{m-1} \gamma^k r_{t+k} + \gamma^m V(s_{t+m})\f$ with \f$m = \min(n, T - t)\f$
+ * for a rollout of \c T steps, the advantage is
+ * \f$A_t = \sum_{k \ge 0} (\gamma \lambda)^k \delta_{t+k}\f$ with
+ * \f$\delta_t = r_t + \gamma V(s_{t+1}) - V(s_t)\f$, truncated at the end of the rollout, and the
+ * lambda-return is \f$A_t + V(s_t)\f$. Processing a rollout takes O(T) time independent of \c n,
+ * and the results of all agents are appended to one batch of parallel arrays.
+ */
+class ReturnsCalculator
+{
+  public:
+    /**
+     * \brief Results of processed steps, stored as parallel arrays so that each of them can be
+     * sent as one box.
+     */
+    struct Batch
+    {
+        std::vector<uint> ids;            //!< ID of the agent of each step
+        std::vector<uint64_t> steps;      //!< Index of each step among the steps of its agent
+        std::vector<float> rewards;       //!< Reward of each step
+        std::vector<float> values;        //!< Value estimate of the state of each step
+        std::vector<float> returns;       //!< Discounted n-step return of each step
+        std::vector<float> advantages;    //!< Generalized advantage estimate of each step
+        std::vector<float> lambdaReturns; //!< lambda-return of each step
+
+        /**
+         * \return the number of steps in the batch.
+         */
+        size_t Size() const;
+
+        /**
+         * \brief Remove all steps, keeping the allocated memory.
+         */
+        void Clear();
+    };
+
+    /**
+     * \brief Creates a new ReturnsCalculator.
+     * \param gamma the discount factor in [0, 1].
+     * \param lambda the GAE parameter in [0, 1].
+     * \param nSteps the number of rewards of an n-step return, at least 1.
+     * \param rolloutLength the maximum number of steps of a rollout, at least 1.
+     */
+    ReturnsCalculator(double gamma = 0.99,
+                      double lambda = 0.95,
+                      uint nSteps = 1,
+                      uint rolloutLength = 128);
+
+    /**
+     * \brief Add the next step of an agent.
+     * \param id the ID of the agent, e.g. the ID of its reward history.
+     * \param reward the reward received after acting.
+     * \param value the value estimate of the state the agent acted in, 0 if no critic is used.
+     * \param done whether the episode ended with this step.
+     */
+    void Push(uint id, float reward, float value = 0, bool done = false);
+
+    /**
+     * \brief Process the pending steps of an agent, e.g. when the simulation ends before the
+     * episode does.
+     * \param id the ID of the agent.
+     * \param bootstrapValue the value estimate of the state after the last pending step.
+     */
+    void Finish(uint id, float bootstrapValue = 0);
+
+    /**
+     * \param id the ID of the agent.
+     * \return the number of steps of the agent that were not processed yet.
+     */
+    uint GetPendingCount(uint id) const;
+
+    /**
+     * \brief Access the results of all processed steps that were not taken yet, in the order the
+     * rollouts were processed.
+     * \return the batch.
+     */
+    const Batch& GetBatch() const;
+
+    /**
+     * \brief Move the results of all processed steps into a batch, which is cleared first. Passing
+     * the same batch every time reuses its memory.
+     * \param batch the batch to fill.
+     */
+    void TakeBatch(Batch& batch);
+
+  private:
+    /**
+     * \brief The pending steps of one agent.
+     */
+    struct Rollout
+    {
+        std::vector<float> rewards; //!< Reward of each pending step
+        std::vector<float> values;  //!< Value estimate of each pending step
+        uint64_t processed = 0;     //!< Number of steps of the agent processed so far
+    };
+
+    double m_gamma;                     //!< Discount factor
+    double m_lambda;                    //!< GAE parameter
+    uint m_nSteps;                      //!< Rewards per n-step return
+    uint m_rolloutLength;               //!< Maximum number of steps of a rollout
+    std::map<uint, Rollout> m_rollouts; //!< Pending steps by agent ID
+    Batch m_batch;                      //!< Results of processed steps
+    std::vector<double> m_suffix;       //!< Discounted reward sums of the rollout being processed
+
+    /**
+     * \brief Process all pending steps of an agent.
+     * \param id the ID of the agent.
+     * \param rollout the pending steps.
+     * \param terminal whether the episode ended with the last pending step.
+     * \param bootstrapValue the value estimate of the state after the last pending step, ignored
+     * if \c terminal.
+     */
+    void Process(uint id, Rollout& rollout, bool terminal, float bootstrapValue);
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,173 @@
+#include "sliding-window-aggregator.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SlidingWindowAggregator");
+
+SlidingWindowAggregator::KeyWindow::KeyWindow(uint length)
+    : averages(length),
+      minima(length),
+      maxima(length),
+      sum(0),
+      mean(0),
+      m2(0),
+      count(0)
+{
+}
+
+SlidingWindowAggregator::SlidingWindowAggregator(uint length)
+    : m_length(length),
+      m_pushed(0)
+{
+    NS_ASSERT_MSG(length > 0, "The window has to contain at least one data entry");
+}
+
+void
+SlidingWindowAggregator::Expire(KeyWindow& window)
+{
+    // entries with a sequence number of at most this bound left the window
+    if (m_pushed <= m_length)
+    {
+        return;
+    }
+    uint64_t bound = m_pushed - m_length;
+    while (!window.averages.Empty() && window.averages.Front().sequence <= bound)
+    {
+        // inverse of Welford's update
+        double value = window.averages.Front().value;
+        window.sum -= value;
+        window.count--;
+        if (window.count > 0)
+        {
+            double delta = value - window.mean;
+            window.mean -= delta / window.count;
+            window.m2 = std::max(window.m2 - delta * (value - window.mean), 0.0);
+        }
+        window.averages.PopFront();
+    }
+    while (!window.minima.Empty() && window.minima.Front().sequence <= bound)
+    {
+        window.minima.PopFront();
+    }
+    while (!window.maxima.Empty() && window.maxima.Front().sequence <= bound)
+    {
+        window.maxima.PopFront();
+    }
+    if (window.count == 0)
+    {
+        // avoid accumulating rounding errors over windows that became empty
+        window.sum = 0;
+        window.mean = 0;
+        window.m2 = 0;
+    }
+}
+
+void
+SlidingWindowAggregator::Push(const KeyedInfo& info)
+{
+    m_pushed++;
+    // keys missing in the new entry still lose their oldest values
+    for (auto& window : m_windows)
+    {
+        if (window)
+        {
+            Expire(*window);
+        }
+    }
+
+    for (const auto& [key, entryInfo] : info)
+    {
+        if (key >= m_windows.size())
+        {
+            m_windows.resize(key + 1);
+        }
+        if (!m_windows[key])
+        {
+            m_windows[key].emplace(m_length);
+        }
+        KeyWindow& keyWindow = *m_windows[key];
+
+        float average = entryInfo.GetAvg();
+        keyWindow.averages.PushBack({m_pushed, average});
+        keyWindow.sum += average;
+        keyWindow.count++;
+        double delta = average - keyWindow.mean;
+        keyWindow.mean += delta / keyWindow.count;
+        keyWindow.m2 += delta * (average - keyWindow.mean);
+
+        float min = entryInfo.GetMin();
+        while (!keyWindow.minima.Empty() && keyWindow.minima.Back().value >= min)
+        {
+            keyWindow.minima.PopBack();
+        }
+        keyWindow.minima.PushBack({m_pushed, min});
+
+        float max = entryInfo.GetMax();
+        while (!keyWindow.maxima.Empty() && keyWindow.maxima.Back().value <= max)
+        {
+            keyWindow.maxima.PopBack();
+        }
+        keyWindow.maxima.PushBack({m_pushed, max});
+    }
+}
+
+std::map<std::string, AggregatedInfo>
+SlidingWindowAggregator::GetInfo() const
+{
+    std::map<std::string, AggregatedInfo> result;
+    for (KeyId key = 0; key < m_windows.size(); key++)
+    {
+        if (auto info = GetInfo(key))
+        {
+            result.emplace(KeyRegistry::GetKey(key), *info);
+        }
+    }
+    return result;
+}
+
+std::optional<AggregatedInfo>
+SlidingWindowAggregator::GetInfo(KeyId key, int stats) const
+{
+    if (key >= m_windows.size() || !m_windows[key] || m_windows[key]->count == 0)
+    {
+        return std::nullopt;
+    }
+    const KeyWindow& window = *m_windows[key];
+    AggregatedInfo info;
+    if (stats & AggregatedInfo::MIN)
+    {
+        info.UpdateMin(window.minima.Front().value);
+    }
+    if (stats & AggregatedInfo::MAX)
+    {
+        info.UpdateMax(window.maxima.Front().value);
+    }
+    if (stats & AggregatedInfo::AVG)
+    {
+        // min and max were set above, the reduction only adds the moments of the entry averages
+        info.UpdateStatistics(Reduction{std::numeric_limits<double>::infinity(),
+                                        -std::numeric_limits<double>::infinity(),
+                                        window.sum,
+                                        window.count,
+                                        window.m2});
+    }
+    return info;
+}
+
+uint
+SlidingWindowAggregator::GetLength() const
+{
+    return m_length;
+}
+
+void
+SlidingWindowAggregator::Clear()
+{
+    m_pushed = 0;
+    m_windows.clear();
+}
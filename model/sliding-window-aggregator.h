@@ -0,0 +1,180 @@
+#ifndef SLIDING_WINDOW_AGGREGATOR_H
+#define SLIDING_WINDOW_AGGREGATOR_H
+
+#include "aggregated-info.h"
+#include "key-registry.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Aggregated information of a data entry for each of its interned dictionary keys.
+ */
+using KeyedInfo = std::vector<std::pair<KeyId, AggregatedInfo>>;
+
+/**
+ * \ingroup defiance
+ * \class SlidingWindowAggregator
+ * \brief Incrementally aggregates the newest \c n data entries of one history.
+ *
+ * For every dictionary key, the aggregator keeps the count, sum, Welford mean and squared
+ * deviations of the per-entry averages, which are removed again with the inverse update when an
+ * entry leaves the window, and two monotonic queues holding the candidates for the minimum and
+ * maximum of the window. Pushing an entry is amortized O(1) per key and reading the aggregated
+ * information is O(1) per key. The result equals the one of \c HistoryContainer::AggregateNewest()
+ * over the same entries up to rounding: min and max are taken over all values, while count, sum,
+ * average and variance are the ones of the per-entry averages.
+ */
+class SlidingWindowAggregator
+{
+  public:
+    /**
+     * \brief Creates a new SlidingWindowAggregator.
+     * \param length the number of newest data entries to aggregate.
+     */
+    SlidingWindowAggregator(uint length);
+
+    /**
+     * \brief Add a data entry to the window. The oldest entry leaves the window once it is full.
+     * \param info the aggregated information of the entry for each of its dictionary keys.
+     */
+    void Push(const KeyedInfo& info);
+
+    /**
+     * \brief Get the aggregated information of all dictionary keys occurring in the window.
+     * \return a map with the keys of the dictionary and the aggregated information for each key.
+     */
+    std::map<std::string, AggregatedInfo> GetInfo() const;
+
+    /**
+     * \brief Get the aggregated information of a single dictionary key.
+     * \param key the id of the dictionary key.
+     * \param stats the statistics to compute, a combination of AggregatedInfo::Statistic flags.
+     * The others keep the values of an empty AggregatedInfo, like in
+     * \c HistoryContainer::Aggregate().
+     * \return the aggregated information, or \c std::nullopt if the key does not occur in the
+     * window.
+     */
+    std::optional<AggregatedInfo> GetInfo(KeyId key, int stats = AggregatedInfo::ALL) const;
+
+    /**
+     * \return the number of data entries aggregated by the window.
+     */
+    uint GetLength() const;
+
+    /**
+     * \brief Remove all data entries from the window.
+     */
+    void Clear();
+
+  private:
+    /**
+     * \brief A queue of fixed capacity that is allocated once.
+     */
+    template <typename T>
+    class RingQueue
+    {
+      public:
+        RingQueue(uint capacity = 0)
+            : m_items(capacity),
+              m_head(0),
+              m_size(0)
+        {
+        }
+
+        bool Empty() const
+        {
+            return m_size == 0;
+        }
+
+        T& Front()
+        {
+            return m_items[m_head];
+        }
+
+        const T& Front() const
+        {
+            return m_items[m_head];
+        }
+
+        T& Back()
+        {
+            return m_items[Index(m_size - 1)];
+        }
+
+        void PushBack(const T& item)
+        {
+            m_items[Index(m_size)] = item;
+            m_size++;
+        }
+
+        void PopFront()
+        {
+            m_head = Index(1);
+            m_size--;
+        }
+
+        void PopBack()
+        {
+            m_size--;
+        }
+
+      private:
+        uint Index(uint offset) const
+        {
+            uint index = m_head + offset;
+            return index >= m_items.size() ? index - m_items.size() : index;
+        }
+
+        std::vector<T> m_items;
+        uint m_head;
+        uint m_size;
+    };
+
+    /**
+     * \brief A value of an entry, tagged with the sequence number of the entry.
+     */
+    struct Sample
+    {
+        uint64_t sequence;
+        float value;
+    };
+
+    /**
+     * \brief Window state of one dictionary key.
+     */
+    struct KeyWindow
+    {
+        KeyWindow(uint length);
+
+        RingQueue<Sample> averages; //!< Per-entry averages of the entries in the window
+        RingQueue<Sample> minima;   //!< Increasing candidates for the minimum of the window
+        RingQueue<Sample> maxima;   //!< Decreasing candidates for the maximum of the window
+        double sum;                 //!< Sum of the per-entry averages in the window
+        double mean;                //!< Mean of the per-entry averages in the window
+        double m2;                  //!< Sum of their squared deviations from the mean
+        uint count;                 //!< Number of entries in the window containing the key
+    };
+
+    uint m_length;     //!< Number of entries in the window
+    uint64_t m_pushed; //!< Number of entries pushed so far
+    std::vector<std::optional<KeyWindow>> m_windows; //!< Window state indexed by key id
+
+    /**
+     * \brief Remove the values of entries that left the window.
+     * \param window the window state of a key.
+     */
+    void Expire(KeyWindow& window);
+};
+
+} // namespace ns3
+
+#endif
@@ -0,0 +1,104 @@
+#include "sum-tree.h"
+
+#include <ns3/log.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SumTree");
+
+SumTree::SumTree(uint capacity)
+    : m_capacity(0),
+      m_leaves(1)
+{
+    Resize(capacity);
+}
+
+uint
+SumTree::GetCapacity() const
+{
+    return m_capacity;
+}
+
+void
+SumTree::Set(uint index, double priority)
+{
+    NS_ASSERT_MSG(index < m_capacity, "No element at index " << index);
+    NS_ASSERT_MSG(priority >= 0 && std::isfinite(priority),
+                  "A priority has to be finite and non-negative");
+    uint node = m_leaves + index;
+    m_nodes[node] = priority;
+    while (node > 1)
+    {
+        node /= 2;
+        m_nodes[node] = m_nodes[2 * node] + m_nodes[2 * node + 1];
+    }
+}
+
+double
+SumTree::Get(uint index) const
+{
+    NS_ASSERT_MSG(index < m_capacity, "No element at index " << index);
+    return m_nodes[m_leaves + index];
+}
+
+double
+SumTree::GetTotal() const
+{
+    return m_nodes[1];
+}
+
+uint
+SumTree::Find(double& prefix) const
+{
+    NS_ASSERT_MSG(GetTotal() > 0, "Cannot find an element if all priorities are 0");
+    prefix = std::max(prefix, 0.0);
+    uint node = 1;
+    while (node < m_leaves)
+    {
+        uint left = 2 * node;
+        // a prefix rounded up to a subtree without priority descends into the other subtree
+        if (m_nodes[left + 1] <= 0 || (prefix < m_nodes[left] && m_nodes[left] > 0))
+        {
+            node = left;
+        }
+        else
+        {
+            prefix -= m_nodes[left];
+            node = left + 1;
+        }
+    }
+    prefix = std::min(prefix, std::nextafter(m_nodes[node], 0.0));
+    return node - m_leaves;
+}
+
+void
+SumTree::Resize(uint capacity)
+{
+    uint leaves = 1;
+    while (leaves < capacity)
+    {
+        leaves *= 2;
+    }
+    std::vector<double> nodes(2 * leaves, 0);
+    uint kept = std::min(capacity, m_capacity);
+    for (uint i = 0; i < kept; i++)
+    {
+        nodes[leaves + i] = m_nodes[m_leaves + i];
+    }
+    for (uint node = leaves - 1; node > 0; node--)
+    {
+        nodes[node] = nodes[2 * node] + nodes[2 * node + 1];
+    }
+    m_nodes.swap(nodes);
+    m_leaves = leaves;
+    m_capacity = capacity;
+}
+
+void
+SumTree::Clear()
+{
+    std::fill(m_nodes.begin(), m_nodes.end(), 0);
+}
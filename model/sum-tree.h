@@ -0,0 +1,84 @@
+#ifndef SUM_TREE_H
+#define SUM_TREE_H
+
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \class SumTree
+ * \brief A binary tree over a fixed number of non-negative priorities in which every inner node
+ * holds the sum of its children, as used for prioritized experience replay.
+ *
+ * Setting a priority and finding the element at a prefix sum of the priorities both take
+ * O(log n) time, so sampling an element with a probability proportional to its priority takes
+ * O(log n) time as well. The tree is stored implicitly in one array, the root at index 1 and the
+ * children of node \c i at \c 2i and \c 2i+1. Inner nodes are recomputed from their children
+ * instead of being adjusted by differences, so rounding errors do not accumulate.
+ */
+class SumTree
+{
+  public:
+    /**
+     * \brief Creates a new SumTree with all priorities set to 0.
+     * \param capacity the number of elements.
+     */
+    SumTree(uint capacity = 0);
+
+    /**
+     * \return the number of elements.
+     */
+    uint GetCapacity() const;
+
+    /**
+     * \brief Set the priority of an element.
+     * \param index the index of the element, smaller than \c GetCapacity().
+     * \param priority the non-negative priority.
+     */
+    void Set(uint index, double priority);
+
+    /**
+     * \param index the index of the element, smaller than \c GetCapacity().
+     * \return the priority of the element.
+     */
+    double Get(uint index) const;
+
+    /**
+     * \return the sum of all priorities.
+     */
+    double GetTotal() const;
+
+    /**
+     * \brief Find the element at a prefix sum, i.e. the first element whose priority together with
+     * the priorities of all elements before it exceeds \c prefix. Elements with priority 0 are
+     * never found as long as the total is positive.
+     * \param prefix the prefix sum in [0, \c GetTotal()). Set to the remainder of the prefix sum
+     * within the found element, which lies in [0, priority of the element).
+     * \return the index of the element.
+     */
+    uint Find(double& prefix) const;
+
+    /**
+     * \brief Change the number of elements, keeping the priorities of the elements with an index
+     * below the new capacity. This takes O(n) time.
+     * \param capacity the new number of elements.
+     */
+    void Resize(uint capacity);
+
+    /**
+     * \brief Set all priorities to 0.
+     */
+    void Clear();
+
+  private:
+    uint m_capacity;             //!< Number of elements
+    uint m_leaves;               //!< Number of leaves, the smallest power of two >= m_capacity
+    std::vector<double> m_nodes; //!< Sums of the subtrees, leaves starting at index m_leaves
+};
+
+} // namespace ns3
+
+#endif
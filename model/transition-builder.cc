@@ -0,0 +1,98 @@
+#include "transition-builder.h"
+
+#include <ns3/log.h>
+
+#include <iterator>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TransitionBuilder");
+
+TransitionBuilder::TransitionBuilder(uint capacity)
+    : m_capacity(capacity),
+      m_droppedRewards(0)
+{
+}
+
+void
+TransitionBuilder::MapReward(uint rewardId, uint observationId)
+{
+    m_rewardIds[rewardId] = observationId;
+}
+
+void
+TransitionBuilder::AddObservation(uint id, Ptr<OpenGymDictContainer> observation, Time time)
+{
+    Stream& stream = m_streams[id];
+    auto reward = stream.rewards.begin();
+    for (; reward != stream.rewards.end() && reward->time < time; reward++)
+    {
+        if (m_capacity == 0)
+        {
+            continue;
+        }
+        if (m_transitions.size() == m_capacity)
+        {
+            m_transitions.pop_front();
+        }
+        m_transitions.push_back({id,
+                                 stream.observation,
+                                 reward->reward,
+                                 observation,
+                                 stream.observationTime,
+                                 reward->time,
+                                 time});
+    }
+    // rewards received at the time of the new observation are aligned with it instead
+    stream.rewards.erase(stream.rewards.begin(), reward);
+    stream.observation = observation;
+    stream.observationTime = time;
+}
+
+void
+TransitionBuilder::AddReward(uint id, Ptr<OpenGymDictContainer> reward, Time time)
+{
+    auto mapped = m_rewardIds.find(id);
+    if (mapped != m_rewardIds.end())
+    {
+        id = mapped->second;
+    }
+    auto stream = m_streams.find(id);
+    if (stream == m_streams.end() || !stream->second.observation ||
+        time < stream->second.observationTime)
+    {
+        NS_LOG_INFO("Dropping reward of " << id << " at " << time
+                                          << " without a preceding observation");
+        m_droppedRewards++;
+        return;
+    }
+    stream->second.rewards.push_back({reward, time});
+}
+
+std::vector<Transition>
+TransitionBuilder::TakeTransitions()
+{
+    std::vector<Transition> transitions(std::make_move_iterator(m_transitions.begin()),
+                                        std::make_move_iterator(m_transitions.end()));
+    m_transitions.clear();
+    return transitions;
+}
+
+uint
+TransitionBuilder::GetTransitionCount() const
+{
+    return m_transitions.size();
+}
+
+uint64_t
+TransitionBuilder::GetDroppedRewardCount() const
+{
+    return m_droppedRewards;
+}
+
+void
+TransitionBuilder::Clear()
+{
+    m_streams.clear();
+    m_transitions.clear();
+}
@@ -0,0 +1,133 @@
+#ifndef TRANSITION_BUILDER_H
+#define TRANSITION_BUILDER_H
+
+#include <ns3/ai-module.h>
+#include <ns3/nstime.h>
+
+#include <deque>
+#include <map>
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup defiance
+ * \brief A reward together with the observation it followed and the observation after it.
+ */
+struct Transition
+{
+    uint id;                                   //!< ID of the observation history
+    Ptr<OpenGymDictContainer> observation;     //!< Newest observation at or before the reward
+    Ptr<OpenGymDictContainer> reward;          //!< The reward
+    Ptr<OpenGymDictContainer> nextObservation; //!< First observation after the reward
+    Time observationTime;                      //!< ns-3 time of \c observation
+    Time rewardTime;                           //!< ns-3 time of \c reward
+    Time nextObservationTime;                  //!< ns-3 time of \c nextObservation
+};
+
+/**
+ * \ingroup defiance
+ * \class TransitionBuilder
+ * \brief Incrementally joins observation and reward streams into (obs, reward, next_obs)
+ * transitions per remote app.
+ *
+ * The join is an as-of join on the ns-3 time: a reward is aligned to the newest observation of the
+ * same remote app received at or before it, and the transition is emitted once the next
+ * observation that is strictly newer than the reward arrives. Several rewards between two
+ * observations result in one transition each. Rewards arriving before the first observation, or
+ * older than the newest observation, have no preceding observation to align to and are dropped.
+ *
+ * Only the newest observation and the rewards after it are kept per remote app, plus at most
+ * \c capacity emitted transitions that were not taken yet, so the memory stays bounded.
+ */
+class TransitionBuilder
+{
+  public:
+    /**
+     * \brief Creates a new TransitionBuilder.
+     * \param capacity the number of emitted transitions to buffer. Once the buffer is full, the
+     * oldest transition is dropped for every new one.
+     */
+    TransitionBuilder(uint capacity = 1000);
+
+    /**
+     * \brief Align the rewards of a remote app with the observations of another one, e.g. if a
+     * RewardApplication and an ObservationApplication measure the same node. By default, rewards
+     * are aligned with the observations of the remote app with the same ID.
+     * \param rewardId the ID of the reward history.
+     * \param observationId the ID of the observation history.
+     */
+    void MapReward(uint rewardId, uint observationId);
+
+    /**
+     * \brief Add an observation, emitting the transitions of the rewards received since the
+     * previous observation of the remote app.
+     * \param id the ID of the observation history.
+     * \param observation the observation.
+     * \param time the ns-3 time the observation was received.
+     */
+    void AddObservation(uint id, Ptr<OpenGymDictContainer> observation, Time time);
+
+    /**
+     * \brief Add a reward. The reward is kept until the next observation of its remote app
+     * arrives.
+     * \param id the ID of the reward history.
+     * \param reward the reward.
+     * \param time the ns-3 time the reward was received.
+     */
+    void AddReward(uint id, Ptr<OpenGymDictContainer> reward, Time time);
+
+    /**
+     * \brief Remove and return all emitted transitions.
+     * \return the transitions, oldest first.
+     */
+    std::vector<Transition> TakeTransitions();
+
+    /**
+     * \return the number of emitted transitions that were not taken yet.
+     */
+    uint GetTransitionCount() const;
+
+    /**
+     * \return the number of rewards that were dropped because no observation preceded them.
+     */
+    uint64_t GetDroppedRewardCount() const;
+
+    /**
+     * \brief Forget all observations, pending rewards and emitted transitions, e.g. at the end of
+     * an episode.
+     */
+    void Clear();
+
+  private:
+    /**
+     * \brief A reward waiting for the next observation.
+     */
+    struct PendingReward
+    {
+        Ptr<OpenGymDictContainer> reward; //!< The reward
+        Time time;                        //!< ns-3 time of the reward
+    };
+
+    /**
+     * \brief Join state of one remote app.
+     */
+    struct Stream
+    {
+        Ptr<OpenGymDictContainer> observation; //!< Newest observation, \c nullptr if none yet
+        Time observationTime;                  //!< ns-3 time of \c observation
+        std::vector<PendingReward> rewards;    //!< Rewards at or after \c observationTime
+    };
+
+    uint m_capacity;                      //!< Maximum number of buffered transitions
+    std::map<uint, Stream> m_streams;     //!< Join state by observation history ID
+    std::map<uint, uint> m_rewardIds;     //!< Observation history ID of mapped reward IDs
+    std::deque<Transition> m_transitions; //!< Emitted transitions, oldest first
+    uint64_t m_droppedRewards;            //!< Rewards without a preceding observation
+};
+
+} // namespace ns3
+
+#endif
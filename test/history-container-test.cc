@@ -1,6 +1,12 @@
 #include <ns3/defiance-module.h>
 #include <ns3/test.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <numeric>
+#include <thread>
+
 using namespace ns3;
 
 /**
@@ -19,6 +25,31 @@ class HistoryContainerTest : public TestCase
     void TestAggregatedInfo();
     void TestDataStruct();
     void TestDataStructAggregation();
+    void TestRingBuffer();
+    void TestColumnarStorage();
+    void TestAggregationWindow();
+    void TestReductionKernels();
+    void TestQuantileSketch();
+    void TestRobustStatistics();
+    void TestTimeRangeQueries();
+    void TestCombinedHistory();
+    void TestHistoryViews();
+    void TestReplayBuffer();
+    void TestSparseHistoryIds();
+    void TestKeyInterning();
+    void TestRetentionPolicies();
+    void TestCompressedHistory();
+    void TestProjectionQueries();
+    void TestCrossHistoryReduction();
+    void TestTransitionBuilder();
+    void TestReturnsCalculator();
+    void TestFrameStacking();
+    void TestHistoryTiers();
+    void TestPrioritizedSampling();
+    void TestBoxDtypes();
+    void TestMemoryBudget();
+    void TestTimeToLive();
+    void TestSnapshots();
     Ptr<OpenGymBoxContainer<float>> ExtractFloatBox(Ptr<OpenGymDictContainer> dict,
                                                     std::string name);
 };
@@ -210,12 +241,1989 @@ HistoryContainerTest::TestDataStructAggregation()
     NS_TEST_ASSERT_MSG_EQ_TOL(info["sinr"].GetMin(), 1.0, 0.0001, "Min is not correct");
 }
 
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test wrap-around, ordering and resizing of the ring buffer backing each history
+ */
+void
+HistoryContainerTest::TestRingBuffer()
+{
+    TimestampedDataDeque ring(3);
+    std::vector<Ptr<OpenGymDictContainer>> dicts;
+    for (uint i = 0; i < 5; i++)
+    {
+        dicts.push_back(CreateObject<OpenGymDictContainer>());
+        ring.Push(TimestampedData(dicts.back(), false));
+    }
+
+    // the two oldest entries were overwritten
+    NS_TEST_ASSERT_MSG_EQ(ring.Size(), 3, "Size of ring buffer is not correct");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetCapacity(), 3, "Capacity of ring buffer is not correct");
+    auto newest = ring.GetNewest(3);
+    auto oldest = ring.GetOldest(3);
+    for (uint i = 0; i < 3; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(newest[i]->data, dicts[4 - i], "Newest entries are not ordered");
+        NS_TEST_ASSERT_MSG_EQ(oldest[i]->data, dicts[2 + i], "Oldest entries are not ordered");
+    }
+
+    ring.PopNewest();
+    ring.PopOldest();
+    NS_TEST_ASSERT_MSG_EQ(ring.Size(), 1, "Size after popping is not correct");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetNewest(1)[0]->data, dicts[3], "Wrong entry left after popping");
+
+    // growing keeps the stored entries, shrinking drops the oldest ones
+    ring.Push(TimestampedData(dicts[4], false));
+    ring.SetCapacity(5);
+    ring.Push(TimestampedData(dicts[0], false));
+    NS_TEST_ASSERT_MSG_EQ(ring.Size(), 3, "Size after growing is not correct");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetOldest(1)[0]->data, dicts[3], "Growing lost the oldest entry");
+    ring.SetCapacity(2);
+    NS_TEST_ASSERT_MSG_EQ(ring.Size(), 2, "Size after shrinking is not correct");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetOldest(1)[0]->data, dicts[4], "Shrinking kept the wrong entries");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetNewest(1)[0]->data, dicts[0], "Shrinking kept the wrong entries");
+
+    ring.Clear();
+    NS_TEST_ASSERT_MSG_EQ(ring.Size(), 0, "Ring buffer is not empty after clearing");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test reading box values and aggregations from the columnar storage
+ */
+void
+HistoryContainerTest::TestColumnarStorage()
+{
+    HistoryContainer columnar = HistoryContainer(2, false, true);
+    HistoryContainer plain = HistoryContainer(2);
+    std::vector<uint32_t> shape = {3};
+
+    for (int i = 0; i < 3; i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto floatBox = CreateObject<OpenGymBoxContainer<float>>(shape);
+        auto intBox = CreateObject<OpenGymBoxContainer<int32_t>>(shape);
+        for (int j = 0; j < 3; j++)
+        {
+            floatBox->AddValue(i * 10 + j + 0.5);
+            intBox->AddValue(-i * j);
+        }
+        dict->Add("floatObs", floatBox);
+        dict->Add("intObs", intBox);
+        columnar.Push(dict, 0);
+
+        auto floatDict = CreateObject<OpenGymDictContainer>();
+        floatDict->Add("floatObs", floatBox);
+        plain.Push(floatDict, 0);
+    }
+
+    auto column = columnar.GetColumn(0, "floatObs");
+    NS_TEST_ASSERT_MSG_NE(column, nullptr, "No column for key floatObs");
+    NS_TEST_ASSERT_MSG_EQ(column->GetDtype(), HistoryColumn::FLOAT, "Column type is not correct");
+    NS_TEST_ASSERT_MSG_EQ(column->GetRowLength(), 3, "Row length is not correct");
+    NS_TEST_ASSERT_MSG_EQ(plain.GetColumn(0, "floatObs"), nullptr, "Column without columnar mode");
+
+    const float* newest = columnar.GetNewestValues<float>(0, "floatObs");
+    const float* older = columnar.GetNewestValues<float>(0, "floatObs", 1);
+    const int32_t* newestInts = columnar.GetNewestValues<int32_t>(0, "intObs");
+    NS_TEST_ASSERT_MSG_EQ_TOL(newest[2], 22.5, 0.0001, "Newest column value is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(older[0], 10.5, 0.0001, "Older column value is not correct");
+    NS_TEST_ASSERT_MSG_EQ(newestInts[2], -4, "Integer column value is not correct");
+    NS_TEST_ASSERT_MSG_EQ(columnar.GetNewestValues<double>(0, "floatObs"),
+                          nullptr,
+                          "Column read with the wrong type");
+    NS_TEST_ASSERT_MSG_EQ(columnar.GetNewestValues<float>(0, "floatObs", 2),
+                          nullptr,
+                          "Column read beyond the history length");
+
+    // aggregating the columns matches aggregating the dictionaries
+    auto columnarInfo = columnar.AggregateNewest(0, 2);
+    auto plainInfo = plain.AggregateNewest(0, 2);
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnarInfo["floatObs"].GetAvg(),
+                              plainInfo["floatObs"].GetAvg(),
+                              0.0001,
+                              "Average is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnarInfo["floatObs"].GetMin(),
+                              plainInfo["floatObs"].GetMin(),
+                              0.0001,
+                              "Min is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnarInfo["floatObs"].GetMax(),
+                              plainInfo["floatObs"].GetMax(),
+                              0.0001,
+                              "Max is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnarInfo["intObs"].GetAvg(),
+                              -1.5,
+                              0.0001,
+                              "Average is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnarInfo["intObs"].GetMin(), -4.0, 0.0001, "Min is not correct");
+
+    // a box with a different length cannot be stored in the existing column
+    auto dict = CreateObject<OpenGymDictContainer>();
+    auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+    box->AddValue(1.0);
+    dict->Add("floatObs", box);
+    columnar.Push(dict, 0);
+    NS_TEST_ASSERT_MSG_EQ(columnar.GetNewestValues<float>(0, "floatObs"),
+                          nullptr,
+                          "Box with a different length was stored in the column");
+    NS_TEST_ASSERT_MSG_EQ_TOL(columnar.AggregateNewest(0)["floatObs"].GetAvg(),
+                              1.0,
+                              0.0001,
+                              "Aggregation does not fall back to the dictionary");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that aggregation windows match aggregating the newest entries
+ */
+void
+HistoryContainerTest::TestAggregationWindow()
+{
+    HistoryContainer windowed = HistoryContainer(4);
+    HistoryContainer scanned = HistoryContainer(4);
+    windowed.AddAggregationWindow(3);
+    std::vector<uint32_t> shape = {2};
+    std::vector<std::vector<float>> values = {{5, 1}, {-2, 8}, {3, 3}, {7, 0}, {4, 6}, {-1, 2}};
+
+    for (uint i = 0; i < values.size(); i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(shape);
+        box->SetData(values[i]);
+        dict->Add("sinr", box);
+        if (i % 3 == 0)
+        {
+            // a key that is missing in most entries
+            auto rareBox = CreateObject<OpenGymBoxContainer<float>>(shape);
+            rareBox->SetData({float(i), float(i)});
+            dict->Add("rare", rareBox);
+        }
+        windowed.Push(dict, 0);
+        scanned.Push(dict, 0);
+        if (i == 1)
+        {
+            // windows added later are filled with the stored entries
+            windowed.AddAggregationWindow(2);
+        }
+
+        for (uint n : {2, 3})
+        {
+            auto expected = scanned.AggregateNewest(0, n);
+            auto result = windowed.AggregateNewest(0, n);
+            NS_TEST_ASSERT_MSG_EQ(result.size(), expected.size(), "Window keys are not correct");
+            for (auto& [key, info] : expected)
+            {
+                NS_TEST_ASSERT_MSG_EQ_TOL(result[key].GetAvg(),
+                                          info.GetAvg(),
+                                          0.0001,
+                                          "Window average is not correct");
+                NS_TEST_ASSERT_MSG_EQ_TOL(result[key].GetMin(),
+                                          info.GetMin(),
+                                          0.0001,
+                                          "Window min is not correct");
+                NS_TEST_ASSERT_MSG_EQ_TOL(result[key].GetMax(),
+                                          info.GetMax(),
+                                          0.0001,
+                                          "Window max is not correct");
+                NS_TEST_ASSERT_MSG_EQ(result[key].GetCount(),
+                                      info.GetCount(),
+                                      "Window count is not correct");
+                NS_TEST_ASSERT_MSG_EQ_TOL(result[key].GetSum(),
+                                          info.GetSum(),
+                                          0.0001,
+                                          "Window sum is not correct");
+                NS_TEST_ASSERT_MSG_EQ_TOL(result[key].GetVariance(),
+                                          info.GetVariance(),
+                                          0.0001,
+                                          "Window variance is not correct");
+            }
+
+            // the window only computes the requested statistics, like a scan
+            for (int stats : {AggregatedInfo::MIN | 0, AggregatedInfo::MAX | AggregatedInfo::AVG})
+            {
+                auto expectedKey = scanned.Aggregate(0, "sinr", n, stats);
+                auto resultKey = windowed.Aggregate(0, "sinr", n, stats);
+                NS_TEST_ASSERT_MSG_EQ(resultKey.GetMin(), expectedKey.GetMin(), "Wrong min");
+                NS_TEST_ASSERT_MSG_EQ(resultKey.GetMax(), expectedKey.GetMax(), "Wrong max");
+                NS_TEST_ASSERT_MSG_EQ(resultKey.GetCount(), expectedKey.GetCount(), "Wrong count");
+                NS_TEST_ASSERT_MSG_EQ_TOL(resultKey.GetVariance(),
+                                          expectedKey.GetVariance(),
+                                          0.0001,
+                                          "Wrong variance");
+            }
+        }
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test the vectorized reduction kernels and the bulk update of AggregatedInfo against
+ * element-wise aggregation, including the lengths that leave a scalar tail
+ */
+void
+HistoryContainerTest::TestReductionKernels()
+{
+    for (uint length = 0; length < 40; length++)
+    {
+        std::vector<float> floats;
+        std::vector<double> doubles;
+        std::vector<int32_t> ints;
+        AggregatedInfo elementwise;
+        for (uint i = 0; i < length; i++)
+        {
+            floats.push_back(((i * 37 + length * 11) % 53) - 26.5);
+            doubles.push_back(floats.back() * 1e6);
+            ints.push_back((i * 7919) % 101 - 50);
+            elementwise.UpdateStatistics(floats.back());
+        }
+
+        std::vector<float> expected = floats;
+        std::sort(expected.begin(), expected.end());
+        Reduction floatReduction = Reduce(floats.data(), floats.size());
+        Reduction doubleReduction = Reduce(doubles.data(), doubles.size());
+        Reduction intReduction = Reduce(ints.data(), ints.size());
+        NS_TEST_ASSERT_MSG_EQ(floatReduction.count, length, "Count is not correct");
+        NS_TEST_ASSERT_MSG_EQ(doubleReduction.count, length, "Count is not correct");
+        if (length == 0)
+        {
+            NS_TEST_ASSERT_MSG_GT(floatReduction.min, floatReduction.max, "Empty range not empty");
+            continue;
+        }
+        double sum = 0;
+        for (auto value : floats)
+        {
+            sum += value;
+        }
+        NS_TEST_ASSERT_MSG_EQ(floatReduction.min, expected.front(), "Min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(floatReduction.max, expected.back(), "Max is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(floatReduction.sum, sum, 1e-9, "Sum is not correct");
+        NS_TEST_ASSERT_MSG_EQ(doubleReduction.min, expected.front() * 1e6, "Min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(doubleReduction.max, expected.back() * 1e6, "Max is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(doubleReduction.sum, sum * 1e6, 1e-3, "Sum is not correct");
+        NS_TEST_ASSERT_MSG_EQ(intReduction.min,
+                              *std::min_element(ints.begin(), ints.end()),
+                              "Min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(intReduction.max,
+                              *std::max_element(ints.begin(), ints.end()),
+                              "Max is not correct");
+
+        AggregatedInfo bulk;
+        bulk.UpdateStatistics(floats.data(), floats.size());
+        NS_TEST_ASSERT_MSG_EQ(bulk.GetMin(), elementwise.GetMin(), "Bulk min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(bulk.GetMax(), elementwise.GetMax(), "Bulk max is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(bulk.GetAvg(),
+                                  elementwise.GetAvg(),
+                                  0.0001,
+                                  "Bulk average is not correct");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test the quantile estimates of QuantileSketch, AggregatedInfo and the long-horizon
+ * statistics of HistoryContainer against the exact quantiles of a uniform sequence
+ */
+void
+HistoryContainerTest::TestQuantileSketch()
+{
+    // a permutation of 0, 0.001, ..., 99.999
+    const uint count = 100000;
+    QuantileSketch sketch;
+    QuantileSketch lower;
+    QuantileSketch upper;
+    for (uint i = 0; i < count; i++)
+    {
+        float value = ((i * 7919) % count) / 1000.0;
+        sketch.Update(value);
+        (i < count / 2 ? lower : upper).Update(value);
+    }
+    lower.Merge(upper);
+    NS_TEST_ASSERT_MSG_EQ(sketch.GetCount(), count, "Count is not correct");
+    NS_TEST_ASSERT_MSG_EQ(lower.GetCount(), count, "Merged count is not correct");
+    NS_TEST_ASSERT_MSG_LT(sketch.GetRetained(), 2000, "Sketch memory is not bounded");
+    NS_TEST_ASSERT_MSG_LT(lower.GetRetained(), 2000, "Merged sketch memory is not bounded");
+    for (double q : {0.5, 0.95, 0.99})
+    {
+        NS_TEST_ASSERT_MSG_EQ_TOL(sketch.GetQuantile(q), q * 100, 1.5, "Quantile is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(lower.GetQuantile(q), q * 100, 1.5, "Merged quantile is wrong");
+    }
+    NS_TEST_ASSERT_MSG_EQ(sketch.GetQuantile(0), 0, "Minimum is not exact");
+    NS_TEST_ASSERT_MSG_EQ_TOL(sketch.GetQuantile(1), 99.999, 0.0001, "Maximum is not exact");
+
+    AggregatedInfo info;
+    NS_TEST_ASSERT_MSG_EQ(info.HasQuantiles(), false, "Quantiles are enabled by default");
+    info.EnableQuantiles();
+    std::vector<float> values = {4, 1, 3, 2, 5};
+    info.UpdateStatistics(values.data(), values.size());
+    NS_TEST_ASSERT_MSG_EQ(info.GetQuantile(0.5), 3, "Median is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(info.GetAvg(), 3, 0.0001, "Average is not correct");
+
+    // the horizon outlives the two stored entries
+    for (bool columnar : {false, true})
+    {
+        HistoryContainer container = HistoryContainer(2, false, columnar);
+        container.TrackQuantiles();
+        std::vector<uint32_t> shape = {2};
+        for (uint i = 0; i < 1000; i++)
+        {
+            auto dict = CreateObject<OpenGymDictContainer>();
+            auto box = CreateObject<OpenGymBoxContainer<float>>(shape);
+            box->SetData({float((i * 7) % 1000), float((i * 13) % 1000)});
+            dict->Add("latency", box);
+            container.Push(dict, 0);
+        }
+        auto horizon = container.AggregateHorizon(0)["latency"];
+        NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 2, "History is not limited");
+        NS_TEST_ASSERT_MSG_EQ(horizon.GetMin(), 0, "Horizon min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(horizon.GetMax(), 999, "Horizon max is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(horizon.GetAvg(), 499.5, 0.01, "Horizon average is wrong");
+        NS_TEST_ASSERT_MSG_EQ_TOL(horizon.GetQuantile(0.95), 950, 5, "Horizon p95 is not correct");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test variance, merging and the precision of AggregatedInfo over long streams
+ */
+void
+HistoryContainerTest::TestRobustStatistics()
+{
+    std::vector<float> values = {2, 4, 4, 4, 5, 5, 7, 9};
+    AggregatedInfo elementwise;
+    for (auto value : values)
+    {
+        elementwise.UpdateStatistics(value);
+    }
+    AggregatedInfo bulk;
+    bulk.UpdateStatistics(values.data(), values.size());
+    for (const auto& info : {elementwise, bulk})
+    {
+        NS_TEST_ASSERT_MSG_EQ(info.GetCount(), 8, "Count is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(info.GetAvg(), 5, 1e-6, "Average is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(info.GetVariance(), 4, 1e-9, "Variance is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(info.GetStddev(), 2, 1e-9, "Stddev is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(info.GetSum(), 40, 1e-9, "Sum is not correct");
+    }
+
+    AggregatedInfo negative;
+    negative.UpdateStatistics(-3.0f);
+    negative.UpdateStatistics(-1.0f);
+    NS_TEST_ASSERT_MSG_EQ(negative.GetMax(), -1, "Max of negative values is not correct");
+
+    // shards merged in any grouping give the result of one sequential pass
+    AggregatedInfo sequential;
+    std::vector<AggregatedInfo> shards(4);
+    for (uint i = 0; i < 1000; i++)
+    {
+        float value = 1e6 + (i * 37) % 101;
+        sequential.UpdateStatistics(value);
+        shards[i % shards.size()].UpdateStatistics(value);
+    }
+    shards[0].Merge(shards[1]);
+    shards[2].Merge(shards[3]);
+    shards[2].Merge(AggregatedInfo());
+    shards[0].Merge(shards[2]);
+    NS_TEST_ASSERT_MSG_EQ(shards[0].GetCount(), sequential.GetCount(), "Merged count is wrong");
+    NS_TEST_ASSERT_MSG_EQ(shards[0].GetMin(), sequential.GetMin(), "Merged min is wrong");
+    NS_TEST_ASSERT_MSG_EQ(shards[0].GetMax(), sequential.GetMax(), "Merged max is wrong");
+    NS_TEST_ASSERT_MSG_EQ_TOL(shards[0].GetSum(), sequential.GetSum(), 1e-6, "Merged sum is wrong");
+    NS_TEST_ASSERT_MSG_EQ_TOL(shards[0].GetVariance(),
+                              sequential.GetVariance(),
+                              1e-6,
+                              "Merged variance is not correct");
+    NS_TEST_ASSERT_MSG_GT(sequential.GetVariance(), 800, "Variance lost to cancellation");
+
+    // the vectorized kernels accumulate the squared deviations in the same pass
+    std::vector<double> offsetValues;
+    for (uint i = 0; i < 1003; i++)
+    {
+        offsetValues.push_back(1e9 + (i * 37) % 101);
+    }
+    AggregatedInfo offsetBulk;
+    offsetBulk.UpdateStatistics(offsetValues.data(), offsetValues.size());
+    AggregatedInfo offsetSequential;
+    for (auto value : offsetValues)
+    {
+        AggregatedInfo single;
+        single.UpdateStatistics(&value, 1);
+        offsetSequential.Merge(single);
+    }
+    NS_TEST_ASSERT_MSG_EQ_TOL(offsetBulk.GetVariance(),
+                              offsetSequential.GetVariance(),
+                              1e-6,
+                              "Bulk variance is not correct");
+    NS_TEST_ASSERT_MSG_GT(offsetBulk.GetVariance(), 800, "Bulk variance lost to cancellation");
+
+    // a drifting stream matches the two-pass variance, value by value and in bulk
+    std::vector<float> drift;
+    for (uint i = 0; i < 100003; i++)
+    {
+        drift.push_back(i * 100 + (i * 37) % 101);
+    }
+    double driftMean = std::accumulate(drift.begin(), drift.end(), 0.0) / drift.size();
+    double driftVariance = 0;
+    for (auto value : drift)
+    {
+        driftVariance += (value - driftMean) * (value - driftMean) / drift.size();
+    }
+    AggregatedInfo driftSequential;
+    for (auto value : drift)
+    {
+        driftSequential.UpdateStatistics(value);
+    }
+    AggregatedInfo driftBulk;
+    driftBulk.UpdateStatistics(drift.data(), drift.size());
+    NS_TEST_ASSERT_MSG_EQ_TOL(driftSequential.GetVariance() / driftVariance,
+                              1,
+                              1e-9,
+                              "Variance of a drifting stream is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(driftBulk.GetVariance() / driftVariance,
+                              1,
+                              1e-9,
+                              "Bulk variance of a drifting stream is not correct");
+
+    // a float counter would stop at 2^24 values
+    AggregatedInfo large;
+    std::vector<float> block(1 << 20, 0.1f);
+    for (uint i = 0; i < 20; i++)
+    {
+        large.UpdateStatistics(block.data(), block.size());
+    }
+    NS_TEST_ASSERT_MSG_EQ(large.GetCount(), 20u << 20, "Count is not exact");
+    NS_TEST_ASSERT_MSG_EQ_TOL(large.GetAvg(), 0.1f, 1e-7, "Average drifted");
+    NS_TEST_ASSERT_MSG_EQ_TOL(large.GetSum(),
+                              static_cast<double>(0.1f) * (20u << 20),
+                              1e-3,
+                              "Sum drifted");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test the simulation time range queries and the timestamp resolution of HistoryContainer
+ */
+void
+HistoryContainerTest::TestTimeRangeQueries()
+{
+    HistoryContainer container = HistoryContainer(8, true);
+    HistoryContainer wallClock = HistoryContainer(1, true, false, true);
+    std::vector<uint32_t> shape = {1};
+    // one entry every 100 ms from 0 ms to 1900 ms, only the last 8 are stored
+    for (uint i = 0; i < 20; i++)
+    {
+        Simulator::Schedule(MilliSeconds(100 * i), [&container, &wallClock, shape, i]() {
+            auto dict = CreateObject<OpenGymDictContainer>();
+            auto box = CreateObject<OpenGymBoxContainer<float>>(shape);
+            box->AddValue(i);
+            dict->Add("time", box);
+            container.Push(dict, 0);
+            wallClock.Push(dict, 0);
+        });
+    }
+    Simulator::Schedule(MicroSeconds(1500), [&container, shape]() {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        dict->Add("time", CreateObject<OpenGymBoxContainer<float>>(shape));
+        container.Push(dict, 1);
+    });
+    Simulator::Run();
+
+    auto since = container.GetSince(0, MilliSeconds(1500));
+    NS_TEST_ASSERT_MSG_EQ(since.size(), 5, "Wrong number of entries since 1500 ms");
+    NS_TEST_ASSERT_MSG_EQ(since[0]->GetNs3Time(), MilliSeconds(1900), "Newest entry is not first");
+    NS_TEST_ASSERT_MSG_EQ(since[4]->GetNs3Time(), MilliSeconds(1500), "Start is not inclusive");
+
+    auto range = container.GetRangeByID(0, MilliSeconds(1250), MilliSeconds(1600));
+    NS_TEST_ASSERT_MSG_EQ(range.size(), 4, "Wrong number of entries in range");
+    NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(range[0]->data, "time")->GetValue(0),
+                          16,
+                          "End is not inclusive");
+    NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(range[3]->data, "time")->GetValue(0),
+                          13,
+                          "Range start is not correct");
+
+    NS_TEST_ASSERT_MSG_EQ(container.GetSince(0, Time()).size(), 8, "Overwritten entries found");
+    NS_TEST_ASSERT_MSG_EQ(container.GetRangeByID(0, Time(), MilliSeconds(1150)).size(),
+                          0,
+                          "Entries before the stored ones found");
+    NS_TEST_ASSERT_MSG_EQ(container.GetRangeByID(0, MilliSeconds(1600), MilliSeconds(1500)).size(),
+                          0,
+                          "Empty range is not empty");
+
+    // sim time is stored at full resolution, wall-clock time only on request
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestByID(1)->GetNs3Time(),
+                          MicroSeconds(1500),
+                          "Time is truncated");
+    NS_TEST_ASSERT_MSG_EQ((container.GetNewestByID(0)->timestamp ==
+                           std::chrono::steady_clock::time_point()),
+                          true,
+                          "Wall-clock time is tracked but shouldn't be");
+    NS_TEST_ASSERT_MSG_EQ((wallClock.GetNewestByID(0)->timestamp ==
+                           std::chrono::steady_clock::time_point()),
+                          false,
+                          "Wall-clock time is not tracked");
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that the combined history merges the history deques in push order and only
+ * contains entries that are still stored in them
+ */
+void
+HistoryContainerTest::TestCombinedHistory()
+{
+    HistoryContainer container = HistoryContainer(3);
+    std::vector<uint32_t> shape = {1};
+    // id 0 receives data more often than id 1
+    std::vector<uint> ids = {0, 0, 0, 0, 0, 1, 0, 1, 2};
+    for (uint i = 0; i < ids.size(); i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(shape);
+        box->AddValue(i);
+        dict->Add("push", box);
+        container.Push(dict, ids[i]);
+    }
+    container.DeleteHistory(2);
+
+    // push 2 was overwritten in history 0, push 8 was deleted with history 2
+    std::vector<float> expected = {7, 6, 5, 4, 3};
+    auto combined = container.GetNewestOfCombinedHistory(10);
+    NS_TEST_ASSERT_MSG_EQ(container.GetSizeOfHistory(), expected.size(), "Size is not correct");
+    NS_TEST_ASSERT_MSG_EQ(combined.size(), expected.size(), "Wrong number of entries");
+    for (uint i = 0; i < combined.size() && i < expected.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(combined[i]->data, "push")->GetValue(0),
+                              expected[i],
+                              "Entries are not in push order");
+    }
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestOfCombinedHistory(2).size(), 2, "Limit is ignored");
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestOfCombinedHistory(),
+                          container.GetNewestByID(1),
+                          "Newest entry is not correct");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test iterating the views returned by TimestampedDataDeque and HistoryContainer across the
+ * wrap-around of the ring buffer
+ */
+void
+HistoryContainerTest::TestHistoryViews()
+{
+    TimestampedDataDeque ring(4);
+    NS_TEST_ASSERT_MSG_EQ(ring.GetNewest(2).empty(), true, "View of empty deque is not empty");
+    NS_TEST_ASSERT_MSG_EQ(ring.GetOldest(2).size(), 0, "View of empty deque is not empty");
+
+    std::vector<Ptr<OpenGymDictContainer>> dicts;
+    for (uint i = 0; i < 6; i++)
+    {
+        dicts.push_back(CreateObject<OpenGymDictContainer>());
+        ring.Push(TimestampedData(dicts.back(), false));
+    }
+
+    // the ring holds entries 2 to 5, starting in the middle of its slots
+    uint i = 0;
+    for (TimestampedData* entry : ring.GetAll())
+    {
+        NS_TEST_ASSERT_MSG_EQ(entry->data, dicts[5 - i], "Newest-first iteration is wrong");
+        i++;
+    }
+    NS_TEST_ASSERT_MSG_EQ(i, 4, "Wrong number of iterated entries");
+    i = 0;
+    for (TimestampedData* entry : ring.GetOldest(10))
+    {
+        NS_TEST_ASSERT_MSG_EQ(entry->data, dicts[2 + i], "Oldest-first iteration is wrong");
+        i++;
+    }
+    NS_TEST_ASSERT_MSG_EQ(i, 4, "Wrong number of iterated entries");
+
+    std::vector<TimestampedData*> copied = ring.GetNewest(3);
+    NS_TEST_ASSERT_MSG_EQ(copied.size(), 3, "Conversion to vector is wrong");
+    NS_TEST_ASSERT_MSG_EQ(copied[2]->data, dicts[3], "Conversion to vector is wrong");
+
+    HistoryContainer container = HistoryContainer(2);
+    for (uint push = 0; push < 3; push++)
+    {
+        container.Push(dicts[push], 7);
+    }
+    auto newest = container.GetNewestByID(7, 5);
+    NS_TEST_ASSERT_MSG_EQ(newest.size(), 2, "View is not limited to the stored entries");
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestByID(7), newest[0], "Newest entry is not correct");
+    NS_TEST_ASSERT_MSG_EQ(newest[1]->data, dicts[1], "Second newest entry is not correct");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that the replay buffer files retain the newest records beyond the history length
+ */
+void
+HistoryContainerTest::TestReplayBuffer()
+{
+    HistoryContainer container = HistoryContainer(2);
+    container.Push(CreateObject<OpenGymDictContainer>(), 3);
+    NS_TEST_ASSERT_MSG_EQ(container.GetReplayBuffer(3), nullptr, "Replay buffer not requested");
+    container.DeleteHistory(3);
+    container.EnableReplayBuffer(CreateTempDirFilename(""), 5);
+
+    std::vector<uint32_t> shape = {2};
+    for (uint i = 0; i < 7; i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto floats = CreateObject<OpenGymBoxContainer<float>>(shape);
+        floats->SetData({float(i), -float(i)});
+        dict->Add("obs", floats);
+        auto counter = CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{1});
+        counter->AddValue(i * 10);
+        dict->Add("counter", counter);
+        container.Push(dict, 0);
+    }
+
+    ReplayBuffer* replay = container.GetReplayBuffer(0);
+    NS_TEST_ASSERT_MSG_NE(replay, nullptr, "Replay buffer was not created");
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 2, "History is not limited");
+    NS_TEST_ASSERT_MSG_EQ(replay->GetCount(), 7, "Not all records were appended");
+    NS_TEST_ASSERT_MSG_EQ(replay->GetSize(), 5, "Retention size is not respected");
+    NS_TEST_ASSERT_MSG_EQ(replay->GetFields().size(), 2, "Record layout is not correct");
+    for (uint i = 0; i < replay->GetSize(); i++)
+    {
+        const float* obs = replay->GetValues<float>(i, "obs");
+        const uint32_t* counter = replay->GetValues<uint32_t>(i, "counter");
+        NS_TEST_ASSERT_MSG_EQ(obs[0], i + 2, "Record values are not correct");
+        NS_TEST_ASSERT_MSG_EQ(obs[1], -float(i + 2), "Record values are not correct");
+        NS_TEST_ASSERT_MSG_EQ(counter[0], (i + 2) * 10, "Record values are not correct");
+        NS_TEST_ASSERT_MSG_EQ(replay->GetSequence(i), i + 3, "Sequence numbers are not correct");
+        NS_TEST_ASSERT_MSG_EQ(replay->GetTimestamp(i), -1, "Time is tracked but shouldn't be");
+    }
+    NS_TEST_ASSERT_MSG_EQ(replay->GetValues<double>(0, "obs"), nullptr, "Type is not checked");
+    NS_TEST_ASSERT_MSG_EQ(replay->GetValues<float>(0, "missing"), nullptr, "Key is not checked");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that histories of sparse and dense ids are found, iterated and deleted alike
+ */
+void
+HistoryContainerTest::TestSparseHistoryIds()
+{
+    HistoryContainer container = HistoryContainer(3);
+    std::vector<uint> ids = {0, 1, 100000, 2};
+    std::vector<Ptr<OpenGymDictContainer>> dicts;
+    for (uint id : ids)
+    {
+        dicts.push_back(CreateObject<OpenGymDictContainer>());
+        container.Push(dicts.back(), id);
+    }
+    container.Push(CreateObject<OpenGymDictContainer>(), 100000);
+
+    NS_TEST_ASSERT_MSG_EQ(container.HistoryExists(100000), true, "Sparse history is missing");
+    NS_TEST_ASSERT_MSG_EQ(container.HistoryExists(3), false, "History should not exist");
+    NS_TEST_ASSERT_MSG_EQ(container.HistoryExists(99999), false, "History should not exist");
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(100000), 2, "Sparse history has wrong size");
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(2), 1, "Dense history has wrong size");
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestByID(1)->data, dicts[1], "Wrong newest entry");
+    NS_TEST_ASSERT_MSG_EQ(container.GetSizeOfHistory(), 5, "Sizes are not summed up correctly");
+
+    auto combined = container.GetNewestOfCombinedHistory(5);
+    NS_TEST_ASSERT_MSG_EQ(combined.size(), 5, "Not all histories are merged");
+    NS_TEST_ASSERT_MSG_EQ(combined[1]->data, dicts[3], "Combined history is not ordered");
+    NS_TEST_ASSERT_MSG_EQ(combined[4]->data, dicts[0], "Combined history is not ordered");
+
+    container.DeleteHistory(100000);
+    container.DeleteHistory(1);
+    NS_TEST_ASSERT_MSG_EQ(container.HistoryExists(100000), false, "Sparse history not deleted");
+    NS_TEST_ASSERT_MSG_EQ(container.HistoryExists(1), false, "Dense history not deleted");
+    container.Push(dicts[1], 1);
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(1), 1, "Deleted history was not reset");
+    NS_TEST_ASSERT_MSG_EQ(container.GetSizeOfHistory(), 3, "Deleted history is still counted");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test interning dictionary keys and reading values by key id
+ */
+void
+HistoryContainerTest::TestKeyInterning()
+{
+    KeyId rsrp = KeyRegistry::Intern("internedRsrp");
+    NS_TEST_ASSERT_MSG_EQ(KeyRegistry::Intern("internedRsrp"), rsrp, "Key was interned twice");
+    NS_TEST_ASSERT_MSG_EQ(KeyRegistry::Find("internedRsrp"), rsrp, "Interned key not found");
+    NS_TEST_ASSERT_MSG_EQ(KeyRegistry::GetKey(rsrp), "internedRsrp", "Wrong key for id");
+    NS_TEST_ASSERT_MSG_EQ(KeyRegistry::Find("neverInterned"),
+                          KeyRegistry::INVALID,
+                          "Unknown key has an id");
+
+    HistoryContainer container = HistoryContainer(2, false, true);
+    container.AddAggregationWindow(2);
+    DictKeyCache keys;
+    for (int i = 0; i < 3; i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(i);
+        dict->Add("internedRsrp", box);
+        if (i == 2)
+        {
+            // a changed layout has to be resolved again
+            dict->Add("internedSinr", box);
+        }
+        const auto& entries = keys.Resolve(dict);
+        NS_TEST_ASSERT_MSG_EQ(entries.size(), i == 2 ? 2 : 1, "Wrong number of resolved keys");
+        NS_TEST_ASSERT_MSG_EQ(keys.Get(rsrp), box, "Resolved value is not correct");
+        container.Push(dict, 0);
+    }
+    KeyId sinr = KeyRegistry::Find("internedSinr");
+    NS_TEST_ASSERT_MSG_NE(sinr, KeyRegistry::INVALID, "New key was not interned");
+    NS_TEST_ASSERT_MSG_EQ(keys.Resolve(nullptr).empty(), true, "Empty dictionary has keys");
+    NS_TEST_ASSERT_MSG_EQ(keys.Get(rsrp), nullptr, "Values of the last dictionary are kept");
+
+    // resolving the same dictionary again returns the previous values
+    Ptr<OpenGymDictContainer> repeated = CreateObject<OpenGymDictContainer>();
+    auto repeatedBox = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+    repeated->Add("internedRsrp", repeatedBox);
+    keys.Resolve(repeated);
+    NS_TEST_ASSERT_MSG_EQ(keys.Resolve(repeated).size(), 1, "Repeated dictionary lost keys");
+    NS_TEST_ASSERT_MSG_EQ(keys.Get(rsrp), repeatedBox, "Repeated dictionary lost values");
+    keys.Resolve(nullptr);
+
+    NS_TEST_ASSERT_MSG_EQ(*container.GetNewestValues<float>(0, rsrp, 1), 1, "Wrong value by id");
+    NS_TEST_ASSERT_MSG_EQ(container.GetColumn(0, sinr),
+                          container.GetColumn(0, "internedSinr"),
+                          "Lookup by id and by string differ");
+    auto info = container.AggregateNewest(0, 2);
+    NS_TEST_ASSERT_MSG_EQ(info["internedRsrp"].GetAvg(), 1.5, "Window average is not correct");
+    NS_TEST_ASSERT_MSG_EQ(info["internedSinr"].GetAvg(), 2, "Window average is not correct");
+
+    // dictionaries built with interned keys are resolved without their key strings
+    auto interned = CreateObject<InternedDictContainer>();
+    auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+    box->AddValue(7);
+    interned->Add(sinr, box);
+    interned->Add("internedRsrp", box);
+    auto other = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+    NS_TEST_ASSERT_MSG_EQ(interned->Add(sinr, other), false, "Present key was added again");
+    const auto& entries = keys.Resolve(interned);
+    NS_TEST_ASSERT_MSG_EQ(entries.size(), 2, "Present key was recorded twice");
+    NS_TEST_ASSERT_MSG_EQ(interned->Get(sinr), box, "Present key lost its first value");
+    NS_TEST_ASSERT_MSG_EQ(entries[0].key, sinr, "Keys are not in the order they were added");
+    NS_TEST_ASSERT_MSG_EQ(keys.Get(rsrp), box, "Interned value is not resolved");
+    NS_TEST_ASSERT_MSG_EQ(interned->Get("internedRsrp"), box, "Value is missing in the dict");
+    NS_TEST_ASSERT_MSG_EQ(GetDictValue(interned, rsrp), box, "Interned lookup is not correct");
+    Ptr<OpenGymDictContainer> plain = CreateObject<OpenGymDictContainer>();
+    plain->Add("internedRsrp", box);
+    NS_TEST_ASSERT_MSG_EQ(GetDictValue(plain, rsrp), box, "String lookup is not correct");
+    NS_TEST_ASSERT_MSG_EQ(GetDictValue(plain, sinr), nullptr, "Missing key has a value");
+    container.Push(interned, 0);
+    NS_TEST_ASSERT_MSG_EQ(*container.GetNewestValues<float>(0, sinr), 7, "Wrong pushed value");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test which entries the history deques retain under each retention policy
+ */
+void
+HistoryContainerTest::TestRetentionPolicies()
+{
+    auto makeDict = [](float value) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(value);
+        dict->Add("value", box);
+        return dict;
+    };
+    auto valueOf = [](TimestampedData* entry) {
+        return DynamicCast<OpenGymBoxContainer<float>>(entry->data->Get("value"))->GetValue(0);
+    };
+
+    NS_TEST_ASSERT_MSG_EQ(HistoryContainer::ParseRetentionPolicy("Reservoir"),
+                          HistoryContainer::RESERVOIR,
+                          "Policy name is not parsed");
+
+    HistoryContainer decimated = HistoryContainer(4, false, true);
+    decimated.SetRetentionPolicy(HistoryContainer::DECIMATE, 3);
+    decimated.TrackQuantiles();
+    for (int i = 0; i < 12; i++)
+    {
+        decimated.Push(makeDict(i), 0);
+    }
+    auto kept = decimated.GetNewestByID(0, 4);
+    for (uint i = 0; i < kept.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(valueOf(kept[i]), 9 - 3 * i, "Wrong entry kept by decimation");
+    }
+    NS_TEST_ASSERT_MSG_EQ(decimated.AggregateHorizon(0)["value"].GetCount(),
+                          12,
+                          "Dropped entries are missing in the horizon");
+
+    HistoryContainer reservoir = HistoryContainer(5);
+    reservoir.SetRetentionPolicy(HistoryContainer::RESERVOIR);
+    reservoir.AddAggregationWindow(5);
+    for (int i = 0; i < 1000; i++)
+    {
+        reservoir.Push(makeDict(i), 0);
+    }
+    auto sample = reservoir.GetNewestByID(0, 5);
+    NS_TEST_ASSERT_MSG_EQ(sample.size(), 5, "Reservoir does not have a fixed size");
+    float sum = 0;
+    for (uint i = 0; i < sample.size(); i++)
+    {
+        sum += valueOf(sample[i]);
+        if (i > 0)
+        {
+            NS_TEST_ASSERT_MSG_GT(sample[i - 1]->sequence,
+                                  sample[i]->sequence,
+                                  "Reservoir is not ordered by push time");
+        }
+    }
+    NS_TEST_ASSERT_MSG_LT(valueOf(sample[4]), 900, "Reservoir does not cover the episode");
+    NS_TEST_ASSERT_MSG_EQ_TOL(reservoir.AggregateNewest(0, 5)["value"].GetAvg(),
+                              sum / 5,
+                              0.01,
+                              "Aggregation window was used for a reservoir");
+
+    HistoryContainer hybrid = HistoryContainer(3);
+    hybrid.SetRetentionPolicy(HistoryContainer::HYBRID, 4);
+    for (int i = 0; i < 100; i++)
+    {
+        hybrid.Push(makeDict(i), 0);
+    }
+    auto newest = hybrid.GetNewestByID(0, 3);
+    NS_TEST_ASSERT_MSG_EQ(valueOf(newest[2]), 97, "Newest entries are not kept in full");
+    auto older = hybrid.GetReservoir(0);
+    NS_TEST_ASSERT_MSG_EQ(older.size(), 4, "Sample of older entries has the wrong size");
+    for (uint i = 0; i < older.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_LT(valueOf(older[i]), 97, "Sample contains a newest entry");
+        if (i > 0)
+        {
+            NS_TEST_ASSERT_MSG_GT(older[i - 1]->sequence,
+                                  older[i]->sequence,
+                                  "Sample is not ordered by push time");
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(reservoir.GetReservoir(0).empty(), true, "Sample without hybrid policy");
+
+    // replacements shift the entries within the ring buffer, also across compressed blocks
+    for (uint keyframeInterval : {0, 4})
+    {
+        TimestampedDataDeque deque(6, true, keyframeInterval);
+        deque.EnablePriorities();
+        deque.EnableByteAccounting();
+        std::deque<float> expected;
+        for (int i = 0; i < 60; i++)
+        {
+            if (expected.size() == 6)
+            {
+                uint offset = (i * 7) % 6;
+                deque.Erase(offset);
+                expected.erase(expected.end() - 1 - offset);
+            }
+            deque.Push(TimestampedData(makeDict(i), false, false));
+            expected.push_back(i);
+            deque.SetPriority(0, i);
+        }
+        const HistoryColumn* column = deque.GetColumn("value");
+        for (uint offset = 0; offset < expected.size(); offset++)
+        {
+            float value = expected[expected.size() - 1 - offset];
+            NS_TEST_ASSERT_MSG_EQ(*column->GetRow<float>(deque.GetNewestSlot(offset)),
+                                  value,
+                                  "Shifted column row is not correct");
+            NS_TEST_ASSERT_MSG_EQ(valueOf(deque.GetNewestAt(offset)),
+                                  value,
+                                  "Shifted data entry is not correct");
+            NS_TEST_ASSERT_MSG_EQ(deque.GetPriority(offset), value, "Priority was not moved");
+        }
+        NS_TEST_ASSERT_MSG_EQ(deque.GetStoredBytes(),
+                              6 * deque.GetBytes(0),
+                              "Bytes of the erased entries are still counted");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that compressed histories restore the pushed values and dictionaries
+ */
+void
+HistoryContainerTest::TestCompressedHistory()
+{
+    HistoryContainer container = HistoryContainer(10);
+    container.EnableCompression(4);
+    container.AddAggregationWindow(3);
+    for (int i = 0; i < 25; i++)
+    {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto position = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1, 2});
+        position->AddValue(i * 0.5);
+        position->AddValue(-i);
+        dict->Add("compressedPosition", position);
+        auto constant = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{4});
+        for (int j = 0; j < 4; j++)
+        {
+            constant->AddValue(7.25);
+        }
+        dict->Add("compressedConstant", constant);
+        auto cell = CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{1});
+        cell->AddValue(i % 3);
+        dict->Add("compressedCell", cell);
+        container.Push(dict, 0);
+    }
+
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 10, "Compressed history has the wrong size");
+    const HistoryColumn* position = container.GetColumn(0, "compressedPosition");
+    NS_TEST_ASSERT_MSG_NE(position, nullptr, "No column for a float box");
+    NS_TEST_ASSERT_MSG_EQ(position->IsCompressed(), true, "Float column is not compressed");
+    for (uint offset = 0; offset < 10; offset++)
+    {
+        const float* values = container.GetNewestValues<float>(0, "compressedPosition", offset);
+        NS_TEST_ASSERT_MSG_EQ(values[0], (24 - offset) * 0.5f, "Wrong decompressed value");
+        NS_TEST_ASSERT_MSG_EQ(values[1], -(24.0f - offset), "Wrong decompressed value");
+    }
+
+    // dictionaries are restored from the columns on access
+    auto entries = container.GetNewestByID(0, 10);
+    NS_TEST_ASSERT_MSG_EQ(entries.size(), 10, "Wrong number of restored entries");
+    for (uint i = 0; i < entries.size(); i++)
+    {
+        auto restored =
+            DynamicCast<OpenGymBoxContainer<float>>(entries[i]->data->Get("compressedPosition"));
+        NS_TEST_ASSERT_MSG_NE(restored, nullptr, "Dictionary was not restored");
+        NS_TEST_ASSERT_MSG_EQ(restored->GetShape().size(), 2, "Shape was not restored");
+        NS_TEST_ASSERT_MSG_EQ(restored->GetData()[0], (24 - i) * 0.5f, "Wrong restored value");
+        auto cell =
+            DynamicCast<OpenGymBoxContainer<uint32_t>>(entries[i]->data->Get("compressedCell"));
+        NS_TEST_ASSERT_MSG_EQ(cell->GetData()[0], (24 - i) % 3, "Wrong restored value");
+    }
+    NS_TEST_ASSERT_MSG_EQ(container.GetNewestByID(0), entries[0], "Restored entry is not kept");
+    // reading does not inflate the history, only the last restored dictionary is kept
+    std::vector<TimestampedData*> pointers = entries;
+    NS_TEST_ASSERT_MSG_EQ(pointers[0]->data, nullptr, "Restored dictionary is kept in the slot");
+    NS_TEST_ASSERT_MSG_NE(pointers[9]->data, nullptr, "Last restored dictionary is dropped");
+    auto combined = container.GetNewestOfCombinedHistory(3);
+    for (uint i = 0; i < combined.size(); i++)
+    {
+        auto restored =
+            DynamicCast<OpenGymBoxContainer<float>>(combined[i]->data->Get("compressedPosition"));
+        NS_TEST_ASSERT_MSG_EQ(restored->GetValue(0), (24 - i) * 0.5f, "Wrong combined entry");
+    }
+
+    const HistoryColumn* constant = container.GetColumn(0, "compressedConstant");
+    NS_TEST_ASSERT_MSG_LT(constant->GetStorageSize(),
+                          16 * 4 * sizeof(float) / 2,
+                          "Constant values are not compressed");
+
+    auto info = container.AggregateNewest(0, 3);
+    NS_TEST_ASSERT_MSG_EQ_TOL(info["compressedPosition"].GetAvg(),
+                              -5.75,
+                              0.001,
+                              "Window average is not correct");
+    NS_TEST_ASSERT_MSG_EQ_TOL(info["compressedPosition"].GetMax(),
+                              12,
+                              0.001,
+                              "Window maximum is not correct");
+    info = container.AggregateNewest(0, 10);
+    NS_TEST_ASSERT_MSG_EQ_TOL(info["compressedConstant"].GetAvg(),
+                              7.25,
+                              0.001,
+                              "Average of decompressed values is not correct");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test aggregating single dictionary keys against aggregating whole entries
+ */
+void
+HistoryContainerTest::TestProjectionQueries()
+{
+    for (bool columnar : {false, true})
+    {
+        HistoryContainer container = HistoryContainer(8, false, columnar);
+        for (int i = 0; i < 12; i++)
+        {
+            auto dict = CreateObject<OpenGymDictContainer>();
+            auto rsrps = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{3});
+            auto rsrqs = CreateObject<OpenGymBoxContainer<double>>(std::vector<uint32_t>{3});
+            for (int cell = 0; cell < 3; cell++)
+            {
+                rsrps->AddValue(-100 + i + cell);
+                rsrqs->AddValue(-10 - i * cell);
+            }
+            dict->Add("projectedRsrps", rsrps);
+            dict->Add("projectedRsrqs", rsrqs);
+            if (i % 2 == 0)
+            {
+                auto cellId = CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{1});
+                cellId->AddValue(i);
+                dict->Add("projectedCellId", cellId);
+            }
+            container.Push(dict, 0);
+        }
+
+        auto all = container.AggregateNewest(0, 5);
+        for (const std::string key : {"projectedRsrps", "projectedRsrqs", "projectedCellId"})
+        {
+            auto projected = container.Aggregate(0, key, 5);
+            NS_TEST_ASSERT_MSG_EQ(projected.GetMin(), all[key].GetMin(), "Projected min differs");
+            NS_TEST_ASSERT_MSG_EQ(projected.GetMax(), all[key].GetMax(), "Projected max differs");
+            NS_TEST_ASSERT_MSG_EQ_TOL(projected.GetAvg(),
+                                      all[key].GetAvg(),
+                                      0.001,
+                                      "Projected average differs");
+        }
+        NS_TEST_ASSERT_MSG_EQ(container.Aggregate(0, "projectedCellId", 5).GetCount(),
+                              2,
+                              "Entries without the key are aggregated");
+
+        auto minimum = container.Aggregate(0, "projectedRsrps", 3, AggregatedInfo::MIN);
+        NS_TEST_ASSERT_MSG_EQ(minimum.GetMin(), -91, "Projected min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(minimum.GetCount(), 0, "Average was computed without request");
+        auto extremes = container.Aggregate(0,
+                                            KeyRegistry::Find("projectedRsrqs"),
+                                            3,
+                                            AggregatedInfo::MIN | AggregatedInfo::MAX);
+        NS_TEST_ASSERT_MSG_EQ(extremes.GetMin(), -32, "Projected min is not correct");
+        NS_TEST_ASSERT_MSG_EQ(extremes.GetMax(), -10, "Projected max is not correct");
+        NS_TEST_ASSERT_MSG_EQ(container.Aggregate(0, "neverPushed", 3).GetCount(),
+                              0,
+                              "Unknown key was aggregated");
+        NS_TEST_ASSERT_MSG_EQ(KeyRegistry::Find("neverPushed"),
+                              KeyRegistry::INVALID,
+                              "Unknown key was interned by a lookup");
+
+        container.AddAggregationWindow(4);
+        NS_TEST_ASSERT_MSG_EQ_TOL(container.Aggregate(0, "projectedRsrps", 4).GetAvg(),
+                                  container.AggregateNewest(0, 4)["projectedRsrps"].GetAvg(),
+                                  0.001,
+                                  "Window projection differs");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test reducing and stacking the newest entries of all history deques
+ */
+void
+HistoryContainerTest::TestCrossHistoryReduction()
+{
+    for (bool columnar : {false, true})
+    {
+        HistoryContainer container = HistoryContainer(4, false, columnar);
+        for (uint id : {200, 0, 1, 2, 3, 4})
+        {
+            for (int step = 0; step < 2; step++)
+            {
+                auto dict = CreateObject<OpenGymDictContainer>();
+                if (id == 3)
+                {
+                    auto box =
+                        CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{2});
+                    box->AddValue(id);
+                    box->AddValue(id * 2);
+                    dict->Add("stackedRsrp", box);
+                }
+                else if (id == 4)
+                {
+                    // rows with a different length are not stacked
+                    auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+                    box->AddValue(-1000);
+                    dict->Add("stackedRsrp", box);
+                }
+                else if (id != 2 || step == 0)
+                {
+                    auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{2});
+                    box->AddValue(id + step * 0.5);
+                    box->AddValue(id * 2 + step * 0.5);
+                    dict->Add("stackedRsrp", box);
+                }
+                container.Push(dict, id);
+            }
+        }
+
+        StackedRows stack = container.StackLatest("stackedRsrp");
+        NS_TEST_ASSERT_MSG_EQ(stack.rowLength, 2, "Wrong row length");
+        NS_TEST_ASSERT_MSG_EQ(stack.ids.size(), 4, "Wrong number of stacked histories");
+        NS_TEST_ASSERT_MSG_EQ(stack.values.size(), 8, "Buffer is not ids x rowLength");
+        std::vector<uint> expectedIds = {0, 1, 3, 200};
+        for (uint row = 0; row < stack.ids.size(); row++)
+        {
+            uint id = expectedIds[row];
+            float offset = id == 3 ? 0 : 0.5;
+            NS_TEST_ASSERT_MSG_EQ(stack.ids[row], id, "Rows are not ordered by id");
+            NS_TEST_ASSERT_MSG_EQ(stack.values[row * 2], id + offset, "Wrong stacked value");
+            NS_TEST_ASSERT_MSG_EQ(stack.values[row * 2 + 1],
+                                  id * 2 + offset,
+                                  "Wrong stacked value");
+        }
+        NS_TEST_ASSERT_MSG_EQ(stack.info.GetMax(), 400.5, "Stacked maximum is not correct");
+        NS_TEST_ASSERT_MSG_EQ(stack.info.GetCount(), 8, "Stacked count is not correct");
+
+        AggregatedInfo reduced = container.ReduceLatest("stackedRsrp");
+        NS_TEST_ASSERT_MSG_EQ(reduced.GetCount(), 9, "Reduced count is not correct");
+        NS_TEST_ASSERT_MSG_EQ(reduced.GetMin(), -1000, "Reduced minimum is not correct");
+        NS_TEST_ASSERT_MSG_EQ_TOL(reduced.GetSum(),
+                                  stack.info.GetSum() - 1000,
+                                  0.001,
+                                  "Reduced sum is not correct");
+
+        // the buffers of a previous result are reused
+        KeyId key = KeyRegistry::Intern("stackedRsrp");
+        container.StackLatest(key, stack);
+        NS_TEST_ASSERT_MSG_EQ(stack.ids.size(), 4, "Reused stack is not overwritten");
+        container.StackLatest(KeyRegistry::Find("neverPushed"), stack);
+        NS_TEST_ASSERT_MSG_EQ(stack.values.empty(), true, "Unknown key was stacked");
+
+        // looking up unknown keys by name does not intern them
+        NS_TEST_ASSERT_MSG_EQ(container.ReduceLatest("neverReduced").GetCount(),
+                              0,
+                              "Unknown key was reduced");
+        NS_TEST_ASSERT_MSG_EQ(container.StackLatest("neverReduced").ids.empty(),
+                              true,
+                              "Unknown key was stacked");
+        NS_TEST_ASSERT_MSG_EQ(container.GetFrameStack<float>(0, "neverReduced", 2),
+                              nullptr,
+                              "Unknown key has a frame stack");
+        NS_TEST_ASSERT_MSG_EQ(KeyRegistry::Find("neverReduced"),
+                              KeyRegistry::INVALID,
+                              "Unknown key was interned by a lookup");
+    }
+
+    // ids stored sparsely before the dense range grew past them still come out in order
+    for (const std::vector<uint>& order :
+         {std::vector<uint>{1000, 5}, std::vector<uint>{100, 110}})
+    {
+        HistoryContainer container = HistoryContainer(1);
+        auto push = [&container](uint id) {
+            auto dict = CreateObject<OpenGymDictContainer>();
+            auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+            box->AddValue(id);
+            dict->Add("stackedRsrp", box);
+            container.Push(dict, id);
+        };
+        push(order[0]);
+        for (uint id = 10; id < 70; id++)
+        {
+            push(id);
+        }
+        push(order[1]);
+        StackedRows stack = container.StackLatest("stackedRsrp");
+        NS_TEST_ASSERT_MSG_EQ(stack.ids.size(), 62, "Wrong number of stacked histories");
+        NS_TEST_ASSERT_MSG_EQ(std::is_sorted(stack.ids.begin(), stack.ids.end()),
+                              true,
+                              "Rows are not ordered by id");
+        NS_TEST_ASSERT_MSG_EQ(std::adjacent_find(stack.ids.begin(), stack.ids.end()) ==
+                                  stack.ids.end(),
+                              true,
+                              "Rows are repeated");
+        for (uint row = 0; row < stack.ids.size(); row++)
+        {
+            NS_TEST_ASSERT_MSG_EQ(stack.values[row], stack.ids[row], "Row of the wrong history");
+        }
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test joining observations and rewards into transitions by simulation time
+ */
+void
+HistoryContainerTest::TestTransitionBuilder()
+{
+    std::vector<Ptr<OpenGymDictContainer>> dicts;
+    for (int i = 0; i < 8; i++)
+    {
+        dicts.push_back(CreateObject<OpenGymDictContainer>());
+    }
+
+    TransitionBuilder builder(2);
+    builder.MapReward(7, 1);
+    builder.AddReward(0, dicts[0], MilliSeconds(5));
+    NS_TEST_ASSERT_MSG_EQ(builder.GetDroppedRewardCount(), 1, "Reward without observation kept");
+    builder.AddObservation(0, dicts[1], MilliSeconds(10));
+    builder.AddObservation(1, dicts[2], MilliSeconds(10));
+    builder.AddReward(0, dicts[3], MilliSeconds(12));
+    builder.AddReward(7, dicts[4], MilliSeconds(15));
+    builder.AddReward(0, dicts[5], MilliSeconds(20));
+    NS_TEST_ASSERT_MSG_EQ(builder.GetTransitionCount(), 0, "Transition without next observation");
+
+    // the reward at 20 ms is aligned with the observation at 20 ms
+    builder.AddObservation(0, dicts[6], MilliSeconds(20));
+    auto transitions = builder.TakeTransitions();
+    NS_TEST_ASSERT_MSG_EQ(transitions.size(), 1, "Wrong number of transitions");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].observation, dicts[1], "Wrong preceding observation");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].reward, dicts[3], "Wrong reward");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].nextObservation, dicts[6], "Wrong next observation");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].rewardTime, MilliSeconds(12), "Wrong reward time");
+    NS_TEST_ASSERT_MSG_EQ(builder.GetTransitionCount(), 0, "Transitions were not taken");
+
+    builder.AddObservation(0, dicts[7], MilliSeconds(30));
+    builder.AddObservation(1, dicts[7], MilliSeconds(30));
+    transitions = builder.TakeTransitions();
+    NS_TEST_ASSERT_MSG_EQ(transitions.size(), 2, "Wrong number of transitions");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].observation, dicts[6], "Wrong preceding observation");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].reward, dicts[5], "Wrong reward");
+    NS_TEST_ASSERT_MSG_EQ(transitions[1].id, 1, "Mapped reward is not joined by id");
+    NS_TEST_ASSERT_MSG_EQ(transitions[1].observation, dicts[2], "Wrong preceding observation");
+
+    builder.AddReward(0, dicts[0], MilliSeconds(25));
+    NS_TEST_ASSERT_MSG_EQ(builder.GetDroppedRewardCount(), 2, "Outdated reward was kept");
+    for (int i = 0; i < 3; i++)
+    {
+        builder.AddReward(0, dicts[i], MilliSeconds(31 + i));
+    }
+    builder.AddObservation(0, dicts[3], MilliSeconds(40));
+    transitions = builder.TakeTransitions();
+    NS_TEST_ASSERT_MSG_EQ(transitions.size(), 2, "Transition buffer is not bounded");
+    NS_TEST_ASSERT_MSG_EQ(transitions[0].reward, dicts[1], "Oldest transition was not dropped");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test n-step returns and advantages of the ReturnsCalculator against a direct computation
+ */
+void
+HistoryContainerTest::TestReturnsCalculator()
+{
+    double gamma = 0.9;
+    double lambda = 0.8;
+    std::vector<float> rewards = {1, 0, 2, -1, 3, 0.5, 1};
+    std::vector<float> values = {0.5, 1, 1.5, 0.2, 2, 1, 0.7};
+
+    // reference: a single rollout of the first 6 steps, bootstrapped from the value of step 6
+    uint count = 6;
+    ReturnsCalculator calculator(gamma, lambda, 3, count);
+    for (uint t = 0; t < rewards.size(); t++)
+    {
+        calculator.Push(4, rewards[t], values[t]);
+        calculator.Push(5, 1, 0, t == 1);
+    }
+    NS_TEST_ASSERT_MSG_EQ(calculator.GetPendingCount(4), 1, "Full rollout was not processed");
+
+    ReturnsCalculator::Batch batch;
+    calculator.TakeBatch(batch);
+    NS_TEST_ASSERT_MSG_EQ(calculator.GetBatch().Size(), 0, "Batch was not taken");
+    std::vector<uint> rows;
+    for (uint i = 0; i < batch.Size(); i++)
+    {
+        if (batch.ids[i] == 4)
+        {
+            rows.push_back(i);
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(rows.size(), count, "Wrong number of processed steps");
+    for (uint t = 0; t < count; t++)
+    {
+        double expectedReturn = 0;
+        uint m = std::min<uint>(3, count - t);
+        for (uint k = 0; k < m; k++)
+        {
+            expectedReturn += std::pow(gamma, k) * rewards[t + k];
+        }
+        expectedReturn += std::pow(gamma, m) * values[t + m];
+        double expectedAdvantage = 0;
+        for (uint k = t; k < count; k++)
+        {
+            double delta = rewards[k] + gamma * values[k + 1] - values[k];
+            expectedAdvantage += std::pow(gamma * lambda, k - t) * delta;
+        }
+        uint row = rows[t];
+        NS_TEST_ASSERT_MSG_EQ(batch.steps[row], t, "Steps are not numbered per agent");
+        NS_TEST_ASSERT_MSG_EQ_TOL(batch.returns[row], expectedReturn, 1e-5, "Wrong n-step return");
+        NS_TEST_ASSERT_MSG_EQ_TOL(batch.advantages[row],
+                                  expectedAdvantage,
+                                  1e-5,
+                                  "Wrong advantage");
+        NS_TEST_ASSERT_MSG_EQ_TOL(batch.lambdaReturns[row],
+                                  expectedAdvantage + values[t],
+                                  1e-5,
+                                  "Wrong lambda return");
+    }
+
+    // a terminal step does not bootstrap
+    NS_TEST_ASSERT_MSG_EQ(batch.ids[0], 5, "Terminal step was not processed immediately");
+    NS_TEST_ASSERT_MSG_EQ_TOL(batch.returns[0], 1 + gamma, 1e-5, "Terminal return bootstraps");
+    NS_TEST_ASSERT_MSG_EQ_TOL(batch.returns[1], 1, 1e-5, "Terminal return bootstraps");
+
+    calculator.Finish(4, 2);
+    NS_TEST_ASSERT_MSG_EQ(calculator.GetPendingCount(4), 0, "Finished steps are pending");
+    const auto& finished = calculator.GetBatch();
+    NS_TEST_ASSERT_MSG_EQ(finished.steps.back(), 6, "Finished step has the wrong index");
+    NS_TEST_ASSERT_MSG_EQ_TOL(finished.returns.back(),
+                              rewards[6] + gamma * 2,
+                              1e-5,
+                              "Finished return is not bootstrapped");
+
+    // a container feeds every pushed reward, including the ones its retention policy drops
+    HistoryContainer container = HistoryContainer(2);
+    container.SetRetentionPolicy(HistoryContainer::DECIMATE, 2);
+    NS_TEST_ASSERT_MSG_EQ(container.GetReturnsCalculator(), nullptr, "Returns are not disabled");
+    container.EnableReturns("returnsReward", 0.5, 0.95, 2, 8, "", "returnsDone");
+    auto makeReward = [](float reward, bool done) {
+        auto dict = CreateObject<InternedDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(reward);
+        dict->Add("returnsReward", box);
+        auto flag = CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{1});
+        flag->AddValue(done);
+        dict->Add("returnsDone", flag);
+        return dict;
+    };
+    container.Push(makeReward(1, false), 3);
+    container.Push(CreateObject<OpenGymDictContainer>(), 3);
+    container.Push(makeReward(2, false), 3);
+    container.Push(makeReward(4, true), 3);
+    ReturnsCalculator::Batch returns;
+    container.GetReturnsCalculator()->TakeBatch(returns);
+    NS_TEST_ASSERT_MSG_EQ(returns.Size(), 3, "Pushed rewards were not fed");
+    NS_TEST_ASSERT_MSG_EQ(returns.ids[0], 3, "History ID is not the agent ID");
+    NS_TEST_ASSERT_MSG_EQ_TOL(returns.returns[0], 2, 1e-5, "Wrong return of a pushed reward");
+    NS_TEST_ASSERT_MSG_EQ_TOL(returns.returns[1], 4, 1e-5, "Wrong return of a dropped reward");
+    NS_TEST_ASSERT_MSG_EQ_TOL(returns.returns[2], 4, 1e-5, "Wrong return of the last reward");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test padding, contiguity and values of the frame stacks of a history deque
+ */
+void
+HistoryContainerTest::TestFrameStacking()
+{
+    auto reset = CreateObject<OpenGymDictContainer>();
+    auto resetPosition = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{2});
+    resetPosition->AddValue(-1);
+    resetPosition->AddValue(-1);
+    reset->Add("stackedPosition", resetPosition);
+
+    HistoryContainer container = HistoryContainer(5);
+    container.EnableFrameStacking(3, reset);
+    auto push = [&container](int i) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto position = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{2});
+        position->AddValue(i);
+        position->AddValue(10 * i);
+        dict->Add("stackedPosition", position);
+        auto cell = CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{1});
+        cell->AddValue(i + 1);
+        dict->Add("stackedCell", cell);
+        container.Push(dict, 0);
+    };
+
+    // short histories are padded with the reset observation, or zeros without one
+    push(0);
+    const float* stack = container.GetFrameStack<float>(0, "stackedPosition", 3);
+    NS_TEST_ASSERT_MSG_NE(stack, nullptr, "No frame stack for a float box");
+    std::vector<float> expected{-1, -1, -1, -1, 0, 0};
+    for (uint i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(stack[i], expected[i], "Short frame stack is not padded");
+    }
+    NS_TEST_ASSERT_MSG_EQ(stack + 4,
+                          container.GetNewestValues<float>(0, "stackedPosition"),
+                          "Padded frame stack was copied");
+    const uint32_t* cells = container.GetFrameStack<uint32_t>(0, "stackedCell", 3);
+    NS_TEST_ASSERT_MSG_EQ(cells[0], 0, "Missing padding is not zero");
+    NS_TEST_ASSERT_MSG_EQ(cells[2], 1, "Wrong newest frame");
+    NS_TEST_ASSERT_MSG_EQ(container.GetFrameStack<double>(0, "stackedPosition", 3),
+                          nullptr,
+                          "Frame stack of the wrong element type");
+
+    // after the ring buffer wrapped around, the stack continues in the mirrored rows
+    for (int i = 1; i < 7; i++)
+    {
+        push(i);
+    }
+    stack = container.GetFrameStack<float>(0, "stackedPosition", 3);
+    expected = {4, 40, 5, 50, 6, 60};
+    for (uint i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(stack[i], expected[i], "Wrapped frame stack is not correct");
+    }
+    NS_TEST_ASSERT_MSG_EQ(stack,
+                          container.GetNewestValues<float>(0, "stackedPosition", 2),
+                          "Wrapped frame stack was copied");
+
+    // deeper stacks are copied
+    stack = container.GetFrameStack<float>(0, "stackedPosition", 5);
+    for (uint i = 0; i < 5; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(stack[2 * i], i + 2, "Copied frame stack is not correct");
+        NS_TEST_ASSERT_MSG_EQ(stack[2 * i + 1], 10 * (i + 2), "Copied frame stack is not correct");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that history tiers aggregate trends over simulation time beyond the stored entries
+ */
+void
+HistoryContainerTest::TestHistoryTiers()
+{
+    HistoryContainer container = HistoryContainer(4);
+    container.AddTier(Seconds(10), 6);
+    container.AddTier(Seconds(1), 10);
+    // one entry every 250 ms for a minute, only the last 4 are stored raw
+    for (uint i = 0; i < 240; i++)
+    {
+        Simulator::Schedule(MilliSeconds(250 * i), [&container, i]() {
+            auto dict = CreateObject<OpenGymDictContainer>();
+            auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+            box->AddValue(i);
+            dict->Add("tierLoad", box);
+            container.Push(dict, 0);
+        });
+    }
+    Simulator::Run();
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 4, "Tiers changed the stored entries");
+
+    // the last 5 s are read from the 1 s buckets 54 to 59
+    auto recent = container.AggregateTrend(0, Seconds(5))["tierLoad"];
+    NS_TEST_ASSERT_MSG_EQ(recent.GetCount(), 24, "Wrong number of values in the fine tier");
+    NS_TEST_ASSERT_MSG_EQ(recent.GetMin(), 216, "Wrong minimum of the fine tier");
+    NS_TEST_ASSERT_MSG_EQ(recent.GetMax(), 239, "Wrong maximum of the fine tier");
+    NS_TEST_ASSERT_MSG_EQ_TOL(recent.GetAvg(), 227.5, 0.001, "Wrong average of the fine tier");
+
+    // the last 30 s exceed the fine tier and are read from the 10 s buckets 2 to 5
+    KeyId key = KeyRegistry::Intern("tierLoad");
+    auto trend = container.AggregateTrend(0, key, Seconds(30));
+    NS_TEST_ASSERT_MSG_EQ(trend.GetMin(), 80, "Wrong minimum of the coarse tier");
+    NS_TEST_ASSERT_MSG_EQ(trend.GetMax(), 239, "Wrong maximum of the coarse tier");
+
+    // spans beyond all tiers are limited to the coarsest one
+    auto all = container.AggregateTrend(0, Seconds(600))["tierLoad"];
+    NS_TEST_ASSERT_MSG_EQ(all.GetCount(), 240, "Coarsest tier does not hold all values");
+    NS_TEST_ASSERT_MSG_EQ_TOL(all.GetAvg(), 119.5, 0.001, "Wrong average of the coarse tier");
+
+    auto buckets = container.GetTierBuckets(0, 0);
+    NS_TEST_ASSERT_MSG_EQ(buckets.size(), 10, "Wrong number of fine buckets");
+    NS_TEST_ASSERT_MSG_EQ(buckets[0].start, Seconds(50), "Fine buckets are not oldest first");
+    NS_TEST_ASSERT_MSG_EQ(buckets[0].info["tierLoad"].GetMin(), 200, "Wrong bucket minimum");
+    NS_TEST_ASSERT_MSG_EQ(buckets[9].info["tierLoad"].GetMax(), 239, "Wrong bucket maximum");
+    NS_TEST_ASSERT_MSG_EQ(container.GetTierBuckets(0, 1).size(),
+                          6,
+                          "Wrong number of coarse buckets");
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test the SumTree and prioritized sampling of data entries across history deques
+ */
+void
+HistoryContainerTest::TestPrioritizedSampling()
+{
+    SumTree tree(5);
+    std::vector<double> priorities = {1, 0, 3, 0, 4};
+    for (uint i = 0; i < priorities.size(); i++)
+    {
+        tree.Set(i, priorities[i]);
+    }
+    NS_TEST_ASSERT_MSG_EQ(tree.GetTotal(), 8, "Wrong total priority");
+    double prefix = 0.5;
+    NS_TEST_ASSERT_MSG_EQ(tree.Find(prefix), 0, "Wrong element at prefix 0.5");
+    NS_TEST_ASSERT_MSG_EQ(prefix, 0.5, "Wrong remainder within the element");
+    prefix = 1;
+    NS_TEST_ASSERT_MSG_EQ(tree.Find(prefix), 2, "Element without priority found");
+    prefix = 3.5;
+    NS_TEST_ASSERT_MSG_EQ(tree.Find(prefix), 2, "Wrong element at prefix 3.5");
+    NS_TEST_ASSERT_MSG_EQ(prefix, 2.5, "Wrong remainder within the element");
+    prefix = 8;
+    NS_TEST_ASSERT_MSG_EQ(tree.Find(prefix), 4, "Prefix at the total is not the last element");
+    tree.Resize(3);
+    NS_TEST_ASSERT_MSG_EQ(tree.GetTotal(), 4, "Resizing did not drop the last elements");
+
+    HistoryContainer container = HistoryContainer(4);
+    container.EnablePrioritizedSampling();
+    auto push = [&container](uint id, float value) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(value);
+        dict->Add("priorityValue", box);
+        container.Push(dict, id);
+    };
+    for (uint i = 0; i < 6; i++)
+    {
+        push(0, i);
+    }
+    push(7, 10);
+    push(7, 11);
+    NS_TEST_ASSERT_MSG_EQ(container.GetPriority(0, 3), 1, "New entries have the wrong priority");
+
+    // only the entry with value 2 of history 0 keeps a priority there
+    container.SetPriority(0, 3, 10);
+    for (uint offset = 0; offset < 3; offset++)
+    {
+        container.SetPriority(0, offset, 0);
+    }
+    auto samples = container.SamplePrioritized(1200);
+    NS_TEST_ASSERT_MSG_EQ(samples.size(), 1200, "Wrong number of samples");
+    uint drawn = 0;
+    for (const auto& sample : samples)
+    {
+        if (sample.id == 0)
+        {
+            NS_TEST_ASSERT_MSG_EQ(sample.offset, 3, "Entry without priority drawn");
+            NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(sample.data->data, "priorityValue")->GetValue(0),
+                                  2,
+                                  "Sample points to the wrong entry");
+            NS_TEST_ASSERT_MSG_EQ_TOL(sample.probability, 10.0 / 12, 1e-9, "Wrong probability");
+            drawn++;
+        }
+    }
+    // stratified sampling draws each entry in proportion to its priority up to one sample
+    NS_TEST_ASSERT_MSG_EQ_TOL(drawn, 1000, 1, "Entries are not drawn by priority");
+
+    // new entries get the largest priority of their history, evicted ones lose theirs
+    push(0, 6);
+    NS_TEST_ASSERT_MSG_EQ(container.GetPriority(0, 0), 10, "New entry has the wrong priority");
+    samples = container.SamplePrioritized(0, 3);
+    NS_TEST_ASSERT_MSG_EQ(samples.size(), 3, "Wrong number of samples of one history");
+    for (const auto& sample : samples)
+    {
+        NS_TEST_ASSERT_MSG_EQ(sample.offset, 0, "Evicted entry kept its priority");
+        NS_TEST_ASSERT_MSG_EQ(sample.probability, 1, "Wrong probability within one history");
+    }
+
+    container.DeleteHistory(0);
+    for (const auto& sample : container.SamplePrioritized(10))
+    {
+        NS_TEST_ASSERT_MSG_EQ(sample.id, 7, "Deleted history was drawn");
+    }
+
+    // histories created after deletions reuse the freed indices of the tree
+    for (uint id = 100; id < 150; id++)
+    {
+        push(id, id);
+        if (id < 149)
+        {
+            container.DeleteHistory(id);
+        }
+    }
+    uint drawnNew = 0;
+    for (const auto& sample : container.SamplePrioritized(100))
+    {
+        NS_TEST_ASSERT_MSG_EQ(sample.id == 7 || sample.id == 149, true, "Deleted history drawn");
+        if (sample.id == 149)
+        {
+            NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(sample.data->data, "priorityValue")->GetValue(0),
+                                  149,
+                                  "Reused index points to the wrong history");
+            drawnNew++;
+        }
+    }
+    NS_TEST_ASSERT_MSG_GT(drawnNew, 0, "History with a reused index is not drawn");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that boxes of all integer and floating-point element types are dispatched and
+ * aggregated
+ */
+void
+HistoryContainerTest::TestBoxDtypes()
+{
+    auto dict = CreateObject<OpenGymDictContainer>();
+    auto addBox = [&dict](const std::string& key, auto box) {
+        box->AddValue(-3);
+        box->AddValue(5);
+        box->AddValue(7);
+        dict->Add(key, box);
+    };
+    addBox("int8", CreateObject<OpenGymBoxContainer<int8_t>>());
+    addBox("int16", CreateObject<OpenGymBoxContainer<int16_t>>());
+    addBox("int32", CreateObject<OpenGymBoxContainer<int32_t>>());
+    addBox("int64", CreateObject<OpenGymBoxContainer<int64_t>>());
+    addBox("uint8", CreateObject<OpenGymBoxContainer<uint8_t>>());
+    addBox("uint16", CreateObject<OpenGymBoxContainer<uint16_t>>());
+    addBox("uint32", CreateObject<OpenGymBoxContainer<uint32_t>>());
+    addBox("uint64", CreateObject<OpenGymBoxContainer<uint64_t>>());
+    addBox("float", CreateObject<OpenGymBoxContainer<float>>());
+    // boxes created without CreateObject are dispatched as well
+    addBox("double", Create<OpenGymBoxContainer<double>>());
+
+    std::map<std::string, BoxDtype> dtypes = {{"int8", BoxDtype::INT8},
+                                              {"int16", BoxDtype::INT16},
+                                              {"int32", BoxDtype::INT32},
+                                              {"int64", BoxDtype::INT64},
+                                              {"uint8", BoxDtype::UINT8},
+                                              {"uint16", BoxDtype::UINT16},
+                                              {"uint32", BoxDtype::UINT32},
+                                              {"uint64", BoxDtype::UINT64},
+                                              {"float", BoxDtype::FLOAT},
+                                              {"double", BoxDtype::DOUBLE}};
+    for (const auto& [key, dtype] : dtypes)
+    {
+        NS_TEST_ASSERT_MSG_EQ((GetBoxDtype(dict->Get(key)) == dtype),
+                              true,
+                              "Wrong element type of " << key);
+    }
+    NS_TEST_ASSERT_MSG_EQ((GetBoxDtype(dict) == BoxDtype::NONE), true, "A dict is not a box");
+    NS_TEST_ASSERT_MSG_EQ((GetBoxDtype(nullptr) == BoxDtype::NONE), true, "Null is not a box");
+
+    // only int32 and the other column types are stored in columns, the rest is read from the dict
+    for (bool columnar : {false, true})
+    {
+        HistoryContainer container = HistoryContainer(2, false, columnar);
+        container.Push(dict, 0);
+        container.Push(dict, 0);
+        auto info = container.AggregateNewest(0, 2);
+        for (const auto& [key, dtype] : dtypes)
+        {
+            // the unsigned boxes hold -3 wrapped around
+            double min = key[0] == 'u' ? 5 : -3;
+            NS_TEST_ASSERT_MSG_EQ(info[key].GetMin(), min, "Wrong minimum of " << key);
+            NS_TEST_ASSERT_MSG_EQ(container.Aggregate(0, key, 2).GetMax() >= 7,
+                                  true,
+                                  "Wrong maximum of " << key);
+        }
+        NS_TEST_ASSERT_MSG_EQ_TOL(info["int64"].GetAvg(), 3, 0.001, "Wrong average of int64");
+        NS_TEST_ASSERT_MSG_EQ(container.ReduceLatest("int8").GetMin(), -3, "Wrong int8 reduction");
+        if (columnar)
+        {
+            NS_TEST_ASSERT_MSG_NE(container.GetColumn(0, "int32"), nullptr, "No int32 column");
+            NS_TEST_ASSERT_MSG_EQ(container.GetColumn(0, "int16"),
+                                  nullptr,
+                                  "int16 boxes are not kept in the dictionaries");
+        }
+        std::ostringstream printed;
+        container.PrintHistory(printed, 0);
+        NS_TEST_ASSERT_MSG_EQ(printed.str().empty(), false, "History was not printed");
+    }
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test the byte accounting of HistoryContainers and the eviction policies of a shared
+ * MemoryBudget
+ */
+void
+HistoryContainerTest::TestMemoryBudget()
+{
+    auto entry = [](float value) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(value);
+        dict->Add("budgetValue", box);
+        return dict;
+    };
+    uint64_t bytes = GetContainerSize(entry(0));
+    NS_TEST_ASSERT_MSG_GT(bytes, sizeof(float), "Entry size does not include its objects");
+
+    // the oldest entry across both containers is evicted first
+    auto budget = CreateObject<MemoryBudget>();
+    budget->SetLimit(5 * bytes);
+    {
+        HistoryContainer first = HistoryContainer(10);
+        HistoryContainer second = HistoryContainer(10);
+        first.SetMemoryBudget(budget);
+        second.SetMemoryBudget(budget);
+        first.AddAggregationWindow(3);
+        for (uint i = 1; i <= 3; i++)
+        {
+            first.Push(entry(i), 0);
+        }
+        NS_TEST_ASSERT_MSG_EQ(first.GetStoredBytes(), 3 * bytes, "Wrong stored bytes");
+        for (uint i = 4; i <= 6; i++)
+        {
+            second.Push(entry(i), 0);
+        }
+        NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(), 5 * bytes, "Usage exceeds the limit");
+        NS_TEST_ASSERT_MSG_EQ(budget->GetEvictedCount(), 1, "Wrong number of evicted entries");
+        NS_TEST_ASSERT_MSG_EQ(first.GetSize(0), 2, "Oldest entry was not evicted");
+        NS_TEST_ASSERT_MSG_EQ(second.GetSize(0), 3, "Newer entries were evicted");
+        // the window of three entries must not hold the evicted one anymore
+        NS_TEST_ASSERT_MSG_EQ(first.AggregateNewest(0, 3)["budgetValue"].GetMin(),
+                              2,
+                              "Window still holds the evicted entry");
+        NS_TEST_ASSERT_MSG_EQ(first.GetNewestOfCombinedHistory()->data,
+                              first.GetNewestByID(0)->data,
+                              "Combined history is out of order");
+
+        // the newest entry of every history is kept, even if it exceeds the limit
+        budget->SetLimit(1);
+        NS_TEST_ASSERT_MSG_EQ(first.GetSize(0), 1, "Newest entry was evicted");
+        NS_TEST_ASSERT_MSG_EQ(second.GetSize(0), 1, "Newest entry was evicted");
+        NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(), 2 * bytes, "Wrong usage of the newest entries");
+        NS_TEST_ASSERT_MSG_EQ(ExtractFloatBox(second.GetNewestByID(0)->data, "budgetValue")
+                                  ->GetValue(0),
+                              6,
+                              "Wrong entry kept");
+    }
+    NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(), 0, "Destroyed containers were not released");
+
+    // the history pushed to least recently gives up its older entries first
+    budget = CreateObject<MemoryBudget>();
+    budget->SetEvictionPolicy(MemoryBudget::ParseEvictionPolicy("LruHistory"));
+    budget->SetLimit(4 * bytes);
+    HistoryContainer lru = HistoryContainer(10);
+    lru.SetMemoryBudget(budget);
+    for (uint id : {0, 0, 1, 1, 2})
+    {
+        lru.Push(entry(id), id);
+    }
+    NS_TEST_ASSERT_MSG_EQ(lru.GetSize(0), 1, "Least recently used history was not evicted");
+    NS_TEST_ASSERT_MSG_EQ(lru.GetSize(1), 2, "Recently used history was evicted");
+    lru.Push(entry(2), 2);
+    NS_TEST_ASSERT_MSG_EQ(lru.GetSize(1), 1, "Next least recently used history was not evicted");
+    NS_TEST_ASSERT_MSG_EQ(lru.GetSize(2), 2, "Most recently used history was evicted");
+    lru.DeleteHistory(2);
+    NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(), 2 * bytes, "Deleted history was not released");
+
+    // every history gives up entries in proportion to the bytes it could evict
+    budget = CreateObject<MemoryBudget>();
+    budget->SetEvictionPolicy(MemoryBudget::PROPORTIONAL);
+    HistoryContainer proportional = HistoryContainer(10, false, true);
+    proportional.SetMemoryBudget(budget);
+    for (uint i = 0; i < 6; i++)
+    {
+        proportional.Push(entry(i), 0);
+    }
+    proportional.Push(entry(0), 1);
+    proportional.Push(entry(1), 1);
+    NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(), 8 * bytes, "Wrong usage without a limit");
+    budget->SetLimit(4 * bytes);
+    NS_TEST_ASSERT_MSG_EQ(proportional.GetSize(0), 2, "Wrong share of the larger history");
+    NS_TEST_ASSERT_MSG_EQ(proportional.GetSize(1), 1, "Wrong share of the smaller history");
+    NS_TEST_ASSERT_MSG_EQ(*proportional.GetNewestValues<float>(0, "budgetValue", 1),
+                          4,
+                          "Columns do not hold the remaining entries");
+
+    // a small excess is not taken from every history
+    budget = CreateObject<MemoryBudget>();
+    budget->SetEvictionPolicy(MemoryBudget::PROPORTIONAL);
+    HistoryContainer slightlyOver = HistoryContainer(10);
+    slightlyOver.SetMemoryBudget(budget);
+    for (uint i = 0; i < 6; i++)
+    {
+        slightlyOver.Push(entry(i), 0);
+    }
+    slightlyOver.Push(entry(0), 1);
+    slightlyOver.Push(entry(1), 1);
+    budget->SetLimit(8 * bytes - 1);
+    NS_TEST_ASSERT_MSG_EQ(slightlyOver.GetSize(0), 5, "Largest share was not evicted");
+    NS_TEST_ASSERT_MSG_EQ(slightlyOver.GetSize(1), 2, "History without a share was evicted");
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that data entries older than the time to live are dropped on push and on query
+ */
+void
+HistoryContainerTest::TestTimeToLive()
+{
+    HistoryContainer container = HistoryContainer(5);
+    container.SetTimeToLive(Seconds(1));
+    container.AddAggregationWindow(3);
+    auto budget = CreateObject<MemoryBudget>();
+    container.SetMemoryBudget(budget);
+    auto push = [&container](uint id, float value) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(value);
+        dict->Add("ttlValue", box);
+        container.Push(dict, id);
+    };
+
+    // irregular arrivals: three entries within 400 ms, then a gap
+    std::vector<std::pair<Time, float>> arrivals = {{MilliSeconds(0), 0},
+                                                     {MilliSeconds(200), 1},
+                                                     {MilliSeconds(400), 2},
+                                                     {MilliSeconds(1300), 3}};
+    for (const auto& [time, value] : arrivals)
+    {
+        Simulator::Schedule(time, push, 0, value);
+    }
+    Simulator::Schedule(MilliSeconds(100), push, 1, 10);
+    Simulator::Schedule(MilliSeconds(500), [this, &container]() {
+        NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 3, "Entries expired too early");
+        NS_TEST_ASSERT_MSG_EQ(container.AggregateNewest(0, 3)["ttlValue"].GetMin(),
+                              0,
+                              "Wrong window before expiry");
+    });
+    Simulator::Schedule(MilliSeconds(1300), [this, &container]() {
+        // the push at 1.3 s dropped the entries of 0 ms and 200 ms
+        NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 2, "Expired entries were not dropped on push");
+        NS_TEST_ASSERT_MSG_EQ(container.AggregateNewest(0, 3)["ttlValue"].GetMin(),
+                              2,
+                              "Window still holds expired entries");
+        NS_TEST_ASSERT_MSG_EQ(container.GetNewestByID(0)->GetNs3Time(),
+                              MilliSeconds(1300),
+                              "Time to live does not track the simulation time");
+    });
+    Simulator::Schedule(MilliSeconds(1500), [this, &container, budget]() {
+        // no push since 100 ms to history 1, its entry is dropped by the query
+        NS_TEST_ASSERT_MSG_EQ(container.GetSizeOfHistory(),
+                              1,
+                              "Expired entries were not dropped on query");
+        NS_TEST_ASSERT_MSG_EQ(container.GetSize(1), 0, "Expired history is not empty");
+        NS_TEST_ASSERT_MSG_EQ(budget->GetUsage(),
+                              container.GetStoredBytes(),
+                              "Expired entries were not released from the memory budget");
+    });
+    // the count cap still applies to entries within the time to live
+    for (uint i = 0; i < 7; i++)
+    {
+        Simulator::Schedule(Seconds(3) + MilliSeconds(10 * i), push, 0, 20 + i);
+    }
+    Simulator::Run();
+    NS_TEST_ASSERT_MSG_EQ(container.GetSize(0), 5, "Count cap does not apply");
+    NS_TEST_ASSERT_MSG_EQ(container.AggregateNewest(0, 3)["ttlValue"].GetMin(),
+                          24,
+                          "Wrong window after the count cap");
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup defiance-tests
+ *
+ * \brief Test that snapshots stay consistent while the container changes and share unchanged data
+ */
+void
+HistoryContainerTest::TestSnapshots()
+{
+    HistoryContainer container = HistoryContainer(3);
+    KeyId key = KeyRegistry::Intern("snapshotValue");
+    auto push = [&container](uint id, float value) {
+        auto dict = CreateObject<OpenGymDictContainer>();
+        auto box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{1});
+        box->AddValue(value);
+        dict->Add("snapshotValue", box);
+        container.Push(dict, id);
+    };
+    auto valueOf = [key](const SnapshotEntry& entry) {
+        float value = -1;
+        entry.ForEachValue(key, [&value](auto boxValue) { value = boxValue; });
+        return value;
+    };
+
+    NS_TEST_ASSERT_MSG_EQ(container.GetPublishedSnapshot(), nullptr, "Snapshot published early");
+    push(0, 1);
+    push(0, 2);
+    push(7, 10);
+    auto first = container.Snapshot();
+    NS_TEST_ASSERT_MSG_EQ(container.GetPublishedSnapshot(), first, "Snapshot was not published");
+    NS_TEST_ASSERT_MSG_EQ(container.Snapshot(), first, "Unchanged container was copied");
+    NS_TEST_ASSERT_MSG_EQ(first->GetVersion(), 3, "Wrong version");
+    NS_TEST_ASSERT_MSG_EQ((first->GetIds() == std::vector<uint>{0, 7}), true, "Wrong ids");
+    NS_TEST_ASSERT_MSG_EQ(first->GetSize(0), 2, "Wrong size");
+    NS_TEST_ASSERT_MSG_EQ(valueOf(first->GetNewest(0)), 2, "Wrong newest entry");
+    NS_TEST_ASSERT_MSG_EQ(valueOf(first->GetNewest(0, 1)), 1, "Wrong older entry");
+    NS_TEST_ASSERT_MSG_EQ(first->GetNewest(0).Get(key),
+                          PeekPointer(container.GetNewestByID(0)->data->Get("snapshotValue")),
+                          "Snapshot copied the box");
+    NS_TEST_ASSERT_MSG_EQ(first->GetNewest(0).Visit(key, [](auto* box) {}),
+                          true,
+                          "Box of the snapshot is not visited");
+
+    // the first snapshot is unaffected by pushes that overwrite its entries
+    for (float value = 3; value <= 5; value++)
+    {
+        push(0, value);
+    }
+    container.DeleteHistory(7);
+    auto second = container.Snapshot();
+    NS_TEST_ASSERT_MSG_EQ(first->GetSize(0), 2, "Snapshot changed");
+    NS_TEST_ASSERT_MSG_EQ(valueOf(first->GetNewest(0)), 2, "Snapshot changed");
+    NS_TEST_ASSERT_MSG_EQ(first->HistoryExists(7), true, "Snapshot lost a deleted history");
+    NS_TEST_ASSERT_MSG_EQ(second->HistoryExists(7), false, "Deleted history was published");
+    NS_TEST_ASSERT_MSG_EQ(second->GetSize(0), 3, "Wrong size");
+    NS_TEST_ASSERT_MSG_EQ(valueOf(second->GetNewest(0, 2)), 3, "Wrong oldest entry");
+    NS_TEST_ASSERT_MSG_EQ(second->Aggregate(0, key, 3).GetAvg(),
+                          container.Aggregate(0, key, 3).GetAvg(),
+                          "Snapshot aggregates differently");
+
+    // entries that are still stored and histories without pushes are shared between snapshots
+    push(1, 20);
+    auto third = container.Snapshot();
+    NS_TEST_ASSERT_MSG_EQ(&third->GetNewest(0), &second->GetNewest(0), "Entry was not reused");
+    push(0, 6);
+    auto fourth = container.Snapshot();
+    NS_TEST_ASSERT_MSG_EQ(&fourth->GetNewest(0, 1), &third->GetNewest(0), "Entry was not reused");
+    NS_TEST_ASSERT_MSG_EQ(&fourth->GetNewest(1), &third->GetNewest(1), "History was not reused");
+    NS_TEST_ASSERT_MSG_EQ(valueOf(fourth->GetNewest(0)), 6, "Wrong newest entry");
+
+    // a reader thread only ever sees complete snapshots while the container is pushed to
+    std::atomic<bool> done{false};
+    std::atomic<uint> inconsistent{0};
+    std::thread reader([&container, &done, &inconsistent, &valueOf]() {
+        while (!done.load())
+        {
+            auto snapshot = container.GetPublishedSnapshot();
+            // the newest entry of history 2 is the value pushed with the version of the snapshot
+            if (snapshot->HistoryExists(2) &&
+                (snapshot->GetSize(2) != 3 ||
+                 valueOf(snapshot->GetNewest(2)) != snapshot->GetVersion() - 1 ||
+                 valueOf(snapshot->GetNewest(2, 2)) != snapshot->GetVersion() - 3))
+            {
+                inconsistent++;
+            }
+        }
+    });
+    for (uint version = container.Snapshot()->GetVersion(); version < 2000; version++)
+    {
+        push(2, version);
+        if (container.GetSize(2) == 3)
+        {
+            container.Snapshot();
+        }
+    }
+    done = true;
+    reader.join();
+    NS_TEST_ASSERT_MSG_EQ(inconsistent.load(), 0, "Reader saw an inconsistent snapshot");
+}
+
 void
 HistoryContainerTest::DoRun()
 {
     TestAggregatedInfo();
     TestDataStruct();
     TestDataStructAggregation();
+    TestRingBuffer();
+    TestColumnarStorage();
+    TestAggregationWindow();
+    TestReductionKernels();
+    TestQuantileSketch();
+    TestRobustStatistics();
+    TestTimeRangeQueries();
+    TestCombinedHistory();
+    TestHistoryViews();
+    TestReplayBuffer();
+    TestSparseHistoryIds();
+    TestKeyInterning();
+    TestRetentionPolicies();
+    TestCompressedHistory();
+    TestProjectionQueries();
+    TestCrossHistoryReduction();
+    TestTransitionBuilder();
+    TestReturnsCalculator();
+    TestFrameStacking();
+    TestHistoryTiers();
+    TestPrioritizedSampling();
+    TestBoxDtypes();
+    TestMemoryBudget();
+    TestTimeToLive();
+    TestSnapshots();
 }
 
 /**
@@ -0,0 +1,76 @@
+"""Reader for the replay buffer files written by ns3::ReplayBuffer.
+
+The files are memory-mapped, so only the records that are accessed are loaded into memory. See the
+documentation of ns3::ReplayBuffer for the file layout.
+"""
+
+import struct
+from os import PathLike
+
+import numpy as np
+
+HEADER_SIZE = 4096
+MAGIC = b"DEFRPLY\0"
+VERSION = 1
+KEY_SIZE = 32
+FIELDS_OFFSET = 40
+FIELD_SIZE = 48
+DTYPES = {0: "<f4", 1: "<f8", 2: "<i4", 3: "<u4"}  # HistoryColumn::Dtype
+
+
+class ReplayBuffer:
+    """Read-only view of a replay buffer file, which may still be written by a running simulation."""
+
+    def __init__(self, path: str | PathLike[str]) -> None:
+        self._map = np.memmap(path, dtype=np.uint8, mode="r")
+        header = self._map[:HEADER_SIZE].tobytes()
+        if header[:8] != MAGIC:
+            msg = f"{path} is not a replay buffer file"
+            raise ValueError(msg)
+        version, self.record_size, self.capacity = struct.unpack_from("<IIQ", header, 8)
+        if version != VERSION:
+            msg = f"Unsupported replay buffer version {version}"
+            raise ValueError(msg)
+        (field_count,) = struct.unpack_from("<I", header, 32)
+
+        names = ["ns3timestamp", "sequence"]
+        formats: list[str | tuple[str, tuple[int]]] = ["<i8", "<u8"]
+        offsets = [0, 8]
+        for i in range(field_count):
+            descriptor = FIELDS_OFFSET + i * FIELD_SIZE
+            key = header[descriptor : descriptor + KEY_SIZE].split(b"\0", 1)[0].decode()
+            dtype, length, offset = struct.unpack_from("<III", header, descriptor + KEY_SIZE)
+            names.append(key)
+            formats.append((DTYPES[dtype], (length,)))
+            offsets.append(offset)
+        self.keys = names[2:]
+        self.dtype = np.dtype({"names": names, "formats": formats, "offsets": offsets, "itemsize": self.record_size})
+        end = HEADER_SIZE + self.capacity * self.record_size
+        self._slots = self._map[HEADER_SIZE:end].view(self.dtype)
+
+    @property
+    def count(self) -> int:
+        """Number of records appended so far, including the overwritten ones."""
+        return int(self._map[24:32].view("<u8")[0])
+
+    def __len__(self) -> int:
+        return min(self.count, self.capacity)
+
+    def records(self) -> np.ndarray:
+        """Return all retained records as a structured array, oldest first.
+
+        The array is a view into the file unless the retained records wrap around the end of the file.
+        """
+        size = len(self)
+        start = (self.count - size) % self.capacity
+        if start + size <= self.capacity:
+            return self._slots[start : start + size]
+        return np.concatenate((self._slots[start:], self._slots[: start + size - self.capacity]))
+
+    def __getitem__(self, index: int) -> np.void:
+        """Return a single record, 0 being the oldest retained one."""
+        size = len(self)
+        if not -size <= index < size:
+            msg = f"No record at index {index}"
+            raise IndexError(msg)
+        return self._slots[(self.count - size + index % size) % self.capacity]